@@ -6,6 +6,7 @@ build_dir="$PWD/x64"
 engine_dir="$PWD/engine"
 dependencies_dir="$PWD/dependencies"
 demo_dir="$PWD/demo"
+tools_dir="$PWD/tools"
 
 include_dirs=""
 include_dirs="$include_dirs -I$engine_dir"
@@ -13,28 +14,37 @@ include_dirs="$include_dirs -I$dependencies_dir/dds/include -I$dependencies_dir/
 
 engine_sources=""
 # engine_sources="$engine_sources $engine_dir/engine_bitmap.cpp"
+# engine_sources="$engine_sources $engine_dir/engine_bvh.cpp"
 # engine_sources="$engine_sources $engine_dir/engine_camera.cpp"
 # engine_sources="$engine_sources $engine_dir/engine_container.cpp"
+# engine_sources="$engine_sources $engine_dir/engine_cooked.cpp"
 # engine_sources="$engine_sources $engine_dir/engine_ebo.cpp"
 # engine_sources="$engine_sources $engine_dir/engine_fbo.cpp"
+# engine_sources="$engine_sources $engine_dir/engine_frame_stats.cpp"
 # engine_sources="$engine_sources $engine_dir/engine_light.cpp"
 # engine_sources="$engine_sources $engine_dir/engine_list.cpp"
+# engine_sources="$engine_sources $engine_dir/engine_loader.cpp"
 # engine_sources="$engine_sources $engine_dir/engine_log.cpp"
 # engine_sources="$engine_sources $engine_dir/engine_managed.cpp"
 # engine_sources="$engine_sources $engine_dir/engine_material.cpp"
 # engine_sources="$engine_sources $engine_dir/engine_mesh.cpp"
 # engine_sources="$engine_sources $engine_dir/engine_node.cpp"
 # engine_sources="$engine_sources $engine_dir/engine_object.cpp"
+# engine_sources="$engine_sources $engine_dir/engine_occlusion.cpp"
 # engine_sources="$engine_sources $engine_dir/engine_ovo.cpp"
 # engine_sources="$engine_sources $engine_dir/engine_particle_emitter.cpp"
 # engine_sources="$engine_sources $engine_dir/engine_pipeline_default.cpp"
 # engine_sources="$engine_sources $engine_dir/engine_pipeline_fullscreen2d.cpp"
 # engine_sources="$engine_sources $engine_dir/engine_pipeline_shadowmapping.cpp"
 # engine_sources="$engine_sources $engine_dir/engine_pipeline.cpp"
+# engine_sources="$engine_sources $engine_dir/engine_profiler.cpp"
 # engine_sources="$engine_sources $engine_dir/engine_program.cpp"
 # engine_sources="$engine_sources $engine_dir/engine_serializer.cpp"
 # engine_sources="$engine_sources $engine_dir/engine_shader.cpp"
+# engine_sources="$engine_sources $engine_dir/engine_state.cpp"
 # engine_sources="$engine_sources $engine_dir/engine_texture.cpp"
+# engine_sources="$engine_sources $engine_dir/engine_triangle_bvh.cpp"
+# engine_sources="$engine_sources $engine_dir/engine_ubo.cpp"
 # engine_sources="$engine_sources $engine_dir/engine_vao.cpp"
 # engine_sources="$engine_sources $engine_dir/engine_vbo.cpp"
 # engine_sources="$engine_sources $engine_dir/engine.cpp"
@@ -43,7 +53,10 @@ engine_sources="$engine_sources $engine_dir/unity.cpp"
 demo_sources=""
 demo_sources="$demo_sources $demo_dir/main.cpp"
 
-common_compiler_flags="-std=c++17 -D_DEBUG"
+cooker_sources=""
+cooker_sources="$cooker_sources $tools_dir/cooker/main.cpp"
+
+common_compiler_flags="-std=c++17 -D_DEBUG -pthread"
 common_compiler_flags="$common_compiler_flags -g -O0" # debug version
 #common_compiler_flags="$common_compiler_flags -g -O3" # release version
 
@@ -61,3 +74,4 @@ fi
 
 g++ $common_compiler_flags -o $build_dir/libengine.so $engine_sources -fPIC -shared -g $include_dirs
 g++ $common_compiler_flags -o $build_dir/demo $demo_sources -g $include_dirs -L$build_dir -lengine -lglfw -lGLEW -limgui -Wl,-rpath,$build_dir
+g++ $common_compiler_flags -o $build_dir/cooker $cooker_sources -g $include_dirs -L$build_dir -lengine -lglfw -lGLEW -Wl,-rpath,$build_dir
@@ -17,6 +17,7 @@
 // C/C++:
 #include <iostream>
 #include <chrono>
+#include <fstream>
 
 
 #include <imgui.h>
@@ -73,6 +74,80 @@ const float firstPersonVelocityTransitionSpeed = 40.0f;
 Eng::PipelineDefault dfltPipe;
 Eng::PipelineFullscreen2D full2dPipe;
 
+///////////////
+// BENCHMARK //
+///////////////
+
+enum BenchmarkMode {
+    BenchmarkMode_None,
+    BenchmarkMode_Record,
+    BenchmarkMode_Replay
+};
+
+// Benchmark flags:
+const uint32_t BenchmarkFlag_Fireworks = 1;
+const uint32_t BenchmarkFlag_Wireframe = 2;
+const uint32_t BenchmarkFlag_DepthPrepass = 4;
+
+/**
+ * @brief Demo state captured at each frame, so that a session can be replayed on an identical workload.
+ */
+struct BenchmarkFrame
+{
+    glm::mat4 cameraMat;                    ///< Camera matrix
+    glm::mat4 torchMat;                     ///< Matrix of the torch held in front of the camera
+    float dT;                               ///< Simulation timestep, in seconds
+    float nrOfParticles;                    ///< Number of water particles
+    glm::vec3 startVelocityWater;           ///< Water particles start velocity
+    glm::vec3 startAccelerationWater;       ///< Water particles start acceleration
+    glm::vec2 initLifeWater;                ///< Water particles life
+    float bounciness;                       ///< Water particles bounciness
+    uint32_t flags;                         ///< Combination of BenchmarkFlag_* values
+};
+
+const uint32_t benchmarkMagic = 0x434E4542;      // "BENC"
+const uint32_t benchmarkVersion = 1;
+const float benchmarkFixedDt = 1.0f / 60.0f;     // Replay timestep, in seconds
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Saves a recorded session. Raw binary, to be replayed on the same platform.
+ * @param filename output filename
+ * @param frames recorded frames
+ * @return TF
+ */
+bool saveBenchmark(const std::string& filename, const std::vector<BenchmarkFrame>& frames)
+{
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open())
+        return false;
+    const uint32_t header[4] = { benchmarkMagic, benchmarkVersion, static_cast<uint32_t>(sizeof(BenchmarkFrame)), static_cast<uint32_t>(frames.size()) };
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(frames.data()), frames.size() * sizeof(BenchmarkFrame));
+    return file.good();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Loads a recorded session.
+ * @param filename input filename
+ * @param frames recorded frames
+ * @return TF
+ */
+bool loadBenchmark(const std::string& filename, std::vector<BenchmarkFrame>& frames)
+{
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open())
+        return false;
+    uint32_t header[4] = { 0 };
+    file.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (!file.good() || header[0] != benchmarkMagic || header[1] != benchmarkVersion || header[2] != sizeof(BenchmarkFrame))
+        return false;
+    frames.resize(header[3]);
+    file.read(reinterpret_cast<char*>(frames.data()), frames.size() * sizeof(BenchmarkFrame));
+    return file.good() && !frames.empty();
+}
+
 ///////////////
 // CALLBACKS //
 ///////////////
@@ -174,6 +249,9 @@ void keyboardCallback(int key, int scancode, int action, int mods)
             firstMouse = true;
         } break;
         case 'W': if (action == 0) dfltPipe.setWireframe(!dfltPipe.isWireframe()); break;
+        case 'Z': if (action == 0) dfltPipe.setDepthPrepass(!dfltPipe.isDepthPrepass()); break;
+        case 'T': if (action == 0 && Eng::Profiler::saveTrace("trace.json")) std::cout << "Trace saved to trace.json" << std::endl; break;
+        case 'F': if (action == 0 && Eng::FrameStats::save("frame_stats.csv") && Eng::FrameStats::save("frame_stats.json")) std::cout << "Frame stats saved to frame_stats.csv/.json" << std::endl; break;
         }
     }
     else if (cameraMode == CameraMode_FirstPerson) {
@@ -332,9 +410,40 @@ int main(int argc, char* argv[])
     std::cout << "Engine demo, A. Peternier (C) SUPSI" << std::endl;
     std::cout << std::endl;
 
+    // Command line:
+    Eng::Base::Settings settings;
+    BenchmarkMode benchmarkMode = BenchmarkMode_None;
+    std::string benchmarkFile;
+    bool benchmarkRecordedDt = false;
+    for (int c = 1; c < argc; c++) {
+        const std::string arg = argv[c];
+        if (arg == "--headless")
+            settings.headless = true;
+        else if (arg == "--record" && c + 1 < argc) {
+            benchmarkMode = BenchmarkMode_Record;
+            benchmarkFile = argv[++c];
+        }
+        else if (arg == "--replay" && c + 1 < argc) {
+            benchmarkMode = BenchmarkMode_Replay;
+            benchmarkFile = argv[++c];
+        }
+        else if (arg == "--recorded-dt")
+            benchmarkRecordedDt = true;
+        else {
+            std::cout << "Usage: demo [--headless] [--record <file> | --replay <file> [--recorded-dt]]" << std::endl;
+            return 1;
+        }
+    }
+    std::vector<BenchmarkFrame> benchmarkFrames;
+    if (benchmarkMode == BenchmarkMode_Replay && !loadBenchmark(benchmarkFile, benchmarkFrames)) {
+        std::cout << "Unable to load recorded session '" << benchmarkFile << "'" << std::endl;
+        return 1;
+    }
+
     // Init engine:
     Eng::Base& eng = Eng::Base::getInstance();
-    eng.init();
+    if (!eng.init(settings))
+        return 1;
 
     // Register callbacks:
     eng.setMouseCursorCallback(mouseCursorCallback);
@@ -343,6 +452,7 @@ int main(int argc, char* argv[])
     eng.setKeyboardCallback(keyboardCallback);
     eng.setMouseCursorActive(false);
     eng.initImgui();
+    Eng::Profiler::setEnabled(true);
 
     cameraMode = CameraMode_FirstPerson;
     firstPersonPosition = glm::vec3(0.0f, 17.5f, 0.0f);
@@ -389,7 +499,7 @@ int main(int argc, char* argv[])
     std::reference_wrapper<Eng::Light> light = dynamic_cast<Eng::Light&>(Eng::Container::getInstance().find("Omni001"));
     light.get().setAmbient({ 0.3f, 0.3f, 0.3f });
     light.get().setColor({ 1.5f, 1.5f, 1.5f });
-    light.get().setProjMatrix(glm::ortho(-100.0f, 100.0f, -100.0f, 100.0f, 1.0f, 1000.0f)); // Orthographic projection
+    light.get().setProjMatrix(glm::ortho(-100.0f, 100.0f, -100.0f, 100.0f, 1.0f, 1000.0f)); // Orthographic projection (cascaded: only the depth range is used)
     // light.get().setProjMatrix(glm::perspective(glm::radians(75.0f), 1.0f, 1.0f, 1000.0f)); // Perspective projection         
     // Get torus knot ref:
     std::reference_wrapper<Eng::Mesh> torch = dynamic_cast<Eng::Mesh&>(Eng::Container::getInstance().find("Box001"));
@@ -399,6 +509,12 @@ int main(int argc, char* argv[])
     std::reference_wrapper<Eng::Mesh> firework2 = dynamic_cast<Eng::Mesh&>(Eng::Container::getInstance().find("Box004"));
     std::reference_wrapper<Eng::Mesh> firework3 = dynamic_cast<Eng::Mesh&>(Eng::Container::getInstance().find("Box005"));
 
+    // Static shadow casters (all the meshes but the ones moved by the main loop):
+    for (auto &mesh : Eng::Container::getInstance().getMeshList())
+        mesh.setStatic(true);
+    for (auto mesh : { torch, torchBase, firework, firework1, firework2, firework3 })
+        mesh.get().setStatic(false);
+
     // Rendering elements:
     Eng::List list;
     Eng::Camera camera;
@@ -411,9 +527,9 @@ int main(int argc, char* argv[])
     float currentFps = 0.0f;
     float bounciness = 0.8f;
     Eng::ParticleEmitter smokeParticleEmitter(std::make_shared<std::vector<Eng::ParticleEmitter::Particle>>(particlesSmoke));
-    Eng::Bitmap sprite;
-    sprite.load("smoke.dds");
-    smokeParticleEmitter.setTexture(sprite);
+    Eng::Texture &smokeSprite = Eng::Container::getInstance().acquireTexture("smoke.dds");
+    Eng::Texture &flameSprite = Eng::Container::getInstance().acquireTexture("flame.dds");
+    smokeParticleEmitter.setTexture(smokeSprite);
     smokeParticleEmitter.setMatrix(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 12.0f, 0.0f)));
     smokeParticleEmitter.setProjection(camera.getProjMatrix());
     torch.get().addChild(smokeParticleEmitter);
@@ -421,43 +537,37 @@ int main(int argc, char* argv[])
 
     // fire
     Eng::ParticleEmitter fireParticleEmitter(std::make_shared<std::vector<Eng::ParticleEmitter::Particle>>(particlesFire));
-    sprite.load("flame.dds");
-    fireParticleEmitter.setTexture(sprite);
+    fireParticleEmitter.setTexture(flameSprite);
     fireParticleEmitter.setMatrix(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -10.0f, 0.0f)));
     fireParticleEmitter.setProjection(camera.getProjMatrix());
     smokeParticleEmitter.addChild(fireParticleEmitter);
 
     Eng::ParticleEmitter fireworkParticleEmitterRed(std::make_shared<std::vector<Eng::ParticleEmitter::Particle>>(particlesFireRed));
-    sprite.load("flame.dds");
-    fireworkParticleEmitterRed.setTexture(sprite);
+    fireworkParticleEmitterRed.setTexture(flameSprite);
     fireworkParticleEmitterRed.setMatrix(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.5f, 1.5f)));
     fireworkParticleEmitterRed.setProjection(camera.getProjMatrix());
     firework.get().addChild(fireworkParticleEmitterRed);
 
     Eng::ParticleEmitter fireworkParticleEmitterBlue(std::make_shared<std::vector<Eng::ParticleEmitter::Particle>>(particlesFireGreen));
-    sprite.load("flame.dds");
-    fireworkParticleEmitterBlue.setTexture(sprite);
+    fireworkParticleEmitterBlue.setTexture(flameSprite);
     fireworkParticleEmitterBlue.setMatrix(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.5f, 1.5f)));
     fireworkParticleEmitterBlue.setProjection(camera.getProjMatrix());
     firework1.get().addChild(fireworkParticleEmitterBlue);
 
     Eng::ParticleEmitter fireworkParticleEmitterGreen(std::make_shared<std::vector<Eng::ParticleEmitter::Particle>>(particlesFireBlue));
-    sprite.load("flame.dds");
-    fireworkParticleEmitterGreen.setTexture(sprite);
+    fireworkParticleEmitterGreen.setTexture(flameSprite);
     fireworkParticleEmitterGreen.setMatrix(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.5f, 1.5f)));
     fireworkParticleEmitterGreen.setProjection(camera.getProjMatrix());
     firework2.get().addChild(fireworkParticleEmitterGreen);
 
     Eng::ParticleEmitter fireworkParticleEmitterYellow(std::make_shared<std::vector<Eng::ParticleEmitter::Particle>>(particlesFireYellow));
-    sprite.load("flame.dds");
-    fireworkParticleEmitterYellow.setTexture(sprite);
+    fireworkParticleEmitterYellow.setTexture(flameSprite);
     fireworkParticleEmitterYellow.setMatrix(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.5f, 1.5f)));
     fireworkParticleEmitterYellow.setProjection(camera.getProjMatrix());
     firework3.get().addChild(fireworkParticleEmitterYellow);
 
     Eng::ParticleEmitter waterBounce(std::make_shared<std::vector<Eng::ParticleEmitter::Particle>>(particlesWater));
-    sprite.load("flame.dds");
-    waterBounce.setTexture(sprite);
+    waterBounce.setTexture(flameSprite);
     waterBounce.setMatrix(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
     waterBounce.setProjection(camera.getProjMatrix());
     root.get().addChild(waterBounce);
@@ -471,8 +581,22 @@ int main(int argc, char* argv[])
     glm::vec3 velocity = glm::vec3(0.0f, 10.0f, 0.0f);
 
     value = 10000.0f;
+    std::vector<float> benchmarkTimes;
+    size_t benchmarkFrameNr = 0;
     while (eng.processEvents())
     {
+        // Replay over?
+        if (benchmarkMode == BenchmarkMode_Replay && benchmarkFrameNr == benchmarkFrames.size())
+            break;
+        BenchmarkFrame benchmarkFrame = {};
+        if (benchmarkMode == BenchmarkMode_Replay) {
+            benchmarkFrame = benchmarkFrames[benchmarkFrameNr];
+            currentFps = benchmarkRecordedDt ? benchmarkFrame.dT : benchmarkFixedDt;
+            dfltPipe.setWireframe(benchmarkFrame.flags & BenchmarkFlag_Wireframe);
+            dfltPipe.setDepthPrepass(benchmarkFrame.flags & BenchmarkFlag_DepthPrepass);
+        }
+        benchmarkFrame.dT = currentFps;
+
         auto start = timer.now();
 
         // Update viewpoint:
@@ -487,11 +611,19 @@ int main(int argc, char* argv[])
             camera.setMatrix(cameraMat);
             torchBase.get().setMatrix(cameraMat * glm::translate(glm::mat4(1.0f), glm::vec3(5.0f, -5.0f, -17.0f)) * glm::rotate(glm::mat4(1.0f), glm::radians(190.0f), glm::vec3(0.0f, 1.0f, 0.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(0.7f)));
         }
+        if (benchmarkMode == BenchmarkMode_Replay) {
+            camera.setMatrix(benchmarkFrame.cameraMat);
+            torchBase.get().setMatrix(benchmarkFrame.torchMat);
+        }
+        benchmarkFrame.cameraMat = camera.getMatrix();
+        benchmarkFrame.torchMat = torchBase.get().getMatrix();
 
         // Animate torus knot:      
         // Update list:
         list.reset();
         list.process(root);
+        list.selectLods(camera);
+        list.cull(camera);
 
         // Main rendering:
         eng.clear();
@@ -531,34 +663,63 @@ int main(int argc, char* argv[])
         //  full2dPipe.render(dfltPipe.getShadowMappingPipeline().getShadowMap(), list);
         eng.getImgui()->newFrame();
         eng.getImgui()->newText("Fps: " + std::to_string(1.0f / fpsFactor));
-        if (eng.getImgui()->newBar("Number particles", value, 1.0f, 1000000.0f)) {
-            createParticlesWater(particlesWater, value, glm::vec4(0.5f, 0.4f, 0.5f, 1.0f), glm::vec4(1.0f, 1.0f, 1.0f, 0.0f));
-            waterBounce.setParticles(std::make_shared<std::vector<Eng::ParticleEmitter::Particle>>(particlesWater));
+        for (auto channel : { Eng::FrameStats::Channel::cpu, Eng::FrameStats::Channel::gpu, Eng::FrameStats::Channel::present })
+            eng.getImgui()->newText(std::string(channel == Eng::FrameStats::Channel::cpu ? "CPU" : (channel == Eng::FrameStats::Channel::gpu ? "GPU" : "Present")) +
+                                    " p50/p95/p99: " + std::to_string(Eng::FrameStats::getPercentile(channel, 50.0)) + " / " + std::to_string(Eng::FrameStats::getPercentile(channel, 95.0)) + 
+                                    " / " + std::to_string(Eng::FrameStats::getPercentile(channel, 99.0)) + " ms, hitches: " + std::to_string(Eng::FrameStats::getNrOfHitches(channel)));
+        eng.getImgui()->newText(std::string("Depth pre-pass (Z): ") + (dfltPipe.isDepthPrepass() ? "on" : "off"));
+        eng.getImgui()->newText("Static shadow refreshes: " + std::to_string(dfltPipe.getShadowMappingPipeline().getNrOfStaticRefreshes()));
+        eng.getImgui()->newText("GL calls: " + std::to_string(Eng::State::getCounters().issued) + " issued, " + std::to_string(Eng::State::getCounters().skipped) + " skipped");
+        for (auto &event : Eng::Profiler::getLastFrame().events)
+            if (event.depth == 0)
+                eng.getImgui()->newText(std::string(event.name) + ": " + std::to_string(event.cpuTime / 1000.0) + " ms CPU, " + 
+                                        (event.gpuTime == Eng::Profiler::noTime ? std::string("n/a") : std::to_string(event.gpuTime / 1000.0) + " ms") + " GPU");
+        // Parameters, from the UI or from the recorded session:
+        bool particlesChanged = false;
+        bool waterChanged = false;
+        if (benchmarkMode == BenchmarkMode_Replay) {
+            eng.getImgui()->newText("Replay: frame " + std::to_string(benchmarkFrameNr + 1) + " / " + std::to_string(benchmarkFrames.size()));
+            particlesChanged = benchmarkFrame.nrOfParticles != value;
+            waterChanged = benchmarkFrame.startVelocityWater != startVelocityWater || benchmarkFrame.startAccelerationWater != startAccelerationWater || benchmarkFrame.initLifeWater != initLifeWater;
+            value = benchmarkFrame.nrOfParticles;
+            startVelocityWater = benchmarkFrame.startVelocityWater;
+            startAccelerationWater = benchmarkFrame.startAccelerationWater;
+            initLifeWater = benchmarkFrame.initLifeWater;
+            bounciness = benchmarkFrame.bounciness;
+            startFireworks = benchmarkFrame.flags & BenchmarkFlag_Fireworks;
         }
-        eng.getImgui()->newText("Start velocity");
-        if (eng.getImgui()->newBar("XV", startVelocityWater.x, -100.0f, 100.0f) | eng.getImgui()->newBar("YV", startVelocityWater.y, -100.0f, 100.0f) | eng.getImgui()->newBar("ZV", startVelocityWater.z, -100.0f, 100.0f)) {
-            updateParticles(particlesWater);
-            waterBounce.setParticles(std::make_shared<std::vector<Eng::ParticleEmitter::Particle>>(particlesWater));
+        else {
+            particlesChanged = eng.getImgui()->newBar("Number particles", value, 1.0f, 1000000.0f);
+            eng.getImgui()->newText("Start velocity");
+            waterChanged |= eng.getImgui()->newBar("XV", startVelocityWater.x, -100.0f, 100.0f) | eng.getImgui()->newBar("YV", startVelocityWater.y, -100.0f, 100.0f) | eng.getImgui()->newBar("ZV", startVelocityWater.z, -100.0f, 100.0f);
+            eng.getImgui()->newText("Start acceleration");
+            waterChanged |= eng.getImgui()->newBar("XA", startAccelerationWater.x, -100.0f, 100.0f) | eng.getImgui()->newBar("YA", startAccelerationWater.y, -100.0f, 100.0f) | eng.getImgui()->newBar("ZA", startAccelerationWater.z, -100.0f, 100.0f);
+            eng.getImgui()->newText("Life");
+            waterChanged |= eng.getImgui()->newBar("Init life", initLifeWater.x, -100.0f, 100.0f) | eng.getImgui()->newBar("End life", initLifeWater.y, -100.0f, 100.0f);
+            eng.getImgui()->newBar("Bounciness", bounciness, 0.0f, 1.0f);
+            if (eng.getImgui()->newButton("Start fireworks")) {
+                startFireworks = true;
+            }
         }
-        eng.getImgui()->newText("Start acceleration");
-        if (eng.getImgui()->newBar("XA", startAccelerationWater.x, -100.0f, 100.0f) | eng.getImgui()->newBar("YA", startAccelerationWater.y, -100.0f, 100.0f) | eng.getImgui()->newBar("ZA", startAccelerationWater.z, -100.0f, 100.0f)) {
-            updateParticles(particlesWater);
+        if (particlesChanged) {
+            createParticlesWater(particlesWater, value, glm::vec4(0.5f, 0.4f, 0.5f, 1.0f), glm::vec4(1.0f, 1.0f, 1.0f, 0.0f));
             waterBounce.setParticles(std::make_shared<std::vector<Eng::ParticleEmitter::Particle>>(particlesWater));
         }
-        eng.getImgui()->newText("Life");
-        if (eng.getImgui()->newBar("Init life", initLifeWater.x, -100.0f, 100.0f) | eng.getImgui()->newBar("End life", initLifeWater.y, -100.0f, 100.0f)) {
+        if (waterChanged) {
             updateParticles(particlesWater);
             waterBounce.setParticles(std::make_shared<std::vector<Eng::ParticleEmitter::Particle>>(particlesWater));
         }
-        eng.getImgui()->newBar("Bounciness", bounciness, 0.0f, 1.0f);
+        benchmarkFrame.nrOfParticles = value;
+        benchmarkFrame.startVelocityWater = startVelocityWater;
+        benchmarkFrame.startAccelerationWater = startAccelerationWater;
+        benchmarkFrame.initLifeWater = initLifeWater;
+        benchmarkFrame.bounciness = bounciness;
+        benchmarkFrame.flags = (startFireworks ? BenchmarkFlag_Fireworks : 0) | (dfltPipe.isWireframe() ? BenchmarkFlag_Wireframe : 0) | (dfltPipe.isDepthPrepass() ? BenchmarkFlag_DepthPrepass : 0);
         waterBounce.setBounciness(bounciness);
         fireworkParticleEmitterRed.setBounciness(-1.0f);
         fireworkParticleEmitterBlue.setBounciness(-1.0f);
         fireworkParticleEmitterGreen.setBounciness(-1.0f);
         fireworkParticleEmitterYellow.setBounciness(-1.0f);
-        if (eng.getImgui()->newButton("Start fireworks")) {
-            startFireworks = true;
-        }
         eng.getImgui()->render();
         eng.swap();
         if (startFireworks) {
@@ -578,9 +739,37 @@ int main(int argc, char* argv[])
             fpsFactor = 1.0f / fps;
             seconds = 0.0f;
         }
+
+        // Benchmark:
+        if (benchmarkMode == BenchmarkMode_Record)
+            benchmarkFrames.push_back(benchmarkFrame);
+        else if (benchmarkMode == BenchmarkMode_Replay)
+            benchmarkTimes.push_back(deltaTime);
+        benchmarkFrameNr++;
     }
     std::cout << "Leaving main loop..." << std::endl;
 
+    // Benchmark results:
+    if (benchmarkMode == BenchmarkMode_Record) {
+        if (saveBenchmark(benchmarkFile, benchmarkFrames))
+            std::cout << benchmarkFrames.size() << " frame(s) recorded to " << benchmarkFile << std::endl;
+        else
+            std::cout << "Unable to save recorded session '" << benchmarkFile << "'" << std::endl;
+    }
+    else if (benchmarkMode == BenchmarkMode_Replay) {
+        std::ofstream timesFile(benchmarkFile + ".csv");
+        timesFile << "frame,ms" << std::endl;
+        for (size_t c = 0; c < benchmarkTimes.size(); c++)
+            timesFile << c << ',' << benchmarkTimes[c] << std::endl;
+        Eng::FrameStats::save(benchmarkFile + ".stats.json");
+        std::cout << "Replayed " << benchmarkTimes.size() << " frame(s), per-frame timings in " << benchmarkFile << ".csv" << std::endl;
+        std::cout << Eng::FrameStats::getCsv();
+    }
+
+    // Release shared sprites:
+    Eng::Container::getInstance().releaseTexture("smoke.dds");
+    Eng::Container::getInstance().releaseTexture("flame.dds");
+
     // Release engine:
     eng.free();
 
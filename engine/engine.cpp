@@ -33,6 +33,12 @@ struct Eng::Base::Reserved
    GLFWwindow *window;                 ///< Window handler
    int32_t windowSizeX, windowSizeY;   ///< Window width and height
 
+   // Headless rendering:
+   bool headless;                      ///< When true, the main buffers are the ones of the offscreen FBO
+   Eng::Fbo headlessFbo;               ///< Offscreen main buffers
+   Eng::Texture headlessColor;         ///< Offscreen color buffer
+   std::vector<uint8_t> readback;      ///< Pixels of the last frame, given to the readback callback
+
    // Some counters:
    int64_t frameCounter;               ///< Total number of rendered frames   
 
@@ -44,17 +50,19 @@ struct Eng::Base::Reserved
    Eng::Base::MouseCursorCallback mouseCursorCallback;
    Eng::Base::MouseButtonCallback mouseButtonCallback;
    Eng::Base::MouseScrollCallback mouseScrollCallback;
+   Eng::Base::ReadbackCallback readbackCallback;
    std::shared_ptr<Eng::ImGuiEngine> imgui;
 
    /**
     * Constructor
     */
-   Reserved() : window{ nullptr }, windowSizeX{ 0 }, windowSizeY{ 0 },
+   Reserved() : window{ nullptr }, windowSizeX{ 0 }, windowSizeY{ 0 }, headless{ false },
                 frameCounter{ 0 }, bindlessSupportFlag{ false },
                 keyboardCallback{ nullptr },
                 mouseCursorCallback{ nullptr },
                 mouseButtonCallback{ nullptr },
-                mouseScrollCallback{ nullptr }
+                mouseScrollCallback{ nullptr },
+                readbackCallback{ nullptr }
    {}
 };
 
@@ -172,12 +180,21 @@ Eng::Base ENG_API &Eng::Base::getInstance()
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
- * Init internal components.
- * @param config optional configuration
+ * Init internal components. In headless mode, the window is hidden and rendering goes to an offscreen FBO made the 
+ * main framebuffer (see Fbo::setMain()). GLFW still needs a display connection for the hidden window (e.g., Xvfb),
+ * but the EGL and OSMesa context APIs allow running on software implementations such as Mesa llvmpipe.
+ * @param settings context creation settings
  * @return TF
  */
-bool ENG_API Eng::Base::init()
+bool ENG_API Eng::Base::init(const Settings &settings)
 {  
+   // Safety net:
+   if (settings.sizeX <= 0 || settings.sizeY <= 0 || settings.contextApi >= ContextApi::last)
+   {
+      ENG_LOG_ERROR("Invalid params");
+      return false;
+   }
+
    /////////////
    // Init glfw:
    typedef void(* GLWF_ERROR_CALLBACK_PTR)(int32_t error, const char *description);
@@ -205,7 +222,13 @@ bool ENG_API Eng::Base::init()
    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
    glfwWindowHint(GLFW_DOUBLEBUFFER, GLFW_TRUE);
    glfwWindowHint(GLFW_CLIENT_API, GLFW_OPENGL_API);
-   glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_NATIVE_CONTEXT_API);
+   switch (settings.contextApi)
+   {
+      case ContextApi::egl:    glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API); break;
+      case ContextApi::osmesa: glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API); break;
+      default:                 glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_NATIVE_CONTEXT_API); break;
+   }
+   glfwWindowHint(GLFW_VISIBLE, settings.headless ? GLFW_FALSE : GLFW_TRUE);
    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_TRUE);
@@ -223,7 +246,7 @@ bool ENG_API Eng::Base::init()
    glfwWindowHint(GLFW_DEPTH_BITS, 24);
    glfwWindowHint(GLFW_STENCIL_BITS, 8);
 
-   reserved->window = glfwCreateWindow(Eng::Base::dfltWindowSizeX, Eng::Base::dfltWindowSizeY,
+   reserved->window = glfwCreateWindow(settings.sizeX, settings.sizeY,
                                        "demo",
                                        nullptr,
                                        nullptr);
@@ -320,15 +343,34 @@ bool ENG_API Eng::Base::init()
 #endif   
    glfwGetFramebufferSize(reserved->window, &reserved->windowSizeX, &reserved->windowSizeY);
    glfwSwapInterval(0); // No V-sync
-   glViewport(0, 0, reserved->windowSizeX, reserved->windowSizeY);
+
+   // Offscreen main buffers:
+   reserved->headless = settings.headless;
+   if (reserved->headless)
+   {
+      reserved->windowSizeX = settings.sizeX;
+      reserved->windowSizeY = settings.sizeY;
+      if (!reserved->headlessColor.create(settings.sizeX, settings.sizeY, Eng::Texture::Format::r8g8b8a8) ||
+          !reserved->headlessFbo.attachTexture(reserved->headlessColor) ||
+          !reserved->headlessFbo.attachDepthBuffer(settings.sizeX, settings.sizeY) ||
+          !reserved->headlessFbo.validate())
+      {
+         ENG_LOG_ERROR("Unable to create offscreen buffers");
+         return false;
+      }
+      Eng::Fbo::setMain(reserved->headlessFbo);
+      ENG_LOG_PLAIN("   Headless  . . :  %dx%d", settings.sizeX, settings.sizeY);
+   }
+   Eng::Fbo::reset(reserved->windowSizeX, reserved->windowSizeY);
 
    // Common OpenGL settings:
-   glEnable(GL_DEPTH_TEST);
-   glDepthFunc(GL_LEQUAL);
+   Eng::State::invalidate();
+   Eng::State::setDepthTest(true);
+   Eng::State::setDepthFunc(GL_LEQUAL);
    glPixelStorei(GL_PACK_ALIGNMENT, 1);         // Not sure whether it is really global state
    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);       // Not sure whether it is really global state
-   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-   glEnable(GL_BLEND);
+   Eng::State::setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+   Eng::State::setBlending(true);
    // Done:
    return true;
 }
@@ -343,6 +385,9 @@ bool ENG_API Eng::Base::free()
 {
    ENG_LOG_DEBUG("Releasing context...");
 
+   // Stop background loaders:
+   Eng::Loader::getInstance().reset();
+
    // Since the context is about to be released, unload all objects that are still allocated:
    Managed::forceRelease();
 
@@ -350,7 +395,9 @@ bool ENG_API Eng::Base::free()
    if (reserved->window)
    {
       // Release OGL resources:      
-      // ...
+      Eng::Profiler::reset();
+      Eng::FrameStats::reset();
+      Eng::Fbo::setMain(Eng::Fbo::empty);
 
       glfwDestroyWindow(reserved->window);
       reserved->window = nullptr;
@@ -366,13 +413,16 @@ bool ENG_API Eng::Base::free()
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
- * Process events.
+ * Process events. Pending uploads of the background loader are also performed here, within the per-frame budget.
  * @return TF
  */
 bool ENG_API Eng::Base::processEvents()
 {
    glfwPollEvents();
 
+   // Streaming:
+   Eng::Loader::getInstance().update();
+
    // Window shall be closed?
    if (glfwWindowShouldClose(reserved->window))
       return false;
@@ -398,16 +448,31 @@ bool ENG_API Eng::Base::clear()
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
- * Swap buffers.
+ * Swap buffers. When headless, nothing is presented: the frame is read back instead, if a readback callback is set.
  * @return TF
  */
 bool ENG_API Eng::Base::swap()
 {
    // ENG_LOG_DEBUG("Finished with frame %llu", reserved->frameCounter);
-   glfwSwapBuffers(reserved->window);
+   Eng::FrameStats::endFrame();
+   if (reserved->headless)
+   {
+      if (reserved->readbackCallback)
+      {
+         reserved->readback.resize(static_cast<size_t>(reserved->windowSizeX) * reserved->windowSizeY * 4);
+         reserved->headlessFbo.render();
+         glReadPixels(0, 0, reserved->windowSizeX, reserved->windowSizeY, GL_RGBA, GL_UNSIGNED_BYTE, reserved->readback.data());
+         reserved->readbackCallback(reserved->readback.data(), reserved->windowSizeX, reserved->windowSizeY);
+      }
+   }
+   else
+      glfwSwapBuffers(reserved->window);
+   Eng::FrameStats::beginFrame();
 
    // New frame:
    reserved->frameCounter++;
+   Eng::State::nextFrame();
+   Eng::Profiler::nextFrame();
 
    // Done:
    return true;
@@ -436,6 +501,17 @@ glm::ivec2 ENG_API Eng::Base::getWindowSize() const
 }
 
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Returns true when rendering goes to the offscreen buffers.
+ * @return TF
+ */
+bool ENG_API Eng::Base::isHeadless() const
+{
+   return reserved->headless;
+}
+
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
  * Set keyboard callback.
@@ -547,6 +623,21 @@ bool ENG_API Eng::Base::setMouseScrollCallback(MouseScrollCallback cb)
    return true;
 }
 
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Set readback callback, invoked by swap() in headless mode with the RGBA pixels of the frame (bottom row first).
+ * @param cb readback callback function pointer (nullptr to disable the readback)
+ * @return TF
+ */
+bool ENG_API Eng::Base::setReadbackCallback(ReadbackCallback cb)
+{
+   reserved->readbackCallback = cb;
+
+   // Done:
+   return true;
+}
+
 bool ENG_API Eng::Base::initImgui()
 {
     reserved->imgui = std::make_shared<Eng::ImGuiEngine>(reserved->window);
@@ -18,6 +18,7 @@
    #include <vector>
    #include <list>   
    #include <memory> 
+   #include <limits>
 
    // GLM:
 #ifndef _DEBUG
@@ -71,6 +72,8 @@ namespace Eng {
 
    // Logging:
    #include "engine_log.h"
+   #include "engine_profiler.h"
+   #include "engine_frame_stats.h"
 
    // Architecture:
    #include "engine_object.h"
@@ -80,11 +83,15 @@ namespace Eng {
    #include "engine_serializer.h"
    #include "engine_bitmap.h"
    #include "engine_ovo.h"
+   #include "engine_cooked.h"
 
    // Objects:
+   #include "engine_state.h"
    #include "engine_vao.h"
    #include "engine_vbo.h"
    #include "engine_ebo.h"
+   #include "engine_ubo.h"
+   #include "engine_triangle_bvh.h"
    #include "engine_shader.h"
    #include "engine_program.h"
    #include "engine_texture.h"
@@ -96,11 +103,14 @@ namespace Eng {
    #include "engine_mesh.h"
    #include "engine_light.h"
    #include "engine_camera.h"
+   #include "engine_bvh.h"
+   #include "engine_occlusion.h"
    #include "engine_list.h"
    #include "engine_particle_emitter.h"
 
    // Storage:
    #include "engine_container.h"
+   #include "engine_loader.h"
 
    // Pipelines:
    #include "engine_pipeline.h"
@@ -147,6 +157,39 @@ public: //
    typedef void (* MouseCursorCallback)(double mouseX, double mouseY);
    typedef void (* MouseButtonCallback)(int button, int action, int mods);
    typedef void (* MouseScrollCallback)(double scrollX, double scrollY);
+   typedef void (* ReadbackCallback)   (const uint8_t *rgba, int32_t sizeX, int32_t sizeY);
+
+
+   /**
+    * @brief API used for creating the OpenGL context.
+    */
+   enum class ContextApi : uint32_t
+   {
+      native,        ///< Platform default (WGL, GLX)
+      egl,           ///< EGL (e.g., Mesa)
+      osmesa,        ///< OSMesa (software)
+      last,          ///< Terminator
+   };
+
+
+   /**
+    * @brief Context creation settings.
+    */
+   struct Settings
+   {
+      bool headless;             ///< When true, the window is hidden and rendering goes to an offscreen FBO
+      int32_t sizeX;             ///< Window (or offscreen buffer) width
+      int32_t sizeY;             ///< Window (or offscreen buffer) height
+      ContextApi contextApi;     ///< Context creation API
+
+
+      /**
+       * Constructor.
+       */
+      Settings() : headless{ false }, sizeX{ dfltWindowSizeX }, sizeY{ dfltWindowSizeY }, contextApi{ ContextApi::native }
+      {}
+   };
+
 
    // Const/dest:
    Base(Base const &) = delete;
@@ -159,12 +202,13 @@ public: //
    static Base &getInstance();
 
    // Init/free:
-   bool init();
+   bool init(const Settings &settings = Settings());
    bool free();
 
    // Get/set:
    uint64_t getFrameNr() const;
    glm::ivec2 getWindowSize() const;
+   bool isHeadless() const;
 
    // Management:
    bool processEvents();
@@ -174,6 +218,7 @@ public: //
    bool setMouseCursorCallback(MouseCursorCallback cb);
    bool setMouseButtonCallback(MouseButtonCallback cb);
    bool setMouseScrollCallback(MouseScrollCallback cb);
+   bool setReadbackCallback(ReadbackCallback cb);
    void setMouseCursorActive(bool mouseCursorActive);
    bool initImgui();
    // Compatibility:
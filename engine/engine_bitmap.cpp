@@ -20,6 +20,18 @@
    // C/C++:
    #include <algorithm>
 
+   // Memory mapping:
+#ifdef _WINDOWS
+   #define WIN32_LEAN_AND_MEAN
+   #define NOMINMAX
+   #include <windows.h>
+#else
+   #include <sys/mman.h>
+   #include <sys/stat.h>
+   #include <fcntl.h>
+   #include <unistd.h>
+#endif
+
    
 
 ////////////
@@ -41,35 +53,138 @@
 struct Eng::Bitmap::Reserved
 { 
    /**
-    * @brief Bitmap layer.
+    * @brief Bitmap layer, as a view over the contiguous storage.
     */
    struct Layer
    {      
-      std::vector<uint8_t> data;       ///< Image raw data
+      uint64_t offset;                 ///< Offset of the image raw data within the storage
+      uint32_t nrOfBytes;              ///< Size of the image raw data
       glm::u32vec2 size;               ///< Layer size
 
 
       /**
        * Constructor.
        */
-      Layer() : size{ 0, 0 }
+      Layer() : offset{ 0 }, nrOfBytes{ 0 }, size{ 0, 0 }
       {}
    };
 
    Eng::Bitmap::Format format;      ///< Image format
-   std::vector<Layer> layer;        ///< Bitmap layers;
+   std::vector<Layer> layer;        ///< Bitmap layers (offset table, indexed by side * nrOfLevels + level)
    uint32_t nrOfLevels;             ///< Number of levels (mipmaps)
    uint32_t nrOfSides;              ///< Number of sides (faces)
    float compressionFactor;         ///< Compression factor
 
+   // Storage (either owned or memory-mapped):
+   std::vector<uint8_t> buffer;     ///< Owned storage
+   uint8_t *mapped;                 ///< Memory-mapped storage, nullptr if not used
+   uint64_t mappedSize;             ///< Size of the mapped region
+#ifdef _WINDOWS
+   HANDLE mapping;                  ///< File mapping object
+#endif
+
 
    /**
     * Constructor. 
     */
    Reserved() : format{ Eng::Bitmap::Format::none }, 
                 nrOfLevels{ 0 }, nrOfSides{ 0 }, 
-                compressionFactor{ 1.0f }
+                compressionFactor{ 1.0f },
+                mapped{ nullptr }, mappedSize{ 0 }
+#ifdef _WINDOWS
+                , mapping{ nullptr }
+#endif
    {}
+
+   /**
+    * Destructor.
+    */
+   ~Reserved()
+   {
+      release();
+   }
+
+   /**
+    * Gets the base address of the storage.
+    * @return pointer to the first byte of the storage
+    */
+   uint8_t *getStorage() const
+   {
+      return mapped ? mapped : const_cast<uint8_t *>(buffer.data());
+   }
+
+   /**
+    * Releases the storage and the layers, and resets the image description.
+    */
+   void release()
+   {
+      format = Eng::Bitmap::Format::none;
+      nrOfLevels = 0;
+      nrOfSides = 0;
+      compressionFactor = 1.0f;
+      layer.clear();
+      buffer.clear();
+      buffer.shrink_to_fit();
+      if (mapped)
+      {
+      #ifdef _WINDOWS
+         UnmapViewOfFile(mapped);
+         CloseHandle(mapping);
+         mapping = nullptr;
+      #else
+         munmap(mapped, mappedSize);
+      #endif
+         mapped = nullptr;
+         mappedSize = 0;
+      }
+   }
+
+   /**
+    * Maps a file into memory (copy-on-write, the file is never modified).
+    * @param filename file name
+    * @return TF
+    */
+   bool map(const std::string &filename)
+   {
+   #ifdef _WINDOWS
+      HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+      if (file == INVALID_HANDLE_VALUE)
+         return false;
+      LARGE_INTEGER size;
+      GetFileSizeEx(file, &size);
+      mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+      CloseHandle(file);
+      if (mapping == nullptr)
+         return false;
+      mapped = static_cast<uint8_t *>(MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0));
+      if (mapped == nullptr)
+      {
+         CloseHandle(mapping);
+         mapping = nullptr;
+         return false;
+      }
+      mappedSize = static_cast<uint64_t>(size.QuadPart);
+   #else
+      int fd = open(filename.c_str(), O_RDONLY);
+      if (fd < 0)
+         return false;
+      struct stat st;
+      if (fstat(fd, &st) != 0 || st.st_size == 0)
+      {
+         close(fd);
+         return false;
+      }
+      void *ptr = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+      close(fd);
+      if (ptr == MAP_FAILED)
+         return false;
+      mapped = static_cast<uint8_t *>(ptr);
+      mappedSize = static_cast<uint64_t>(st.st_size);
+   #endif
+
+      // Done:
+      return true;
+   }
 };
 
 
@@ -260,7 +375,7 @@ uint8_t ENG_API *Eng::Bitmap::getData(uint32_t level, uint32_t side) const
       return nullptr;
    }
 
-   return reserved->layer[side * reserved->nrOfLevels + level].data.data();
+   return reserved->getStorage() + reserved->layer[side * reserved->nrOfLevels + level].offset;
 }
 
 
@@ -280,7 +395,7 @@ uint32_t ENG_API Eng::Bitmap::getNrOfBytes(uint32_t level, uint32_t side) const
       return 0;
    }
 
-   return static_cast<uint32_t>(reserved->layer[side * reserved->nrOfLevels + level].data.size());
+   return reserved->layer[side * reserved->nrOfLevels + level].nrOfBytes;
 }
 
 
@@ -315,21 +430,22 @@ bool ENG_API Eng::Bitmap::load(Format format, uint32_t sizeX, uint32_t sizeY, ui
    uint64_t size = (uint64_t) sizeX * (uint64_t) sizeY * (uint64_t) colorDepth;
 
    // Free previous image?
-   reserved->layer.clear();  
+   reserved->release();  
    
    // Force single image:
    reserved->format = format;
    reserved->nrOfSides = 1;
    reserved->nrOfLevels = 1; 
 
-   // Allocate and populate layer:   
+   // Allocate and populate storage:   
+   reserved->buffer.resize(size);
+   memcpy(reserved->buffer.data(), data, size); 
+   
+   // Store layer:
    Reserved::Layer l;   
    l.size.x = sizeX;
    l.size.y = sizeY;
-   l.data.resize(size);         
-   memcpy(l.data.data(), data, size); 
-   
-   // Store layer:
+   l.nrOfBytes = static_cast<uint32_t>(size);
    reserved->layer.push_back(l);   
    
    // Done:   
@@ -340,11 +456,13 @@ bool ENG_API Eng::Bitmap::load(Format format, uint32_t sizeX, uint32_t sizeY, ui
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
- * Load image from a .dds file.
+ * Load image from a .dds file. The file content is kept as a single contiguous storage (either read or memory-mapped),
+ * and levels/sides are only referenced through an offset table: no per-level copy is performed.
  * @param filename DDS file name
+ * @param mapped when true, the file is memory-mapped instead of read
  * @return TF
  */
-bool ENG_API Eng::Bitmap::load(const std::string &filename)
+bool ENG_API Eng::Bitmap::load(const std::string &filename, bool mapped)
 {
    // Safety net:
    if (filename.empty())
@@ -354,29 +472,96 @@ bool ENG_API Eng::Bitmap::load(const std::string &filename)
    }
   
    // Free previous image?
-   reserved->layer.clear();  
+   reserved->release();  
+
+   // Map file to memory:
+   uint64_t filesize = 0;
+   if (mapped)
+   {
+      if (!reserved->map(filename))
+      {
+         ENG_LOG_ERROR("Unable to map file '%s'", filename.c_str());
+         return false;
+      }
+      filesize = reserved->mappedSize;
+   }
 
-   // Get file size:
-   FILE *dat = fopen(filename.c_str(), "rb");
-   if (dat == nullptr)
+   // ...or copy it:
+   else
+   {
+      FILE *dat = fopen(filename.c_str(), "rb");
+      if (dat == nullptr)
+      {
+         ENG_LOG_ERROR("File '%s' not found", filename.c_str());
+         return false;
+      }
+      fseek(dat, 0, SEEK_END);
+      filesize = ftell(dat);
+      fseek(dat, 0, SEEK_SET);
+
+      reserved->buffer.resize(filesize);
+      if (fread(reserved->buffer.data(), sizeof(uint8_t), filesize, dat) != filesize)
+      {
+         ENG_LOG_ERROR("File '%s' damaged", filename.c_str());
+         fclose(dat);
+         reserved->release();
+         return false;
+      }
+      fclose(dat);
+   }
+
+   // Done:
+   return parseDds(filesize, filename);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Load image from a DDS file already in memory (e.g., embedded in a cooked scene). The data is copied into the 
+ * bitmap storage.
+ * @param data pointer to the DDS file content
+ * @param nrOfBytes size of the DDS file content
+ * @param name bitmap name
+ * @return TF
+ */
+bool ENG_API Eng::Bitmap::load(const void *data, uint64_t nrOfBytes, const std::string &name)
+{
+   // Safety net:
+   if (data == nullptr || nrOfBytes == 0)
    {
-      ENG_LOG_ERROR("File '%s' not found", filename.c_str());
+      ENG_LOG_ERROR("Invalid params");
       return false;
    }
-   fseek(dat, 0, SEEK_END);
-   uint64_t filesize = ftell(dat);
-   fseek(dat, 0, SEEK_SET);
-
-   // Copy file to memory:
-   std::vector<uint8_t> data(filesize);
-   uint8_t *position = data.data();
-   if (fread(position, sizeof(uint8_t), filesize, dat) != filesize)
+
+   // Free previous image?
+   reserved->release();
+
+   // Copy to storage:
+   const uint8_t *ptr = static_cast<const uint8_t *>(data);
+   reserved->buffer.assign(ptr, ptr + nrOfBytes);
+
+   // Done:
+   return parseDds(nrOfBytes, name);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Parses the DDS content of the storage and builds the offset table.
+ * @param filesize size of the DDS content
+ * @param filename name used for logging and as bitmap name
+ * @return TF
+ */
+bool ENG_API Eng::Bitmap::parseDds(uint64_t filesize, const std::string &filename)
+{
+   uint8_t *storage = reserved->getStorage();
+   uint8_t *position = storage;
+   if (filesize < sizeof(uint32_t) + sizeof(DDS_HEADER))
    {
       ENG_LOG_ERROR("File '%s' damaged", filename.c_str());
-      fclose(dat);
+      reserved->release();
       return false;
    }
-   fclose(dat);
 
    // Check header:   
    uint32_t magicNumber;
@@ -384,6 +569,7 @@ bool ENG_API Eng::Bitmap::load(const std::string &filename)
    if (magicNumber != DDS_MAGICNUMBER)
    {
       ENG_LOG_ERROR("File '%s' is not a valid DDS", filename.c_str());      
+      reserved->release();
       return false;
    }
 
@@ -408,6 +594,7 @@ bool ENG_API Eng::Bitmap::load(const std::string &filename)
       if (!complete)
       {
          ENG_LOG_ERROR("File '%s' is an incomplete cubemap", filename.c_str());         
+         reserved->release();
          return false;
       }
       reserved->nrOfSides = 6;
@@ -434,6 +621,12 @@ bool ENG_API Eng::Bitmap::load(const std::string &filename)
                if (strcmp(fourCC, "DX10") == 0)
                {
                   // Get header10:
+                  if (filesize < sizeof(uint32_t) + sizeof(DDS_HEADER) + sizeof(DDS_HEADER10))
+                  {
+                     ENG_LOG_ERROR("File '%s' damaged", filename.c_str());
+                     reserved->release();
+                     return false;
+                  }
                   DDS_HEADER10 *header10 = reinterpret_cast<DDS_HEADER10 *> (position); position += sizeof(DDS_HEADER10);
 
                   // Cube map (new format)?
@@ -457,12 +650,14 @@ bool ENG_API Eng::Bitmap::load(const std::string &filename)
 
                      default:
                         ENG_LOG_ERROR("File '%s' uses an unsupported DX10 compression format", filename.c_str());                                                
+                        reserved->release();
                         return false;
                   }
                }
                else
                {
                   ENG_LOG_ERROR("File '%s' uses an unsupported compression format", filename.c_str());                  
+                  reserved->release();
                   return false;
                }   
    
@@ -474,8 +669,9 @@ bool ENG_API Eng::Bitmap::load(const std::string &filename)
       case Eng::Bitmap::Format::r8g8b8a8_compressed:   reserved->compressionFactor = 1.0f; break;
    }
 
-   // Allocate and populate layers:   
+   // Build the offset table:   
    Reserved::Layer l;   
+   reserved->layer.reserve(reserved->nrOfSides * reserved->nrOfLevels);
    for (uint32_t s = 0; s < reserved->nrOfSides; s++)
    {  
       uint32_t sizeX = header->dwWidth;
@@ -495,8 +691,15 @@ bool ENG_API Eng::Bitmap::load(const std::string &filename)
             levelSize = 8;
          if (reserved->compressionFactor == 1.0f && levelSize < 16)
             levelSize = 16;
-         curLayer.data.resize(levelSize);         
-         memcpy(curLayer.data.data(), position, levelSize); position += levelSize;
+         curLayer.offset = static_cast<uint64_t>(position - storage);
+         curLayer.nrOfBytes = levelSize;
+         position += levelSize;
+         if (curLayer.offset + levelSize > filesize)
+         {
+            ENG_LOG_ERROR("File '%s' is truncated", filename.c_str());
+            reserved->release();
+            return false;
+         }
 
          ENG_LOG_DEBUG("Mipmap: %u, %ux%u, %u bytes", c, sizeX, sizeY, levelSize);
 
@@ -62,7 +62,8 @@ public: //
    float getCompressionFactor() const;
 
    // Loaders:
-   bool load(const std::string &filename);
+   bool load(const std::string &filename, bool mapped = false);
+   bool load(const void *data, uint64_t nrOfBytes, const std::string &name);
    bool load(Format format, uint32_t sizeX, uint32_t sizeY, uint8_t *data);
 
 
@@ -76,4 +77,7 @@ private: //
 
    // Const/dest:
    Bitmap(const std::string &name);
+
+   // Loaders:
+   bool parseDds(uint64_t filesize, const std::string &filename);
 };
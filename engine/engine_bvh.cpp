@@ -0,0 +1,691 @@
+/**
+ * @file		engine_bvh.cpp
+ * @brief	Dynamic bounding volume hierarchy for scene queries
+ *
+ * @author	Achille Peternier (achille.peternier@supsi.ch), (C) SUPSI
+ */
+
+
+
+//////////////
+// #INCLUDE //
+//////////////
+
+   // Main include:
+   #include "engine.h"
+
+   // C/C++:
+   #include <algorithm>
+
+
+
+////////////
+// STATIC //
+////////////
+
+   // Special values:
+   Eng::Bvh Eng::Bvh::empty("[empty]");
+
+   // Null node index:
+   static constexpr int32_t bvhNull = -1;
+
+
+
+/////////////////////////
+// RESERVED STRUCTURES //
+/////////////////////////
+
+/**
+ * @brief Bvh reserved structure.
+ */
+struct Eng::Bvh::Reserved
+{
+   /**
+    * @brief Tree node (leaves are the proxies).
+    */
+   struct Node
+   {
+      Eng::Bvh::Aabb box;                                ///< Bounding box (fat for leaves)
+      int32_t parent;                                    ///< Parent node, or next free node when unused
+      int32_t child1;                                    ///< First child (bvhNull for leaves)
+      int32_t child2;                                    ///< Second child
+      int32_t height;                                    ///< Leaves are at 0, free nodes at -1
+      const Eng::Object *object;                         ///< Referenced object (leaves only)
+
+      /**
+       * Tells whether the node is a leaf.
+       * @return TF
+       */
+      bool isLeaf() const
+      {
+         return child1 == bvhNull;
+      }
+   };
+
+   std::vector<Node> node;                               ///< Node pool
+   int32_t root;                                         ///< Root node
+   int32_t freeList;                                     ///< First unused node
+   uint32_t nrOfProxies;                                 ///< Number of leaves
+   float margin;                                         ///< Relative enlargement of the leaf boxes
+   mutable std::vector<int32_t> stack;                   ///< Traversal stack
+
+
+   /**
+    * Constructor.
+    */
+   Reserved() : root{ bvhNull }, freeList{ bvhNull }, nrOfProxies{ 0 }, margin{ Eng::Bvh::dfltMargin }
+   {}
+
+   /**
+    * Gets an unused node from the pool.
+    * @return node index
+    */
+   int32_t allocate()
+   {
+      if (freeList == bvhNull)
+      {
+         node.push_back(Node());
+         node.back().parent = bvhNull;
+         freeList = static_cast<int32_t>(node.size() - 1);
+      }
+      const int32_t id = freeList;
+      freeList = node[id].parent;
+      node[id].parent = bvhNull;
+      node[id].child1 = bvhNull;
+      node[id].child2 = bvhNull;
+      node[id].height = 0;
+      node[id].object = nullptr;
+      return id;
+   }
+
+   /**
+    * Returns a node to the pool.
+    * @param id node index
+    */
+   void release(int32_t id)
+   {
+      node[id].parent = freeList;
+      node[id].height = -1;
+      node[id].object = nullptr;
+      freeList = id;
+   }
+
+   /**
+    * Performs a left or right rotation if the node is imbalanced.
+    * @param a node index
+    * @return new root of the subtree
+    */
+   int32_t balance(int32_t a)
+   {
+      Node &A = node[a];
+      if (A.isLeaf() || A.height < 2)
+         return a;
+
+      const int32_t b = A.child1;
+      const int32_t c = A.child2;
+      const int32_t diff = node[c].height - node[b].height;
+
+      // Rotate c (or b) up:
+      if (diff > 1 || diff < -1)
+      {
+         const int32_t up = (diff > 1) ? c : b;
+         const int32_t other = (diff > 1) ? b : c;
+         Node &U = node[up];
+         const int32_t f = U.child1;
+         const int32_t g = U.child2;
+
+         U.child1 = a;
+         U.parent = A.parent;
+         A.parent = up;
+         if (U.parent != bvhNull)
+         {
+            if (node[U.parent].child1 == a)
+               node[U.parent].child1 = up;
+            else
+               node[U.parent].child2 = up;
+         }
+         else
+            root = up;
+
+         // Keep the taller grandchild under the promoted node:
+         const int32_t keep = (node[f].height > node[g].height) ? f : g;
+         const int32_t give = (keep == f) ? g : f;
+         U.child2 = keep;
+         if (diff > 1)
+            A.child2 = give;
+         else
+            A.child1 = give;
+         node[give].parent = a;
+
+         A.box = Eng::Bvh::Aabb::merge(node[other].box, node[give].box);
+         A.height = 1 + std::max(node[other].height, node[give].height);
+         U.box = Eng::Bvh::Aabb::merge(A.box, node[keep].box);
+         U.height = 1 + std::max(A.height, node[keep].height);
+         return up;
+      }
+
+      return a;
+   }
+
+   /**
+    * Refits and rebalances the ancestors of the given node.
+    * @param id node index
+    */
+   void refit(int32_t id)
+   {
+      while (id != bvhNull)
+      {
+         id = balance(id);
+         Node &n = node[id];
+         n.box = Eng::Bvh::Aabb::merge(node[n.child1].box, node[n.child2].box);
+         n.height = 1 + std::max(node[n.child1].height, node[n.child2].height);
+         id = n.parent;
+      }
+   }
+
+   /**
+    * Inserts a leaf, choosing the sibling with the lowest surface area cost.
+    * @param leaf leaf index
+    */
+   void insertLeaf(int32_t leaf)
+   {
+      if (root == bvhNull)
+      {
+         root = leaf;
+         node[root].parent = bvhNull;
+         return;
+      }
+
+      // Find the best sibling (copy, as allocate() may grow the pool):
+      const Eng::Bvh::Aabb box = node[leaf].box;
+      int32_t index = root;
+      while (!node[index].isLeaf())
+      {
+         const Node &n = node[index];
+         const float area = n.box.getArea();
+         const float combinedArea = Eng::Bvh::Aabb::merge(n.box, box).getArea();
+         const float cost = 2.0f * combinedArea;
+         const float inheritance = 2.0f * (combinedArea - area);
+
+         float childCost[2];
+         const int32_t child[2] = { n.child1, n.child2 };
+         for (uint32_t c = 0; c < 2; c++)
+         {
+            const Node &ch = node[child[c]];
+            const float merged = Eng::Bvh::Aabb::merge(ch.box, box).getArea();
+            childCost[c] = ch.isLeaf() ? merged + inheritance : (merged - ch.box.getArea()) + inheritance;
+         }
+         if (cost < childCost[0] && cost < childCost[1])
+            break;
+         index = (childCost[0] < childCost[1]) ? child[0] : child[1];
+      }
+
+      // New parent:
+      const int32_t sibling = index;
+      const int32_t oldParent = node[sibling].parent;
+      const int32_t newParent = allocate();
+      node[newParent].parent = oldParent;
+      node[newParent].box = Eng::Bvh::Aabb::merge(box, node[sibling].box);
+      node[newParent].height = node[sibling].height + 1;
+      node[newParent].child1 = sibling;
+      node[newParent].child2 = leaf;
+      node[sibling].parent = newParent;
+      node[leaf].parent = newParent;
+      if (oldParent != bvhNull)
+      {
+         if (node[oldParent].child1 == sibling)
+            node[oldParent].child1 = newParent;
+         else
+            node[oldParent].child2 = newParent;
+      }
+      else
+         root = newParent;
+
+      refit(node[leaf].parent);
+   }
+
+   /**
+    * Detaches a leaf from the tree (the leaf node itself is kept).
+    * @param leaf leaf index
+    */
+   void removeLeaf(int32_t leaf)
+   {
+      if (leaf == root)
+      {
+         root = bvhNull;
+         return;
+      }
+
+      const int32_t parent = node[leaf].parent;
+      const int32_t grandParent = node[parent].parent;
+      const int32_t sibling = (node[parent].child1 == leaf) ? node[parent].child2 : node[parent].child1;
+      if (grandParent != bvhNull)
+      {
+         if (node[grandParent].child1 == parent)
+            node[grandParent].child1 = sibling;
+         else
+            node[grandParent].child2 = sibling;
+         node[sibling].parent = grandParent;
+         release(parent);
+         refit(grandParent);
+      }
+      else
+      {
+         root = sibling;
+         node[sibling].parent = bvhNull;
+         release(parent);
+      }
+   }
+
+   /**
+    * Tells whether the given proxy is a valid leaf.
+    * @param proxy leaf index
+    * @return TF
+    */
+   bool isValid(Eng::Bvh::Proxy proxy) const
+   {
+      return proxy < node.size() && node[proxy].height == 0 && node[proxy].object != nullptr;
+   }
+
+   /**
+    * Generic traversal: collects the leaves whose box passes the given test.
+    * @param test box test
+    * @param result filled with the proxies found
+    * @return number of proxies found
+    */
+   template <typename T>
+   uint32_t query(const T &test, std::vector<Eng::Bvh::Proxy> &result) const
+   {
+      const size_t begin = result.size();
+      if (root == bvhNull)
+         return 0;
+      stack.clear();
+      stack.push_back(root);
+      while (!stack.empty())
+      {
+         const int32_t id = stack.back();
+         stack.pop_back();
+         const Node &n = node[id];
+         if (!test(n.box))
+            continue;
+         if (n.isLeaf())
+            result.push_back(static_cast<Eng::Bvh::Proxy>(id));
+         else
+         {
+            stack.push_back(n.child1);
+            stack.push_back(n.child2);
+         }
+      }
+      return static_cast<uint32_t>(result.size() - begin);
+   }
+};
+
+
+
+//////////////////////////////
+// BODY OF STRUCT Bvh::Aabb //
+//////////////////////////////
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Tells whether this box fully contains the other one.
+ * @param other other box
+ * @return TF
+ */
+bool ENG_API Eng::Bvh::Aabb::contains(const Aabb &other) const
+{
+   return glm::all(glm::lessThanEqual(min, other.min)) && glm::all(glm::greaterThanEqual(max, other.max));
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Tells whether this box overlaps the other one.
+ * @param other other box
+ * @return TF
+ */
+bool ENG_API Eng::Bvh::Aabb::overlaps(const Aabb &other) const
+{
+   return glm::all(glm::lessThanEqual(min, other.max)) && glm::all(glm::greaterThanEqual(max, other.min));
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the surface area of the box.
+ * @return surface area
+ */
+float ENG_API Eng::Bvh::Aabb::getArea() const
+{
+   const glm::vec3 d = max - min;
+   return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the box enclosing both the given ones.
+ * @param a first box
+ * @param b second box
+ * @return merged box
+ */
+Eng::Bvh::Aabb ENG_API Eng::Bvh::Aabb::merge(const Aabb &a, const Aabb &b)
+{
+   return Aabb(glm::min(a.min, b.min), glm::max(a.max, b.max));
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the axis-aligned box enclosing the given box transformed by the given matrix (Arvo's method).
+ * @param box box in local coordinates
+ * @param matrix transformation
+ * @return transformed box
+ */
+Eng::Bvh::Aabb ENG_API Eng::Bvh::Aabb::transform(const Aabb &box, const glm::mat4 &matrix)
+{
+   Aabb result{ glm::vec3(matrix[3]), glm::vec3(matrix[3]) };
+   for (uint32_t c = 0; c < 3; c++)
+   {
+      const glm::vec3 a = glm::vec3(matrix[c]) * box.min[c];
+      const glm::vec3 b = glm::vec3(matrix[c]) * box.max[c];
+      result.min += glm::min(a, b);
+      result.max += glm::max(a, b);
+   }
+   return result;
+}
+
+
+
+///////////////////////
+// BODY OF CLASS Bvh //
+///////////////////////
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Constructor.
+ */
+ENG_API Eng::Bvh::Bvh() : reserved(std::make_unique<Eng::Bvh::Reserved>())
+{
+   ENG_LOG_DETAIL("[+]");
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Constructor with name.
+ * @param name node name
+ */
+ENG_API Eng::Bvh::Bvh(const std::string &name) : Eng::Object(name), reserved(std::make_unique<Eng::Bvh::Reserved>())
+{
+   ENG_LOG_DETAIL("[+]");
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Move constructor.
+ */
+ENG_API Eng::Bvh::Bvh(Bvh &&other) : Eng::Object(std::move(other)), reserved(std::move(other.reserved))
+{
+   ENG_LOG_DETAIL("[M]");
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Destructor.
+ */
+ENG_API Eng::Bvh::~Bvh()
+{
+   ENG_LOG_DETAIL("[-]");
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Sets the enlargement applied to the leaf boxes. Larger margins mean fewer reinsertions but looser queries.
+ * @param margin enlargement, relative to the box size
+ */
+void ENG_API Eng::Bvh::setMargin(float margin)
+{
+   // Safety net:
+   if (margin < 0.0f)
+   {
+      ENG_LOG_ERROR("Invalid params");
+      return;
+   }
+
+   reserved->margin = margin;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the enlargement applied to the leaf boxes.
+ * @return enlargement, relative to the box size
+ */
+float ENG_API Eng::Bvh::getMargin() const
+{
+   return reserved->margin;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the number of objects stored in the tree.
+ * @return number of proxies
+ */
+uint32_t ENG_API Eng::Bvh::getNrOfProxies() const
+{
+   return reserved->nrOfProxies;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the height of the tree.
+ * @return height (0 if empty or with a single leaf)
+ */
+uint32_t ENG_API Eng::Bvh::getHeight() const
+{
+   if (reserved->root == bvhNull)
+      return 0;
+   return static_cast<uint32_t>(reserved->node[reserved->root].height);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the object referenced by a proxy.
+ * @param proxy proxy
+ * @return object or Object::empty if the proxy is invalid
+ */
+const Eng::Object ENG_API &Eng::Bvh::getObject(Proxy proxy) const
+{
+   if (!reserved->isValid(proxy))
+      return Eng::Object::empty;
+   return *reserved->node[proxy].object;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the (enlarged) box stored for a proxy.
+ * @param proxy proxy
+ * @return fat box
+ */
+const Eng::Bvh::Aabb ENG_API &Eng::Bvh::getFatAabb(Proxy proxy) const
+{
+   static const Aabb none;
+   if (!reserved->isValid(proxy))
+      return none;
+   return reserved->node[proxy].box;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Inserts an object into the tree.
+ * @param box world-space bounding box of the object
+ * @param object referenced object (must outlive its proxy)
+ * @return proxy or invalidProxy if error
+ */
+Eng::Bvh::Proxy ENG_API Eng::Bvh::insert(const Aabb &box, const Eng::Object &object)
+{
+   // Safety net:
+   if (object == Eng::Object::empty)
+   {
+      ENG_LOG_ERROR("Invalid params");
+      return invalidProxy;
+   }
+
+   const int32_t leaf = reserved->allocate();
+   const glm::vec3 fat = (box.max - box.min) * reserved->margin;
+   reserved->node[leaf].box = Aabb(box.min - fat, box.max + fat);
+   reserved->node[leaf].object = &object;
+   reserved->insertLeaf(leaf);
+   reserved->nrOfProxies++;
+
+   // Done:
+   return static_cast<Proxy>(leaf);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Removes an object from the tree.
+ * @param proxy proxy returned by insert()
+ * @return TF
+ */
+bool ENG_API Eng::Bvh::remove(Proxy proxy)
+{
+   // Safety net:
+   if (!reserved->isValid(proxy))
+   {
+      ENG_LOG_ERROR("Invalid params");
+      return false;
+   }
+
+   reserved->removeLeaf(static_cast<int32_t>(proxy));
+   reserved->release(static_cast<int32_t>(proxy));
+   reserved->nrOfProxies--;
+
+   // Done:
+   return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Updates the bounds of an object. Nothing happens while the new box stays within the stored fat box, otherwise the
+ * leaf is reinserted and its ancestors refitted.
+ * @param proxy proxy returned by insert()
+ * @param box new world-space bounding box
+ * @return true if the tree changed, false otherwise
+ */
+bool ENG_API Eng::Bvh::move(Proxy proxy, const Aabb &box)
+{
+   // Safety net:
+   if (!reserved->isValid(proxy))
+   {
+      ENG_LOG_ERROR("Invalid params");
+      return false;
+   }
+
+   Reserved::Node &leaf = reserved->node[proxy];
+   if (leaf.box.contains(box))
+      return false;
+
+   reserved->removeLeaf(static_cast<int32_t>(proxy));
+   const glm::vec3 fat = (box.max - box.min) * reserved->margin;
+   reserved->node[proxy].box = Aabb(box.min - fat, box.max + fat);
+   reserved->insertLeaf(static_cast<int32_t>(proxy));
+
+   // Done:
+   return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Removes all the objects.
+ */
+void ENG_API Eng::Bvh::reset()
+{
+   reserved->node.clear();
+   reserved->root = bvhNull;
+   reserved->freeList = bvhNull;
+   reserved->nrOfProxies = 0;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Finds the objects whose box is (at least partially) inside a view frustum.
+ * @param viewProjMatrix projection * view matrix defining the frustum
+ * @param result proxies found are appended here
+ * @return number of proxies found
+ */
+uint32_t ENG_API Eng::Bvh::queryFrustum(const glm::mat4 &viewProjMatrix, std::vector<Proxy> &result) const
+{
+   // Planes (Gribb/Hartmann):
+   const glm::mat4 m = glm::transpose(viewProjMatrix);
+   const glm::vec4 plane[6] = { m[3] + m[0], m[3] - m[0], m[3] + m[1], m[3] - m[1], m[3] + m[2], m[3] - m[2] };
+
+   return reserved->query([&plane](const Aabb &box)
+   {
+      for (const auto &p : plane)
+      {
+         // Corner farthest along the plane normal:
+         const glm::vec3 v(p.x >= 0.0f ? box.max.x : box.min.x, p.y >= 0.0f ? box.max.y : box.min.y, p.z >= 0.0f ? box.max.z : box.min.z);
+         if (glm::dot(glm::vec3(p), v) + p.w < 0.0f)
+            return false;
+      }
+      return true;
+   }, result);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Finds the objects whose box intersects a sphere.
+ * @param center sphere center
+ * @param radius sphere radius
+ * @param result proxies found are appended here
+ * @return number of proxies found
+ */
+uint32_t ENG_API Eng::Bvh::querySphere(const glm::vec3 &center, float radius, std::vector<Proxy> &result) const
+{
+   const float radius2 = radius * radius;
+   return reserved->query([&center, radius2](const Aabb &box)
+   {
+      const glm::vec3 d = glm::clamp(center, box.min, box.max) - center;
+      return glm::dot(d, d) <= radius2;
+   }, result);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Finds the objects whose box is crossed by a ray (slab test).
+ * @param origin ray origin
+ * @param direction ray direction (not necessarily normalized)
+ * @param maxDistance max parametric distance along the direction
+ * @param result proxies found are appended here
+ * @return number of proxies found
+ */
+uint32_t ENG_API Eng::Bvh::queryRay(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance, std::vector<Proxy> &result) const
+{
+   const glm::vec3 invDir = 1.0f / direction;
+   return reserved->query([&origin, &invDir, maxDistance](const Aabb &box)
+   {
+      const glm::vec3 t0 = (box.min - origin) * invDir;
+      const glm::vec3 t1 = (box.max - origin) * invDir;
+      const glm::vec3 tMin = glm::min(t0, t1);
+      const glm::vec3 tMax = glm::max(t0, t1);
+      const float enter = glm::max(glm::max(tMin.x, tMin.y), glm::max(tMin.z, 0.0f));
+      const float exit = glm::min(glm::min(tMax.x, tMax.y), glm::min(tMax.z, maxDistance));
+      return enter <= exit;
+   }, result);
+}
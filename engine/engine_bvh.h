@@ -0,0 +1,107 @@
+/**
+ * @file		engine_bvh.h
+ * @brief	Dynamic bounding volume hierarchy for scene queries
+ *
+ * @author	Achille Peternier (achille.peternier@supsi.ch), (C) SUPSI
+ */
+#pragma once
+
+
+
+/**
+ * @brief Dynamic bounding volume hierarchy (AABB tree) over world-space object bounds. Leaves store enlarged ("fat")
+ *        boxes, so that small movements only require a refit-free check, while larger ones remove and reinsert the
+ *        leaf. The tree is kept balanced by rotations. Supports frustum, sphere and ray queries.
+ */
+class ENG_API Bvh final : public Eng::Object
+{
+//////////
+public: //
+//////////
+
+   // Special values:
+   static Bvh empty;
+
+   // Consts:
+   static constexpr float dfltMargin = 0.1f;             ///< Default enlargement of the leaf boxes (relative to their size)
+
+
+   /**
+    * @brief Handle to a leaf.
+    */
+   typedef uint32_t Proxy;
+   static constexpr Proxy invalidProxy = 0xFFFFFFFF;     ///< Returned on error
+
+
+   /**
+    * @brief Axis-aligned bounding box.
+    */
+   struct Aabb
+   {
+      glm::vec3 min;       ///< Minimum corner
+      glm::vec3 max;       ///< Maximum corner
+
+
+      /**
+       * Constructor.
+       */
+      Aabb() : min{ 0.0f }, max{ 0.0f }
+      {}
+
+      /**
+       * Constructor with corners.
+       * @param _min minimum corner
+       * @param _max maximum corner
+       */
+      Aabb(const glm::vec3 &_min, const glm::vec3 &_max) : min{ _min }, max{ _max }
+      {}
+
+      // Helpers:
+      bool contains(const Aabb &other) const;
+      bool overlaps(const Aabb &other) const;
+      float getArea() const;
+      static Aabb merge(const Aabb &a, const Aabb &b);
+      static Aabb transform(const Aabb &box, const glm::mat4 &matrix);
+   };
+
+
+   // Const/dest:
+   Bvh();
+   Bvh(Bvh &&other);
+   Bvh(Bvh const &) = delete;
+   virtual ~Bvh();
+
+   // Get/set:
+   void setMargin(float margin);
+   float getMargin() const;
+   uint32_t getNrOfProxies() const;
+   uint32_t getHeight() const;
+   const Eng::Object &getObject(Proxy proxy) const;
+   const Aabb &getFatAabb(Proxy proxy) const;
+
+   // Management:
+   Proxy insert(const Aabb &box, const Eng::Object &object);
+   bool remove(Proxy proxy);
+   bool move(Proxy proxy, const Aabb &box);
+   void reset();
+
+   // Queries:
+   uint32_t queryFrustum(const glm::mat4 &viewProjMatrix, std::vector<Proxy> &result) const;
+   uint32_t querySphere(const glm::vec3 &center, float radius, std::vector<Proxy> &result) const;
+   uint32_t queryRay(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance, std::vector<Proxy> &result) const;
+
+
+///////////
+private: //
+///////////
+
+   // Reserved:
+   struct Reserved;
+   std::unique_ptr<Reserved> reserved;
+
+   // Const/dest:
+   Bvh(const std::string &name);
+
+   // Workaround for disabling the unneeded rendering method:
+   using Object::render;
+};
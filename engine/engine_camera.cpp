@@ -143,8 +143,10 @@ Eng::Camera ENG_API &Eng::Camera::getCached()
  */
 bool ENG_API Eng::Camera::render(uint32_t value, void *data) const
 {	
+   // Programs reading the frame uniform block get the projection from the pipeline:
    Eng::Program &program = dynamic_cast<Eng::Program &>(Eng::Program::getCached());
-   program.setMat4("projectionMat", reserved->projMatrix);
+   if (!program.hasUniformBlock(Eng::Ubo::frameBinding))
+      program.setMat4("projectionMat", reserved->projMatrix);
    
    // Done:
    Eng::Camera::cache = const_cast<Eng::Camera &>(*this);
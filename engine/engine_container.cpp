@@ -16,6 +16,9 @@
 
    // C/C++:
    #include <algorithm>
+   #include <future>
+   #include <map>
+   #include <mutex>
    #include <variant>
 
 
@@ -38,12 +41,26 @@
  */
 struct Eng::Container::Reserved
 {
+   /**
+    * @brief Texture cache entry.
+    */
+   struct CachedTexture
+   {
+      std::reference_wrapper<Eng::Texture> texture;      ///< Texture, stored in allTextures
+      uint32_t refCount;                                 ///< Number of users
+   };
+
    std::list<Eng::Node> allNodes;
    std::list<Eng::Mesh> allMeshes;
    std::list<Eng::Light> allLights;
    std::list<Eng::Material> allMaterials;
    std::list<Eng::Texture> allTextures;
    std::list<Eng::ParticleEmitter> allParticleEmitters;
+
+   // Texture cache:
+   std::map<std::string, CachedTexture> textureCache;    ///< Cached textures, by filename
+   std::map<std::string, std::shared_future<std::shared_ptr<const Eng::Bitmap>>> pendingDecode; ///< Decodes not yet uploaded, by filename (nullptr if failed)
+   mutable std::mutex textureCacheMutex;                 ///< Allows isTextureCached() and decodeTexture() from loader threads
    
 
    /**
@@ -97,6 +114,10 @@ ENG_API Eng::Container::Container(Container &&other) : Eng::Object(std::move(oth
 ENG_API Eng::Container::~Container()
 {
    ENG_LOG_DETAIL("[-]");
+
+   // Materials release their textures into the cache, which must still be alive:
+   if (reserved)
+      reset();
 }
 
 
@@ -349,7 +370,13 @@ bool ENG_API Eng::Container::reset()
    reserved->allNodes.clear();
    reserved->allMeshes.clear();   
    reserved->allLights.clear();   
-   reserved->allMaterials.clear();   
+   reserved->allMaterials.clear();   // Before the cache, as materials release their textures
+
+   std::unique_lock<std::mutex> lock(reserved->textureCacheMutex);
+   reserved->textureCache.clear();
+   reserved->pendingDecode.clear();
+   lock.unlock();
+
    reserved->allTextures.clear();  
    reserved->allParticleEmitters.clear();
    
@@ -359,6 +386,191 @@ bool ENG_API Eng::Container::reset()
 }
 
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Decodes an image file for a later acquireTexture(). Each file is decoded only once: concurrent calls for the same 
+ * filename wait for and share the first decode, and a failed decode is not attempted again until reset(). 
+ * Safe to call from any thread.
+ * @param filename image file name
+ * @param bitmap decoded image, nullptr if the texture is already cached or on error
+ * @return TF
+ */
+bool ENG_API Eng::Container::decodeTexture(const std::string &filename, std::shared_ptr<const Eng::Bitmap> &bitmap)
+{
+   bitmap.reset();
+
+   // Safety net:
+   if (filename.empty())
+   {
+      ENG_LOG_ERROR("Invalid params");
+      return false;
+   }
+
+   // Already cached or being decoded?
+   std::unique_lock<std::mutex> lock(reserved->textureCacheMutex);
+   if (reserved->textureCache.find(filename) != reserved->textureCache.end())
+      return true;
+
+   auto it = reserved->pendingDecode.find(filename);
+   if (it != reserved->pendingDecode.end())
+   {
+      std::shared_future<std::shared_ptr<const Eng::Bitmap>> future = it->second;
+      lock.unlock();
+      bitmap = future.get();
+      return bitmap != nullptr;
+   }
+
+   // Decode (outside the lock):
+   std::promise<std::shared_ptr<const Eng::Bitmap>> promise;
+   reserved->pendingDecode.insert(std::make_pair(filename, promise.get_future().share()));
+   lock.unlock();
+
+   std::shared_ptr<Eng::Bitmap> decoded = std::make_shared<Eng::Bitmap>();
+   if (!decoded->load(filename))
+   {
+      ENG_LOG_ERROR("Unable to load image file '%s'", filename.c_str());
+      promise.set_value(nullptr);
+      return false;
+   }
+   promise.set_value(decoded);
+   bitmap = decoded;
+
+   // Done:
+   return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets a texture from the cache, increasing its reference count. On a cache miss, the texture is created from the
+ * given bitmap (or, if none is given, from the decodeTexture() result or by loading the image file) and stored with a 
+ * reference count of one. Each call shall be paired with a releaseTexture().
+ * @param filename image file name (used as cache key and texture name)
+ * @param bitmap optional already decoded image, ignored on a cache hit
+ * @return cached texture or Texture::empty if error
+ */
+Eng::Texture ENG_API &Eng::Container::acquireTexture(const std::string &filename, const Eng::Bitmap *bitmap)
+{
+   // Safety net:
+   if (filename.empty())
+   {
+      ENG_LOG_ERROR("Invalid params");
+      return Eng::Texture::empty;
+   }
+
+   // Cache hit:
+   std::unique_lock<std::mutex> lock(reserved->textureCacheMutex);
+   auto it = reserved->textureCache.find(filename);
+   if (it != reserved->textureCache.end())
+   {
+      it->second.refCount++;
+      return it->second.texture;
+   }
+
+   // Cache miss, use the decodeTexture() result if any (without retrying a failed decode):
+   std::shared_ptr<const Eng::Bitmap> decoded;
+   auto pending = reserved->pendingDecode.find(filename);
+   if (bitmap == nullptr && pending != reserved->pendingDecode.end())
+   {
+      std::shared_future<std::shared_ptr<const Eng::Bitmap>> future = pending->second;
+      lock.unlock();
+      decoded = future.get();
+      lock.lock();
+      if (decoded == nullptr)
+      {
+         ENG_LOG_ERROR("Image file '%s' failed to decode", filename.c_str());
+         return Eng::Texture::empty;
+      }
+      bitmap = decoded.get();
+   }
+
+   // ...otherwise decode if needed:
+   Eng::Bitmap _bitmap;
+   if (bitmap == nullptr)
+   {
+      if (!_bitmap.load(filename))
+      {
+         ENG_LOG_ERROR("Unable to load image file '%s'", filename.c_str());
+         return Eng::Texture::empty;
+      }
+      bitmap = &_bitmap;
+   }
+
+   Eng::Texture tex;
+   if (!tex.load(*bitmap))
+   {
+      ENG_LOG_ERROR("Unable to create texture from image file '%s'", filename.c_str());
+      return Eng::Texture::empty;
+   }
+   tex.setName(filename);
+   reserved->allTextures.push_back(std::move(tex));
+   reserved->textureCache.insert(std::make_pair(filename, Reserved::CachedTexture{ reserved->allTextures.back(), 1 }));
+   reserved->pendingDecode.erase(filename);
+
+   // Done:
+   return reserved->allTextures.back();
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Decreases the reference count of a cached texture. The texture is released when no longer used.
+ * @param filename image file name
+ * @return TF
+ */
+bool ENG_API Eng::Container::releaseTexture(const std::string &filename)
+{
+   std::lock_guard<std::mutex> lock(reserved->textureCacheMutex);
+   auto it = reserved->textureCache.find(filename);
+   if (it == reserved->textureCache.end())
+   {
+      ENG_LOG_ERROR("Texture '%s' not cached", filename.c_str());
+      return false;
+   }
+
+   // Still in use?
+   if (--it->second.refCount)
+      return true;
+
+   // Remove:
+   const Eng::Texture *tex = &it->second.texture.get();
+   reserved->allTextures.remove_if([tex](const Eng::Texture &t) { return &t == tex; });
+   reserved->textureCache.erase(it);
+
+   // Done:
+   return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Checks whether a texture is in the cache. Unlike the other cache methods, this one is safe to call from any thread.
+ * @param filename image file name
+ * @return TF
+ */
+bool ENG_API Eng::Container::isTextureCached(const std::string &filename) const
+{
+   std::lock_guard<std::mutex> lock(reserved->textureCacheMutex);
+   return reserved->textureCache.find(filename) != reserved->textureCache.end();
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the reference count of a cached texture.
+ * @param filename image file name
+ * @return reference count, 0 if not cached
+ */
+uint32_t ENG_API Eng::Container::getTextureRefCount(const std::string &filename) const
+{
+   std::lock_guard<std::mutex> lock(reserved->textureCacheMutex);
+   auto it = reserved->textureCache.find(filename);
+   if (it == reserved->textureCache.end())
+      return 0;
+   return it->second.refCount;
+}
+
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
  * Adds the given object to the proper container.
@@ -31,6 +31,13 @@ public: //
    bool add(Eng::Object &obj);
    bool reset();
 
+   // Texture cache:
+   bool decodeTexture(const std::string &filename, std::shared_ptr<const Eng::Bitmap> &bitmap);
+   Eng::Texture &acquireTexture(const std::string &filename, const Eng::Bitmap *bitmap = nullptr);
+   bool releaseTexture(const std::string &filename);
+   bool isTextureCached(const std::string &filename) const;
+   uint32_t getTextureRefCount(const std::string &filename) const;
+
    // Get/set:
    Eng::Node &getLastNode() const;
    Eng::Mesh &getLastMesh() const;   
@@ -0,0 +1,538 @@
+/**
+ * @file		engine_cooked.cpp
+ * @brief	Cooked (ready-to-upload) binary scene format
+ *
+ * @author	Achille Peternier (achille.peternier@supsi.ch), (C) SUPSI
+ */
+
+
+
+//////////////
+// #INCLUDE //
+//////////////
+
+   // Main include:
+   #include "engine.h"
+
+   // C/C++:
+   #include <cstring>
+   #include <map>
+
+
+
+////////////
+// STATIC //
+////////////
+
+   // Magic number:
+   static const char cookedMagic[4] = { 'O', 'V', 'C', 'K' };
+
+   // Alignment of the sections (blobs use Cooked::blobAlignment):
+   static constexpr uint64_t cookedSectionAlignment = 16;
+
+   /**
+    * Rounds up the given offset to the given alignment.
+    * @param offset offset in bytes
+    * @param alignment alignment in bytes (power of two)
+    * @return aligned offset
+    */
+   static uint64_t cookedAlign(uint64_t offset, uint64_t alignment)
+   {
+      return (offset + alignment - 1) & ~(alignment - 1);
+   }
+
+
+
+//////////////////////////
+// BODY OF CLASS Cooked //
+//////////////////////////
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Converts an OVO file (and the DDS files it references) into a cooked file. No OpenGL context is required.
+ * @param ovoFilename source OVO file
+ * @param cookedFilename destination cooked file
+ * @param optimize when true, meshes are optimized for vertex cache, overdraw and fetch (see Mesh::optimize())
+ * @return TF
+ */
+bool ENG_API Eng::Cooked::cook(const std::string &ovoFilename, const std::string &cookedFilename, bool optimize)
+{
+   // Safety net:
+   if (ovoFilename.empty() || cookedFilename.empty())
+   {
+      ENG_LOG_ERROR("Invalid params");
+      return false;
+   }
+
+
+   /////////////////////////////////////////
+   // STEP 1: decode the OVO file (CPU only)
+   Eng::Ovo ovo;
+   Eng::Serializer serial;
+   std::vector<Eng::Ovo::ChunkInfo> table;
+   if (!ovo.open(ovoFilename, serial, table))
+      return false;
+
+   const uint8_t *data = static_cast<const uint8_t *>(serial.getData());
+   std::vector<std::unique_ptr<Eng::Object>> object(table.size());
+   for (uint32_t c = 0; c < table.size(); c++)
+   {
+      object[c] = Eng::Ovo::createObject(table[c].id);
+      if (object[c] == nullptr)
+      {
+         ENG_LOG_WARN("Unknown chunk ID (%u) found: ignored", static_cast<uint32_t>(table[c].id));
+         continue;
+      }
+      Eng::Serializer chunk(data + table[c].position, table[c].size);
+      dynamic_cast<Eng::Ovo *>(object[c].get())->loadChunk(chunk);
+   }
+
+
+   ///////////////////////////
+   // STEP 2: build the arrays
+   std::string strings;
+   std::map<std::string, uint32_t> stringIndex;
+   auto addString = [&strings, &stringIndex](const std::string &text) -> uint32_t
+   {
+      auto it = stringIndex.find(text);
+      if (it != stringIndex.end())
+         return it->second;
+      uint32_t offset = static_cast<uint32_t>(strings.size());
+      strings.append(text.c_str(), text.size() + 1);
+      stringIndex[text] = offset;
+      return offset;
+   };
+
+   std::vector<TextureData> textures;
+   std::vector<std::vector<uint8_t>> textureBlob;
+   std::map<std::string, uint32_t> textureIndex;
+   auto addTexture = [&textures, &textureBlob, &textureIndex, &addString](const std::string &filename) -> uint32_t
+   {
+      if (filename.empty())
+         return Eng::Cooked::none;
+      auto it = textureIndex.find(filename);
+      if (it != textureIndex.end())
+         return it->second;
+
+      // Embed the DDS file as is:
+      FILE *dat = fopen(filename.c_str(), "rb");
+      if (dat == nullptr)
+      {
+         ENG_LOG_ERROR("Unable to open image file '%s'", filename.c_str());
+         return Eng::Cooked::none;
+      }
+      fseek(dat, 0L, SEEK_END);
+      uint64_t length = ftell(dat);
+      fseek(dat, 0L, SEEK_SET);
+      std::vector<uint8_t> blob(length);
+      if (fread(blob.data(), sizeof(uint8_t), length, dat) != length)
+      {
+         ENG_LOG_ERROR("Image file '%s' is corrupted", filename.c_str());
+         fclose(dat);
+         return Eng::Cooked::none;
+      }
+      fclose(dat);
+
+      TextureData t = {};
+      t.name = addString(filename);
+      t.size = length;
+      textures.push_back(t);
+      textureBlob.push_back(std::move(blob));
+      textureIndex[filename] = static_cast<uint32_t>(textures.size() - 1);
+      return static_cast<uint32_t>(textures.size() - 1);
+   };
+
+   std::vector<NodeData> nodes;
+   std::vector<MaterialData> materials;
+   std::vector<MeshData> meshes;
+   std::vector<LightData> lights;
+   std::vector<const Eng::Mesh *> meshSource;
+   std::map<std::string, uint32_t> materialIndex;
+   std::vector<uint32_t> chunkToNode(table.size(), Eng::Cooked::none);
+   for (uint32_t c = 0; c < table.size(); c++)
+   {
+      if (object[c] == nullptr)
+         continue;
+
+      // Material:
+      if (table[c].id == Eng::Ovo::ChunkId::material)
+      {
+         const Eng::Material &mat = dynamic_cast<const Eng::Material &>(*object[c]);
+         MaterialData m = {};
+         m.name = addString(mat.getName());
+         m.texture[0] = addTexture(mat.getTextureFile(Eng::Texture::Type::albedo));
+         m.texture[1] = addTexture(mat.getTextureFile(Eng::Texture::Type::normal));
+         m.texture[2] = addTexture(mat.getTextureFile(Eng::Texture::Type::roughness));
+         m.texture[3] = addTexture(mat.getTextureFile(Eng::Texture::Type::metalness));
+         m.opacity = mat.getOpacity();
+         m.roughness = mat.getRoughness();
+         m.metalness = mat.getMetalness();
+         m.emission = mat.getEmission();
+         m.albedo = mat.getAlbedo();
+         materialIndex[mat.getName()] = static_cast<uint32_t>(materials.size());
+         materials.push_back(m);
+         continue;
+      }
+
+      // Scene graph elements:
+      const Eng::Node &node = dynamic_cast<const Eng::Node &>(*object[c]);
+      NodeData n = {};
+      n.name = addString(node.getName());
+      n.parent = (table[c].parent < 0) ? Eng::Cooked::none : chunkToNode[table[c].parent];
+      n.matrix = node.getMatrix();
+      n.type = NodeType::node;
+      n.index = Eng::Cooked::none;
+      if (table[c].id == Eng::Ovo::ChunkId::mesh)
+      {
+         Eng::Mesh &mesh = dynamic_cast<Eng::Mesh &>(*object[c]);
+         if (optimize)
+            mesh.optimize();
+
+         MeshData m = {};
+         auto it = materialIndex.find(mesh.getMaterialName());
+         m.material = (it == materialIndex.end()) ? Eng::Cooked::none : it->second;
+         m.radius = mesh.getRadius();
+         m.bboxMin = mesh.getBBoxMin();
+         m.bboxMax = mesh.getBBoxMax();
+         m.nrOfVertices = static_cast<uint32_t>(mesh.getVertexData().size());
+         m.nrOfFaces = static_cast<uint32_t>(mesh.getFaceData().size());
+         m.nrOfLods = mesh.getNrOfLods();
+         n.type = NodeType::mesh;
+         n.index = static_cast<uint32_t>(meshes.size());
+         meshes.push_back(m);
+         meshSource.push_back(&mesh);
+      }
+      else if (table[c].id == Eng::Ovo::ChunkId::light)
+      {
+         const Eng::Light &light = dynamic_cast<const Eng::Light &>(node);
+         LightData l = {};
+         l.color = light.getColor();
+         l.ambient = light.getAmbient();
+         n.type = NodeType::light;
+         n.index = static_cast<uint32_t>(lights.size());
+         lights.push_back(l);
+      }
+      chunkToNode[c] = static_cast<uint32_t>(nodes.size());
+      nodes.push_back(n);
+   }
+
+
+   //////////////////////
+   // STEP 3: file layout
+   std::vector<Section> toc;
+   uint64_t offset = sizeof(Header);
+   auto addSection = [&toc, &offset](SectionId id, uint32_t nrOfElements, uint64_t size)
+   {
+      offset = cookedAlign(offset, cookedSectionAlignment);
+      toc.push_back({ id, nrOfElements, offset, size });
+      offset += size;
+   };
+   addSection(SectionId::strings, static_cast<uint32_t>(stringIndex.size()), strings.size());
+   addSection(SectionId::nodes, static_cast<uint32_t>(nodes.size()), nodes.size() * sizeof(NodeData));
+   addSection(SectionId::materials, static_cast<uint32_t>(materials.size()), materials.size() * sizeof(MaterialData));
+   addSection(SectionId::meshes, static_cast<uint32_t>(meshes.size()), meshes.size() * sizeof(MeshData));
+   addSection(SectionId::lights, static_cast<uint32_t>(lights.size()), lights.size() * sizeof(LightData));
+   addSection(SectionId::textures, static_cast<uint32_t>(textures.size()), textures.size() * sizeof(TextureData));
+
+   // Blobs:
+   const uint64_t blobBegin = cookedAlign(offset, blobAlignment);
+   offset = blobBegin;
+   for (auto &m : meshes)
+   {
+      m.vertexOffset = cookedAlign(offset, blobAlignment);
+      offset = m.vertexOffset + m.nrOfVertices * sizeof(Eng::Vbo::VertexData);
+      m.faceOffset = cookedAlign(offset, blobAlignment);
+      offset = m.faceOffset + m.nrOfFaces * sizeof(Eng::Ebo::FaceData);
+      m.lodOffset = cookedAlign(offset, blobAlignment);
+      offset = m.lodOffset + m.nrOfLods * sizeof(Eng::Mesh::Lod);
+   }
+   for (auto &t : textures)
+   {
+      t.offset = cookedAlign(offset, blobAlignment);
+      offset = t.offset + t.size;
+   }
+   toc.push_back({ SectionId::blobs, static_cast<uint32_t>(meshes.size() * 3 + textures.size()), blobBegin, offset - blobBegin });
+
+   // Table of contents:
+   Header header = {};
+   memcpy(header.magic, cookedMagic, sizeof(cookedMagic));
+   header.version = Eng::Cooked::version;
+   header.nrOfSections = static_cast<uint32_t>(toc.size());
+   header.tocOffset = cookedAlign(offset, cookedSectionAlignment);
+   const uint64_t length = header.tocOffset + toc.size() * sizeof(Section);
+
+
+   //////////////////////////////////////
+   // STEP 4: fill the image and write it
+   std::vector<uint8_t> image(length, 0);
+   memcpy(image.data(), &header, sizeof(Header));
+   memcpy(image.data() + toc[0].offset, strings.data(), strings.size());
+   memcpy(image.data() + toc[1].offset, nodes.data(), toc[1].size);
+   memcpy(image.data() + toc[2].offset, materials.data(), toc[2].size);
+   memcpy(image.data() + toc[3].offset, meshes.data(), toc[3].size);
+   memcpy(image.data() + toc[4].offset, lights.data(), toc[4].size);
+   memcpy(image.data() + toc[5].offset, textures.data(), toc[5].size);
+   for (uint32_t c = 0; c < meshes.size(); c++)
+   {
+      memcpy(image.data() + meshes[c].vertexOffset, meshSource[c]->getVertexData().data(), meshes[c].nrOfVertices * sizeof(Eng::Vbo::VertexData));
+      memcpy(image.data() + meshes[c].faceOffset, meshSource[c]->getFaceData().data(), meshes[c].nrOfFaces * sizeof(Eng::Ebo::FaceData));
+      memcpy(image.data() + meshes[c].lodOffset, meshSource[c]->getLods().data(), meshes[c].nrOfLods * sizeof(Eng::Mesh::Lod));
+   }
+   for (uint32_t c = 0; c < textures.size(); c++)
+      memcpy(image.data() + textures[c].offset, textureBlob[c].data(), textures[c].size);
+   memcpy(image.data() + header.tocOffset, toc.data(), toc.size() * sizeof(Section));
+
+   FILE *dat = fopen(cookedFilename.c_str(), "wb");
+   if (dat == nullptr)
+   {
+      ENG_LOG_ERROR("Unable to create file '%s'", cookedFilename.c_str());
+      return false;
+   }
+   if (fwrite(image.data(), sizeof(uint8_t), length, dat) != length)
+   {
+      ENG_LOG_ERROR("Unable to write file '%s'", cookedFilename.c_str());
+      fclose(dat);
+      return false;
+   }
+   fclose(dat);
+
+   // Done:
+   ENG_LOG_PLAIN("Cooked '%s': %u nodes, %u meshes, %u materials, %u textures, %llu bytes", cookedFilename.c_str(),
+                 static_cast<uint32_t>(nodes.size()), static_cast<uint32_t>(meshes.size()), static_cast<uint32_t>(materials.size()),
+                 static_cast<uint32_t>(textures.size()), static_cast<unsigned long long>(length));
+   return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Loads a cooked file. The whole file is read at once, then objects are created directly from the flat arrays and
+ * GPU buffers are filled directly from the blobs. Textures go through the container cache.
+ * @param filename cooked file
+ * @return root node or Node::empty if error
+ */
+Eng::Node ENG_API &Eng::Cooked::load(const std::string &filename)
+{
+   // Safety net:
+   if (filename.empty())
+   {
+      ENG_LOG_ERROR("Invalid params");
+      return Eng::Node::empty;
+   }
+
+
+   //////////////////////////////////
+   // STEP 1: read the file at once
+   FILE *dat = fopen(filename.c_str(), "rb");
+   if (dat == nullptr)
+   {
+      ENG_LOG_ERROR("Unable to open file '%s'", filename.c_str());
+      return Eng::Node::empty;
+   }
+   fseek(dat, 0L, SEEK_END);
+   uint64_t length = ftell(dat);
+   fseek(dat, 0L, SEEK_SET);
+   std::vector<uint8_t> image(length);
+   if (fread(image.data(), sizeof(uint8_t), length, dat) != length)
+   {
+      ENG_LOG_ERROR("File '%s' is corrupted", filename.c_str());
+      fclose(dat);
+      return Eng::Node::empty;
+   }
+   fclose(dat);
+
+
+   //////////////////////////////////////////
+   // STEP 2: check header and locate sections
+   auto inFile = [length](uint64_t offset, uint64_t size) -> bool
+   {
+      return offset <= length && size <= length - offset;   // Written so as not to overflow
+   };
+   const Header *header = reinterpret_cast<const Header *>(image.data());
+   if (length < sizeof(Header) || memcmp(header->magic, cookedMagic, sizeof(cookedMagic)) != 0 || header->version != Eng::Cooked::version)
+   {
+      ENG_LOG_ERROR("File '%s' is not a valid cooked file", filename.c_str());
+      return Eng::Node::empty;
+   }
+   if (!inFile(header->tocOffset, static_cast<uint64_t>(header->nrOfSections) * sizeof(Section)))
+   {
+      ENG_LOG_ERROR("File '%s' is corrupted", filename.c_str());
+      return Eng::Node::empty;
+   }
+
+   const Section *section[static_cast<uint32_t>(SectionId::last)] = {};
+   const Section *toc = reinterpret_cast<const Section *>(image.data() + header->tocOffset);
+   for (uint32_t c = 0; c < header->nrOfSections; c++)
+   {
+      if (toc[c].id >= SectionId::last || !inFile(toc[c].offset, toc[c].size))
+      {
+         ENG_LOG_ERROR("File '%s' is corrupted", filename.c_str());
+         return Eng::Node::empty;
+      }
+      section[static_cast<uint32_t>(toc[c].id)] = &toc[c];
+   }
+   for (uint32_t c = 0; c < static_cast<uint32_t>(SectionId::last); c++)
+      if (section[c] == nullptr)
+      {
+         ENG_LOG_ERROR("File '%s' is missing section %u", filename.c_str(), c);
+         return Eng::Node::empty;
+      }
+
+   // Element arrays must fit into their section:
+   const std::pair<SectionId, uint64_t> elementSize[] = { { SectionId::nodes, sizeof(NodeData) },
+                                                          { SectionId::materials, sizeof(MaterialData) },
+                                                          { SectionId::meshes, sizeof(MeshData) },
+                                                          { SectionId::lights, sizeof(LightData) },
+                                                          { SectionId::textures, sizeof(TextureData) } };
+   for (const auto &e : elementSize)
+   {
+      const Section &s = *section[static_cast<uint32_t>(e.first)];
+      if (s.nrOfElements > s.size / e.second)
+      {
+         ENG_LOG_ERROR("File '%s' is corrupted (section %u holds %u elements in %llu bytes)", filename.c_str(), 
+                       static_cast<uint32_t>(e.first), s.nrOfElements, static_cast<unsigned long long>(s.size));
+         return Eng::Node::empty;
+      }
+   }
+
+   const Section &stringSection = *section[static_cast<uint32_t>(SectionId::strings)];
+   const char *strings = reinterpret_cast<const char *>(image.data() + stringSection.offset);
+   auto getString = [strings, &stringSection](uint32_t offset) -> std::string
+   {
+      if (offset >= stringSection.size)
+         return std::string();
+      return std::string(strings + offset, strnlen(strings + offset, stringSection.size - offset));
+   };
+   auto getArray = [&image, &section](SectionId id) -> const uint8_t *
+   {
+      return image.data() + section[static_cast<uint32_t>(id)]->offset;
+   };
+   const NodeData *nodes = reinterpret_cast<const NodeData *>(getArray(SectionId::nodes));
+   const MaterialData *materials = reinterpret_cast<const MaterialData *>(getArray(SectionId::materials));
+   const MeshData *meshes = reinterpret_cast<const MeshData *>(getArray(SectionId::meshes));
+   const LightData *lights = reinterpret_cast<const LightData *>(getArray(SectionId::lights));
+   const TextureData *textures = reinterpret_cast<const TextureData *>(getArray(SectionId::textures));
+   const uint32_t nrOfNodes = section[static_cast<uint32_t>(SectionId::nodes)]->nrOfElements;
+   const uint32_t nrOfMaterials = section[static_cast<uint32_t>(SectionId::materials)]->nrOfElements;
+   const uint32_t nrOfMeshes = section[static_cast<uint32_t>(SectionId::meshes)]->nrOfElements;
+   const uint32_t nrOfLights = section[static_cast<uint32_t>(SectionId::lights)]->nrOfElements;
+   const uint32_t nrOfTextures = section[static_cast<uint32_t>(SectionId::textures)]->nrOfElements;
+
+
+   //////////////////////////////////
+   // STEP 3: materials and textures
+   Eng::Container &container = Eng::Container::getInstance();
+   const Eng::Texture::Type slotType[Eng::Material::maxNrOfTextures] = { Eng::Texture::Type::albedo,
+                                                                          Eng::Texture::Type::normal,
+                                                                          Eng::Texture::Type::roughness,
+                                                                          Eng::Texture::Type::metalness };
+   std::vector<Eng::Material *> material(nrOfMaterials, nullptr);
+   for (uint32_t c = 0; c < nrOfMaterials; c++)
+   {
+      const MaterialData &m = materials[c];
+      Eng::Material mat;
+      mat.setName(getString(m.name));
+      mat.setOpacity(m.opacity);
+      mat.setRoughness(m.roughness);
+      mat.setMetalness(m.metalness);
+      mat.setEmission(m.emission);
+      mat.setAlbedo(m.albedo);
+
+      for (uint32_t s = 0; s < Eng::Material::maxNrOfTextures; s++)
+      {
+         if (m.texture[s] >= nrOfTextures)
+            continue;
+         const TextureData &t = textures[m.texture[s]];
+         const std::string name = getString(t.name);
+
+         if (container.isTextureCached(name))
+            mat.setCachedTexture(name, slotType[s]);
+         else if (inFile(t.offset, t.size))
+         {
+            Eng::Bitmap bitmap;
+            if (bitmap.load(image.data() + t.offset, t.size, name))
+               mat.setCachedTexture(name, slotType[s], &bitmap);
+         }
+      }
+
+      container.add(mat);
+      material[c] = &container.getLastMaterial();
+   }
+
+
+   ///////////////////////////////////
+   // STEP 4: scene graph and buffers
+   std::vector<Eng::Node *> node(nrOfNodes, nullptr);
+   std::reference_wrapper<Eng::Node> root = Eng::Node::empty;
+   for (uint32_t c = 0; c < nrOfNodes; c++)
+   {
+      const NodeData &n = nodes[c];
+      switch (n.type)
+      {
+         ///////////////////////
+         case NodeType::mesh: //
+         {
+            if (n.index >= nrOfMeshes)
+               break;
+            const MeshData &m = meshes[n.index];
+            if (!inFile(m.vertexOffset, m.nrOfVertices * sizeof(Eng::Vbo::VertexData)) ||
+                !inFile(m.faceOffset, m.nrOfFaces * sizeof(Eng::Ebo::FaceData)) ||
+                !inFile(m.lodOffset, m.nrOfLods * sizeof(Eng::Mesh::Lod)))
+            {
+               ENG_LOG_ERROR("File '%s' is corrupted", filename.c_str());
+               break;
+            }
+
+            Eng::Mesh mesh;
+            mesh.setName(getString(n.name));
+            mesh.setMatrix(n.matrix);
+            mesh.create(reinterpret_cast<const Eng::Vbo::VertexData *>(image.data() + m.vertexOffset), m.nrOfVertices,
+                        reinterpret_cast<const Eng::Ebo::FaceData *>(image.data() + m.faceOffset), m.nrOfFaces,
+                        m.radius, m.bboxMin, m.bboxMax,
+                        reinterpret_cast<const Eng::Mesh::Lod *>(image.data() + m.lodOffset), m.nrOfLods);
+            if (m.material < nrOfMaterials)
+               mesh.setMaterial(*material[m.material]);
+            container.add(mesh);
+            node[c] = &container.getLastMesh();
+         }
+         break;
+
+         ////////////////////////
+         case NodeType::light: //
+         {
+            Eng::Light light;
+            light.setName(getString(n.name));
+            light.setMatrix(n.matrix);
+            if (n.index < nrOfLights)
+            {
+               light.setColor(lights[n.index].color);
+               light.setAmbient(lights[n.index].ambient);
+            }
+            container.add(light);
+            node[c] = &container.getLastLight();
+         }
+         break;
+
+         ///////////
+         default: //
+         {
+            Eng::Node _node;
+            _node.setName(getString(n.name));
+            _node.setMatrix(n.matrix);
+            container.add(_node);
+            node[c] = &container.getLastNode();
+         }
+      }
+
+      // Link (parents always precede their children):
+      if (node[c] == nullptr)
+         continue;
+      if (n.parent >= c)
+         root = *node[c];
+      else if (node[n.parent])
+         node[n.parent]->addChild(*node[c]);
+   }
+
+   // Done:
+   return root;
+}
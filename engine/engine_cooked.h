@@ -0,0 +1,157 @@
+/**
+ * @file		engine_cooked.h
+ * @brief	Cooked (ready-to-upload) binary scene format
+ *
+ * @author	Achille Peternier (achille.peternier@supsi.ch), (C) SUPSI
+ */
+#pragma once
+
+
+
+/**
+ * @brief Cooked scene manager. A cooked file contains a header, a string table, flat arrays of nodes (with parent
+ *        indices), materials, meshes, lights and textures, followed by 256-byte aligned vertex/index/LOD/image blobs and
+ *        by a table of contents. Loading requires a single read and no parsing: blobs are directly passed to OpenGL.
+ */
+class ENG_API Cooked
+{
+//////////
+public: //
+//////////
+
+   // Consts:
+   static constexpr uint32_t version = 2;             ///< Cooked format revision
+   static constexpr uint32_t blobAlignment = 256;     ///< Alignment of vertex/index/image blobs (in bytes)
+   static constexpr uint32_t none = 0xFFFFFFFF;       ///< Missing index (e.g., no parent, no texture)
+
+
+   /**
+    * @brief Section types, as listed in the table of contents.
+    */
+   enum class SectionId : uint32_t
+   {
+      strings,
+      nodes,
+      materials,
+      meshes,
+      lights,
+      textures,
+      blobs,
+
+      // Terminator:
+      last
+   };
+
+
+   /**
+    * @brief File header.
+    */
+   struct Header
+   {
+      char magic[4];                ///< "OVCK"
+      uint32_t version;             ///< Format revision
+      uint32_t nrOfSections;        ///< Number of entries in the table of contents
+      uint32_t _pad;                ///< Padding
+      uint64_t tocOffset;           ///< Offset of the table of contents
+   };
+
+
+   /**
+    * @brief Table of contents entry.
+    */
+   struct Section
+   {
+      SectionId id;                 ///< Section type
+      uint32_t nrOfElements;        ///< Number of elements in the section
+      uint64_t offset;              ///< Offset from the file begin
+      uint64_t size;                ///< Size in bytes
+   };
+
+
+   /**
+    * @brief Node types.
+    */
+   enum class NodeType : uint32_t
+   {
+      node,
+      mesh,
+      light,
+
+      // Terminator:
+      last
+   };
+
+
+   /**
+    * @brief Flat node entry (parents always precede their children).
+    */
+   struct NodeData
+   {
+      uint32_t name;                ///< Offset in the string table
+      uint32_t parent;              ///< Index of the parent node, or none
+      NodeType type;                ///< Node type
+      uint32_t index;               ///< Index in the mesh/light array (if any)
+      glm::mat4 matrix;             ///< Local matrix
+   };
+
+
+   /**
+    * @brief Material entry.
+    */
+   struct MaterialData
+   {
+      uint32_t name;                ///< Offset in the string table
+      uint32_t texture[4];          ///< Albedo, normal, roughness and metalness texture indices (or none)
+      float opacity;                ///< Opacity
+      float roughness;              ///< Roughness
+      float metalness;              ///< Metalness
+      glm::vec3 emission;           ///< Emission
+      glm::vec3 albedo;             ///< Albedo
+   };
+
+
+   /**
+    * @brief Mesh entry.
+    */
+   struct MeshData
+   {
+      uint32_t material;            ///< Material index (or none)
+      float radius;                 ///< Bounding sphere radius
+      uint32_t nrOfVertices;        ///< Number of vertices
+      uint32_t nrOfFaces;           ///< Number of faces
+      glm::vec3 bboxMin;            ///< Bounding box minimum
+      glm::vec3 bboxMax;            ///< Bounding box maximum
+      uint32_t nrOfLods;            ///< Number of levels of detail
+      uint32_t _pad;                ///< Padding
+      uint64_t vertexOffset;        ///< Offset of the Vbo::VertexData blob (all LODs)
+      uint64_t faceOffset;          ///< Offset of the Ebo::FaceData blob (all LODs)
+      uint64_t lodOffset;           ///< Offset of the Mesh::Lod blob
+   };
+
+
+   /**
+    * @brief Light entry.
+    */
+   struct LightData
+   {
+      glm::vec3 color;              ///< Color
+      glm::vec3 ambient;            ///< Ambient color
+   };
+
+
+   /**
+    * @brief Texture entry (the blob is the content of the original DDS file).
+    */
+   struct TextureData
+   {
+      uint32_t name;                ///< Offset in the string table (original file name, used as cache key)
+      uint32_t _pad;                ///< Padding
+      uint64_t offset;              ///< Offset of the DDS blob
+      uint64_t size;                ///< Size of the DDS blob
+   };
+
+
+   // Loading methods:
+   Eng::Node &load(const std::string &filename);
+   static bool cook(const std::string &ovoFilename, const std::string &cookedFilename, bool optimize = true);
+};
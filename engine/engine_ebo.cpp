@@ -14,6 +14,9 @@
    // Main include:
    #include "engine.h"
 
+   // C/C++:
+   #include <algorithm>
+
    // OGL:      
    #include <GL/glew.h>
    #include <GLFW/glfw3.h>
@@ -38,14 +41,15 @@
  */
 struct Eng::Ebo::Reserved
 {  
-   GLuint oglId;        ///< OpenGL shader ID
-   uint32_t nrOfFaces;  ///< Nr. of faces
+   GLuint oglId;                    ///< OpenGL shader ID
+   uint32_t nrOfFaces;              ///< Nr. of faces
+   Eng::Ebo::IndexType indexType;   ///< Type of the indices stored in the buffer
 
 
    /**
     * Constructor.
     */
-   Reserved() : oglId{ 0 }, nrOfFaces{ 0 }
+   Reserved() : oglId{ 0 }, nrOfFaces{ 0 }, indexType{ Eng::Ebo::IndexType::none }
    {}
 };
 
@@ -120,6 +124,44 @@ uint32_t ENG_API Eng::Ebo::getNrOfFaces() const
 }
 
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Return the type of the indices stored in this EBO, as selected by create().
+ * @return index type or IndexType::none if empty
+ */
+Eng::Ebo::IndexType ENG_API Eng::Ebo::getIndexType() const
+{
+   return reserved->indexType;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Return the size of a single index stored in this EBO.
+ * @return size in bytes, or 0 if empty
+ */
+uint32_t ENG_API Eng::Ebo::getIndexSize() const
+{
+   switch (reserved->indexType)
+   {
+      case Eng::Ebo::IndexType::uint16: return sizeof(uint16_t);
+      case Eng::Ebo::IndexType::uint32: return sizeof(uint32_t);
+      default:                          return 0;
+   }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Return the OpenGL type of the indices stored in this EBO, as expected by glDrawElements*().
+ * @return GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+ */
+uint32_t ENG_API Eng::Ebo::getOglIndexType() const
+{
+   return (reserved->indexType == Eng::Ebo::IndexType::uint16) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
  * Initializes an OpenGL EBO.
@@ -133,9 +175,11 @@ bool ENG_API Eng::Ebo::init()
    // Free buffer if already stored:
    if (reserved->oglId)   
    {   
+	   Eng::State::releaseBuffer(reserved->oglId);
 	   glDeleteBuffers(1, &reserved->oglId);    
       reserved->oglId = 0;   
       reserved->nrOfFaces = 0;
+      reserved->indexType = Eng::Ebo::IndexType::none;
    }   
 
 	// Create it:		    
@@ -159,9 +203,11 @@ bool ENG_API Eng::Ebo::free()
    // Free EBO if stored:
    if (reserved->oglId)
    {
+      Eng::State::releaseBuffer(reserved->oglId);
       glDeleteBuffers(1, &reserved->oglId);
       reserved->oglId = 0;
       reserved->nrOfFaces = 0;
+      reserved->indexType = Eng::Ebo::IndexType::none;
    }
 
    // Done:   
@@ -171,9 +217,10 @@ bool ENG_API Eng::Ebo::free()
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
- * Create element buffer by allocating the required storage.
+ * Create element buffer by allocating the required storage. Faces are given as 32-bit indices: when all of them fit
+ * into 16 bits, they are narrowed before upload (see getIndexType()).
  * @param nfOfFaces number of faces to store
- * @param data pointer to the data to copy into the buffer
+ * @param data pointer to the FaceData to copy into the buffer
  * @return TF
  */
 bool ENG_API Eng::Ebo::create(uint32_t nrOfFaces, const void *data)
@@ -181,11 +228,29 @@ bool ENG_API Eng::Ebo::create(uint32_t nrOfFaces, const void *data)
    // Init buffer:
    if (!this->isInitialized())
       this->init();
-   uint64_t size = nrOfFaces * sizeof(FaceData); 
+
+   // Narrow indices when possible (0xFFFF is left out, as it is commonly used for primitive restart):
+   const uint32_t *index = static_cast<const uint32_t *>(data);
+   const uint64_t nrOfIndices = static_cast<uint64_t>(nrOfFaces) * 3;
+   reserved->indexType = Eng::Ebo::IndexType::uint32;
+   std::vector<uint16_t> narrow;
+   if (index)
+   {
+      const uint32_t maxIndex = (nrOfIndices) ? *std::max_element(index, index + nrOfIndices) : 0;
+      if (maxIndex < 0xFFFF)
+      {
+         narrow.resize(nrOfIndices);
+         for (uint64_t c = 0; c < nrOfIndices; c++)
+            narrow[c] = static_cast<uint16_t>(index[c]);
+         reserved->indexType = Eng::Ebo::IndexType::uint16;
+         data = narrow.data();
+      }
+   }
+   uint64_t size = nrOfIndices * this->getIndexSize(); 
 
 	// Create it:		              
    const GLuint oglId = this->getOglHandle();
-   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, oglId);
+   Eng::State::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, oglId);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, data, GL_STATIC_DRAW); 
 
    // Done:
@@ -203,7 +268,7 @@ bool ENG_API Eng::Ebo::create(uint32_t nrOfFaces, const void *data)
  */
 bool ENG_API Eng::Ebo::render(uint32_t value, void *data) const
 {	   
-   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, reserved->oglId);  
+   Eng::State::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, reserved->oglId);  
    
    // Done:
    return true;
@@ -37,6 +37,22 @@ public: //
 	};      
 
 
+   /**
+    * @brief Index types.
+    */
+   enum class IndexType : uint32_t
+   {
+      none,
+
+      // Types:
+      uint16,
+      uint32,
+
+      // Terminator:
+      last
+   };
+
+
    // Const/dest:
    Ebo();
    Ebo(Ebo &&other);
@@ -45,6 +61,9 @@ public: //
    
    // Get/set:   
    uint32_t getNrOfFaces() const;
+   IndexType getIndexType() const;
+   uint32_t getIndexSize() const;
+   uint32_t getOglIndexType() const;
    uint32_t getOglHandle() const;
 
    // Data:
@@ -26,6 +26,9 @@
 
    // Special values:
    Eng::Fbo Eng::Fbo::empty("[empty]");
+
+   // Framebuffer used as main buffer (0 for the one of the context):
+   static GLuint fboMainOglId = 0;
    
 
 
@@ -222,6 +225,8 @@ uint32_t ENG_API Eng::Fbo::getSizeY() const
 /**
  * Add a texture in the next slot of the framebuffer. 
  * @param texture texture
+ * @param level mipmap level (array textures only)
+ * @param side layer (array textures only)
  * @return TF
  */
 bool ENG_API Eng::Fbo::attachTexture(const Eng::Texture &texture, uint32_t level, uint32_t side)
@@ -256,7 +261,10 @@ bool ENG_API Eng::Fbo::attachTexture(const Eng::Texture &texture, uint32_t level
       ////////////////////////////////////
       case Eng::Texture::Format::depth: //
          att.type = Eng::Fbo::Attachment::Type::depth_texture;
-         glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, texture.getOglHandle(), 0);         
+         if (texture.isArray())
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture.getOglHandle(), level, side);
+         else
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, texture.getOglHandle(), 0);         
          break;
 
       ///////////
@@ -369,17 +377,28 @@ bool ENG_API Eng::Fbo::validate() const
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
- * Detach framebuffer: rendering is done on the main context buffers. 
+ * Detach framebuffer: rendering is done on the main buffers (see setMain()). 
  * @param viewportSizeX width of the viewport
  * @param viewportSizeY height of the viewport
  */
 void ENG_API Eng::Fbo::reset(uint32_t viewportSizeX, uint32_t viewportSizeY)
 {	   
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);	   
+	glBindFramebuffer(GL_FRAMEBUFFER, fboMainOglId);	   
    glViewport(0, 0, viewportSizeX, viewportSizeY);
 }
 
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Sets the framebuffer used in place of the context buffers by reset() and blit() (e.g., when running headless).
+ * @param fbo framebuffer, or Fbo::empty for the context buffers
+ */
+void ENG_API Eng::Fbo::setMain(const Eng::Fbo &fbo)
+{
+   fboMainOglId = fbo.reserved->oglId;
+}
+
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
  * Blits directly from FBO. FBO and main buffer size must match. 
@@ -390,7 +409,7 @@ void ENG_API Eng::Fbo::reset(uint32_t viewportSizeX, uint32_t viewportSizeY)
 bool ENG_API Eng::Fbo::blit(uint32_t viewportSizeX, uint32_t viewportSizeY) const
 {  
    glBindFramebuffer(GL_READ_FRAMEBUFFER, reserved->oglId);
-   glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);   
+   glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fboMainOglId);   
    glBlitFramebuffer(0, 0, getSizeX(), getSizeY(),
                      0, 0, viewportSizeX, viewportSizeY,
                      GL_COLOR_BUFFER_BIT, GL_NEAREST);
@@ -85,6 +85,7 @@ public: //
    // Rendering methods:
    bool render(uint32_t value = 0, void *data = nullptr) const;
    static void reset(uint32_t viewportSizeX, uint32_t viewportSizeY);
+   static void setMain(const Eng::Fbo &fbo);
    bool blit(uint32_t viewportSizeX, uint32_t viewportSizeY) const;
 
    // Managed:
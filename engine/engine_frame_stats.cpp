@@ -0,0 +1,442 @@
+/**
+ * @file		engine_frame_stats.cpp
+ * @brief	Frame-time statistics
+ *
+ * @author	Achille Peternier (achille.peternier@supsi.ch), (C) SUPSI
+ */
+
+
+
+//////////////
+// #INCLUDE //
+//////////////
+
+   // Main include:
+   #include "engine.h"
+
+   // C/C++:
+   #include <algorithm>
+   #include <atomic>
+   #include <chrono>
+   #include <cmath>
+   #include <fstream>
+   #include <sstream>
+
+
+
+/////////////////////////
+// RESERVED STRUCTURES //
+/////////////////////////
+
+/**
+ * @brief Lock-free histogram of one channel. Durations are stored in microseconds.
+ */
+struct FrameStatsHistogram
+{
+   std::atomic<uint64_t> bucket[Eng::FrameStats::nrOfBuckets];    ///< Number of samples per bucket
+   std::atomic<uint64_t> nrOfSamples;                             ///< Total number of samples
+   std::atomic<uint64_t> nrOfHitches;                             ///< Samples above the hitch threshold
+   std::atomic<uint64_t> sum;                                     ///< Sum of the samples
+   std::atomic<uint64_t> max;                                     ///< Longest sample
+
+
+   /**
+    * Constructor.
+    */
+   FrameStatsHistogram()
+   {
+      reset();
+   }
+
+
+   /**
+    * Clears all the counters.
+    */
+   void reset()
+   {
+      for (auto &b : bucket)
+         b.store(0, std::memory_order_relaxed);
+      nrOfSamples.store(0, std::memory_order_relaxed);
+      nrOfHitches.store(0, std::memory_order_relaxed);
+      sum.store(0, std::memory_order_relaxed);
+      max.store(0, std::memory_order_relaxed);
+   }
+};
+
+
+/**
+ * @brief FrameStats static reserved structure.
+ */
+struct Eng::FrameStats::StaticReserved
+{
+   FrameStatsHistogram histogram[static_cast<uint32_t>(Channel::last)];         ///< Per-channel histograms
+   std::atomic<double> hitchThreshold;                                           ///< Hitch threshold, in milliseconds
+
+   // Render thread only:
+   bool inFrame;                                                                 ///< beginFrame() has been called
+   bool hasPresent;                                                              ///< lastPresent is valid
+   std::chrono::high_resolution_clock::time_point frameStart;                   ///< CPU start of the frame in progress
+   std::chrono::high_resolution_clock::time_point lastPresent;                  ///< Time of the last present
+
+
+   /**
+    * Constructor.
+    */
+   StaticReserved() : hitchThreshold{ Eng::FrameStats::dfltHitchThreshold }, inFrame{ false }, hasPresent{ false }
+   {}
+};
+
+
+
+////////////
+// STATIC //
+////////////   
+
+   // Reserved data:
+   Eng::FrameStats::StaticReserved *Eng::FrameStats::staticReserved = nullptr;
+
+   // Channel names, for the output:
+   static const char *frameStatsChannelName[] = { "cpu", "gpu", "present" };
+
+
+
+//////////////////////////////
+// BODY OF CLASS FrameStats //
+//////////////////////////////
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Initializes the static components.
+ * @return TF
+ */
+bool ENG_API Eng::FrameStats::init()
+{
+   // Already done?
+   if (staticReserved != nullptr)
+   {
+      ENG_LOG_ERROR("Static class already initialized");
+      return false;
+   }
+
+   // Allocate and reset:
+   staticReserved = new Eng::FrameStats::StaticReserved();
+
+   // Add shutdown hook:
+   atexit([]()
+      {
+         delete Eng::FrameStats::staticReserved;
+         Eng::FrameStats::staticReserved = nullptr;
+      });
+
+   // Done:
+   return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Sets the duration above which a sample counts as a hitch. Applies to the samples added from now on.
+ * @param ms threshold in milliseconds
+ */
+void ENG_API Eng::FrameStats::setHitchThreshold(double ms)
+{
+   if (staticReserved == nullptr)
+      init();
+   staticReserved->hitchThreshold.store(ms, std::memory_order_relaxed);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the duration above which a sample counts as a hitch.
+ * @return threshold in milliseconds
+ */
+double ENG_API Eng::FrameStats::getHitchThreshold()
+{
+   if (staticReserved == nullptr)
+      init();
+   return staticReserved->hitchThreshold.load(std::memory_order_relaxed);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the number of samples of a channel.
+ * @param channel channel
+ * @return number of samples
+ */
+uint64_t ENG_API Eng::FrameStats::getNrOfSamples(Channel channel)
+{
+   // Safety net:
+   if (channel >= Channel::last)
+   {
+      ENG_LOG_ERROR("Invalid params");
+      return 0;
+   }
+   if (staticReserved == nullptr)
+      init();
+
+   return staticReserved->histogram[static_cast<uint32_t>(channel)].nrOfSamples.load(std::memory_order_relaxed);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the number of samples of a channel above the hitch threshold.
+ * @param channel channel
+ * @return number of hitches
+ */
+uint64_t ENG_API Eng::FrameStats::getNrOfHitches(Channel channel)
+{
+   // Safety net:
+   if (channel >= Channel::last)
+   {
+      ENG_LOG_ERROR("Invalid params");
+      return 0;
+   }
+   if (staticReserved == nullptr)
+      init();
+
+   return staticReserved->histogram[static_cast<uint32_t>(channel)].nrOfHitches.load(std::memory_order_relaxed);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the average duration of a channel.
+ * @param channel channel
+ * @return average in milliseconds (0 if no samples)
+ */
+double ENG_API Eng::FrameStats::getAverage(Channel channel)
+{
+   const uint64_t nrOfSamples = getNrOfSamples(channel);
+   if (nrOfSamples == 0)
+      return 0.0;
+
+   const uint64_t sum = staticReserved->histogram[static_cast<uint32_t>(channel)].sum.load(std::memory_order_relaxed);
+   return static_cast<double>(sum) / static_cast<double>(nrOfSamples) / 1000.0;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the longest duration of a channel.
+ * @param channel channel
+ * @return max in milliseconds (0 if no samples)
+ */
+double ENG_API Eng::FrameStats::getMax(Channel channel)
+{
+   if (getNrOfSamples(channel) == 0)
+      return 0.0;
+
+   return staticReserved->histogram[static_cast<uint32_t>(channel)].max.load(std::memory_order_relaxed) / 1000.0;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets a percentile of a channel, as the upper edge of the bucket containing it (capped to the longest sample).
+ * @param channel channel
+ * @param percentile percentile (0-100)
+ * @return duration in milliseconds (0 if no samples)
+ */
+double ENG_API Eng::FrameStats::getPercentile(Channel channel, double percentile)
+{
+   // Safety net:
+   if (percentile < 0.0 || percentile > 100.0)
+   {
+      ENG_LOG_ERROR("Invalid params");
+      return 0.0;
+   }
+   const uint64_t nrOfSamples = getNrOfSamples(channel);
+   if (nrOfSamples == 0)
+      return 0.0;
+
+   // Samples might be added meanwhile: the bucket total is the reference:
+   const FrameStatsHistogram &histogram = staticReserved->histogram[static_cast<uint32_t>(channel)];
+   uint64_t counts[nrOfBuckets];
+   uint64_t total = 0;
+   for (uint32_t c = 0; c < nrOfBuckets; c++)
+   {
+      counts[c] = histogram.bucket[c].load(std::memory_order_relaxed);
+      total += counts[c];
+   }
+   const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(percentile / 100.0 * static_cast<double>(total))));
+
+   const double max = histogram.max.load(std::memory_order_relaxed) / 1000.0;
+   uint64_t cumulated = 0;
+   for (uint32_t c = 0; c < nrOfBuckets; c++)
+   {
+      cumulated += counts[c];
+      if (cumulated >= rank)
+         return (c == nrOfBuckets - 1) ? max : std::min(max, (c + 1) * bucketWidth);
+   }
+
+   // Done:
+   return max;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Adds a sample to a channel. Lock-free, can be called from any thread.
+ * @param channel channel
+ * @param ms duration in milliseconds
+ */
+void ENG_API Eng::FrameStats::add(Channel channel, double ms)
+{
+   // Safety net:
+   if (channel >= Channel::last || ms < 0.0)
+   {
+      ENG_LOG_ERROR("Invalid params");
+      return;
+   }
+   if (staticReserved == nullptr)
+      init();
+
+   FrameStatsHistogram &histogram = staticReserved->histogram[static_cast<uint32_t>(channel)];
+   const uint64_t us = static_cast<uint64_t>(ms * 1000.0);
+   const uint32_t b = static_cast<uint32_t>(std::min(ms / bucketWidth, static_cast<double>(nrOfBuckets - 1)));
+   histogram.bucket[b].fetch_add(1, std::memory_order_relaxed);
+   histogram.sum.fetch_add(us, std::memory_order_relaxed);
+   if (ms > staticReserved->hitchThreshold.load(std::memory_order_relaxed))
+      histogram.nrOfHitches.fetch_add(1, std::memory_order_relaxed);
+
+   uint64_t max = histogram.max.load(std::memory_order_relaxed);
+   while (us > max && !histogram.max.compare_exchange_weak(max, us, std::memory_order_relaxed))
+      ;
+   histogram.nrOfSamples.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Starts a frame: measures the present interval. Called by Base::swap() right after the buffer swap.
+ */
+void ENG_API Eng::FrameStats::beginFrame()
+{
+   if (staticReserved == nullptr)
+      init();
+   StaticReserved &sr = *staticReserved;
+   const auto now = std::chrono::high_resolution_clock::now();
+
+   // Present interval:
+   if (sr.hasPresent)
+      add(Channel::present, std::chrono::duration<double, std::milli>(now - sr.lastPresent).count());
+   sr.lastPresent = now;
+   sr.hasPresent = true;
+
+   sr.frameStart = now;
+   sr.inFrame = true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Ends a frame: measures its CPU time. Called by Base::swap() right before the buffer swap. Ignored when no frame has 
+ * been started.
+ */
+void ENG_API Eng::FrameStats::endFrame()
+{
+   if (staticReserved == nullptr || !staticReserved->inFrame)
+      return;
+   StaticReserved &sr = *staticReserved;
+
+   add(Channel::cpu, std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - sr.frameStart).count());
+   sr.inFrame = false;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Clears the statistics.
+ */
+void ENG_API Eng::FrameStats::reset()
+{
+   if (staticReserved == nullptr)
+      return;
+   StaticReserved &sr = *staticReserved;
+
+   for (auto &histogram : sr.histogram)
+      histogram.reset();
+   sr.inFrame = false;
+   sr.hasPresent = false;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets a summary of the statistics as CSV (one line per channel, durations in milliseconds).
+ * @return CSV text
+ */
+std::string ENG_API Eng::FrameStats::getCsv()
+{
+   std::stringstream out;
+   out << "channel,samples,average,p50,p95,p99,max,hitches" << std::endl;
+   for (uint32_t c = 0; c < static_cast<uint32_t>(Channel::last); c++)
+   {
+      const Channel channel = static_cast<Channel>(c);
+      out << frameStatsChannelName[c] << ',' << getNrOfSamples(channel) << ',' << getAverage(channel) << ','
+          << getPercentile(channel, 50.0) << ',' << getPercentile(channel, 95.0) << ',' << getPercentile(channel, 99.0) << ','
+          << getMax(channel) << ',' << getNrOfHitches(channel) << std::endl;
+   }
+
+   // Done:
+   return out.str();
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets a summary of the statistics as JSON (durations in milliseconds).
+ * @return JSON text
+ */
+std::string ENG_API Eng::FrameStats::getJson()
+{
+   std::stringstream out;
+   out << "{\"hitchThreshold\":" << getHitchThreshold() << ",\"channels\":{";
+   for (uint32_t c = 0; c < static_cast<uint32_t>(Channel::last); c++)
+   {
+      const Channel channel = static_cast<Channel>(c);
+      out << (c ? "," : "") << '"' << frameStatsChannelName[c] << "\":{"
+          << "\"samples\":" << getNrOfSamples(channel) << ",\"average\":" << getAverage(channel)
+          << ",\"p50\":" << getPercentile(channel, 50.0) << ",\"p95\":" << getPercentile(channel, 95.0)
+          << ",\"p99\":" << getPercentile(channel, 99.0) << ",\"max\":" << getMax(channel)
+          << ",\"hitches\":" << getNrOfHitches(channel) << '}';
+   }
+   out << "}}" << std::endl;
+
+   // Done:
+   return out.str();
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Saves a summary of the statistics. The format is JSON when the filename ends with ".json", CSV otherwise.
+ * @param filename output filename
+ * @return TF
+ */
+bool ENG_API Eng::FrameStats::save(const std::string &filename)
+{
+   // Safety net:
+   if (filename.empty())
+   {
+      ENG_LOG_ERROR("Invalid params");
+      return false;
+   }
+
+   std::ofstream out(filename);
+   if (!out.is_open())
+   {
+      ENG_LOG_ERROR("Unable to open file '%s'", filename.c_str());
+      return false;
+   }
+
+   const std::string ext = ".json";
+   const bool isJson = filename.size() >= ext.size() && filename.compare(filename.size() - ext.size(), ext.size(), ext) == 0;
+   out << (isJson ? getJson() : getCsv());
+
+   // Done:
+   return out.good();
+}
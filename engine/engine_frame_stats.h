@@ -0,0 +1,79 @@
+/**
+ * @file		engine_frame_stats.h
+ * @brief	Frame-time statistics
+ *
+ * @author	Achille Peternier (achille.peternier@supsi.ch), (C) SUPSI
+ */
+#pragma once
+
+
+
+/**
+ * @brief Frame-time statistics, fed by Base::swap(). Three channels are tracked separately: the CPU time of a frame
+ *        (from the end of a swap to the beginning of the next one), its GPU time (the GPU work of the top-level 
+ *        profiler scopes, see Profiler::nextFrame(): sampled only while the profiler is enabled, and free of the idle
+ *        time of CPU-bound frames) and the interval between presents. Each channel keeps a 
+ *        fixed-size histogram updated with atomic operations only, so samples can be added from any thread without 
+ *        locks. Percentiles are resolved at bucket granularity. Static components are lazy-loaded at first usage (not 
+ *        thread-safe).
+ */
+class ENG_API FrameStats final
+{
+//////////
+public: //
+//////////
+
+   // Consts:
+   static constexpr uint32_t nrOfBuckets = 1000;               ///< Histogram buckets (the last one also gets all the longer samples)
+   static constexpr double bucketWidth = 0.1;                  ///< Bucket width, in milliseconds
+   static constexpr double dfltHitchThreshold = 33.3;          ///< Default hitch threshold, in milliseconds
+
+
+   /**
+    * @brief Measured quantities.
+    */
+   enum class Channel : uint32_t
+   {
+      cpu,           ///< CPU time of the frame
+      gpu,           ///< GPU time of the frame (sum of the top-level profiler scopes)
+      present,       ///< Interval between two presents
+      last,          ///< Terminator
+   };
+
+
+   // Const/dest:
+   FrameStats() = delete;
+   ~FrameStats() = delete;
+
+   // Get/set:
+   static void setHitchThreshold(double ms);
+   static double getHitchThreshold();
+   static uint64_t getNrOfSamples(Channel channel);
+   static uint64_t getNrOfHitches(Channel channel);
+   static double getAverage(Channel channel);
+   static double getMax(Channel channel);
+   static double getPercentile(Channel channel, double percentile);
+
+   // Management:
+   static void add(Channel channel, double ms);
+   static void beginFrame();
+   static void endFrame();
+   static void reset();
+
+   // Output:
+   static std::string getCsv();
+   static std::string getJson();
+   static bool save(const std::string &filename);
+
+
+///////////
+private: //
+///////////
+
+   // Reserved:
+   struct StaticReserved;
+   static StaticReserved *staticReserved;
+
+   // Init:
+   static bool init();
+};
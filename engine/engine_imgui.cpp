@@ -70,4 +70,7 @@ void ENG_API Eng::ImGuiEngine::render()
     ImGui::End();
     ImGui::Render();
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+
+    // ImGui changed the OpenGL state behind our back:
+    Eng::State::invalidate();
 }
@@ -227,7 +227,10 @@ uint32_t ENG_API Eng::Light::loadChunk(Eng::Serializer &serial, void *data)
  */
 bool ENG_API Eng::Light::render(uint32_t value, void *data) const
 {	   
+   // Programs reading the light uniform block get these values from the pipeline:
    Eng::Program &program = dynamic_cast<Eng::Program &>(Eng::Program::getCached());
+   if (program.hasUniformBlock(Eng::Ubo::lightBinding))
+      return true;
    program.setVec3("lightColor", reserved->color);   
    program.setVec3("lightAmbient", reserved->ambient);   
    program.setVec3("lightPosition", glm::vec3((*((glm::mat4 *) data))[3]));
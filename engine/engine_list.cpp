@@ -14,6 +14,8 @@
    // Main include:
    #include "engine.h"
    #include <algorithm>
+   #include <cstring>
+   #include <unordered_map>
    #include "GLFW/glfw3.h"
 
 
@@ -25,6 +27,32 @@
    Eng::List Eng::List::empty("[empty]");   
 
 
+   /**
+    * Tests a box against the view volume, in clip coordinates.
+    * @param mvpMatrix model-view-projection matrix
+    * @param bboxMin box minimum (model coordinates)
+    * @param bboxMax box maximum (model coordinates)
+    * @return false if all the corners are outside the same clipping plane
+    */
+   static bool listIsBoxInFrustum(const glm::mat4 &mvpMatrix, const glm::vec3 &bboxMin, const glm::vec3 &bboxMax)
+   {
+      uint32_t outside[6] = { 0, 0, 0, 0, 0, 0 };
+      for (uint32_t c = 0; c < 8; c++)
+      {
+         const glm::vec4 p = mvpMatrix * glm::vec4((c & 1) ? bboxMax.x : bboxMin.x, (c & 2) ? bboxMax.y : bboxMin.y, (c & 4) ? bboxMax.z : bboxMin.z, 1.0f);
+         for (uint32_t axis = 0; axis < 3; axis++)
+         {
+            outside[axis * 2] += (p[axis] < -p.w) ? 1 : 0;
+            outside[axis * 2 + 1] += (p[axis] > p.w) ? 1 : 0;
+         }
+      }
+      for (uint32_t c = 0; c < 6; c++)
+         if (outside[c] == 8)
+            return false;
+      return true;
+   }
+
+
 
 /////////////////////////
 // RESERVED STRUCTURES //
@@ -35,15 +63,61 @@
  */
 struct Eng::List::Reserved
 {    
+   /**
+    * @brief BVH state of an element, indexed by its proxy (kept across resets).
+    */
+   struct Tracked
+   {
+      glm::mat4 matrix;                                     ///< World matrix at the last insert/move
+      uint32_t elem;                                        ///< Element index in the current list
+      uint64_t stamp;                                       ///< updateBvh() call that last saw the element (0 if none)
+
+
+      /**
+       * Constructor.
+       */
+      Tracked() : matrix{ 1.0f }, elem{ 0 }, stamp{ 0 }
+      {}
+   };
+
+
    std::vector<Eng::List::RenderableElem> renderableElem;   ///< List of rendering elements
    uint32_t nrOfLights;                                     ///< Number of lights in the list (lights come first)
    uint32_t nrOfOpaqueMeshes;                               ///< Number of opaque meshes in the list
    uint32_t nrOfTransparentMeshes;                          ///< Number of transparent meshes in the list
+   uint32_t nrOfStaticMeshes;                               ///< Number of meshes flagged as static (opaque or not)
+
+   // LOD selection:
+   std::unordered_map<uint32_t, std::pair<uint32_t, uint64_t>> lastLod; ///< LOD and selectLods() call of the previous selection, by object ID (kept across resets)
+   uint64_t lodStamp;                                       ///< Number of selectLods() calls so far
+   float lodThreshold;                                      ///< Projected size below which LOD 1 is used
+   float lodHysteresis;                                     ///< Relative margin to cross before switching LOD
+   uint32_t staticCasterLod;                                ///< LOD of the static casters (camera independent)
+
+   // Spatial index:
+   Eng::Bvh bvh;                                            ///< World-space bounds of the elements (kept across resets)
+   std::unordered_map<uint32_t, Eng::Bvh::Proxy> proxy;     ///< BVH proxy, by object ID (kept across resets)
+   std::vector<Tracked> tracked;                            ///< Per-proxy state, indexed by proxy
+   uint64_t bvhStamp;                                       ///< Number of updateBvh() calls so far
+   std::vector<Eng::Bvh::Proxy> found;                      ///< Query results
+
+   // Software occlusion culling:
+   bool occlusionCulling;                                   ///< Enabled by setOcclusionCulling()
+   Eng::Occlusion occlusion;                                ///< Occluder depth pyramid
+   uint32_t nrOfOccluded;                                   ///< Meshes culled by occlusion at the last cull()
+
+   // Per-object uniform buffer:
+   Eng::Ubo objectUbo;                                      ///< One Mesh::ObjectBlock per mesh, aligned for binding
+   std::vector<uint8_t> objectData;                         ///< Staging copy
+   glm::mat4 objectView;                                    ///< View matrix used for the last upload
+   bool objectsValid;                                       ///< False when the list changed since the last upload
 
    /**
     * Constructor. 
     */
-   Reserved() : nrOfLights{ 0 }, nrOfOpaqueMeshes{ 0 }, nrOfTransparentMeshes{ 0 }
+   Reserved() : nrOfLights{ 0 }, nrOfOpaqueMeshes{ 0 }, nrOfTransparentMeshes{ 0 }, nrOfStaticMeshes{ 0 },
+                lodStamp{ 0 }, lodThreshold{ Eng::List::dfltLodThreshold }, lodHysteresis{ Eng::List::dfltLodHysteresis },
+                staticCasterLod{ Eng::List::dfltStaticCasterLod }, bvhStamp{ 0 }, occlusionCulling{ false }, nrOfOccluded{ 0 }, objectView{ 1.0f }, objectsValid{ false }
    {}
 };
 
@@ -104,6 +178,8 @@ void ENG_API Eng::List::reset()
    reserved->nrOfLights = 0;
    reserved->nrOfOpaqueMeshes = 0;
    reserved->nrOfTransparentMeshes = 0;
+   reserved->nrOfStaticMeshes = 0;
+   reserved->objectsValid = false;
 }
 
 
@@ -129,6 +205,166 @@ uint32_t ENG_API Eng::List::getNrOfLights() const
 }
 
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the number of meshes flagged as static (see Mesh::setStatic()) currently loaded in the list.
+ * @return number of static meshes
+ */
+uint32_t ENG_API Eng::List::getNrOfStaticMeshes() const
+{
+   return reserved->nrOfStaticMeshes;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets a hash of the static meshes in the list (identity, world matrix and caster level of detail), to detect when 
+ * data derived from them (e.g., cached shadow maps) must be refreshed. The camera-driven LOD is not included, as 
+ * static casters are rendered at the LOD given by setStaticCasterLod().
+ * @return hash value
+ */
+uint64_t ENG_API Eng::List::getStaticHash() const
+{
+   uint64_t hash = 14695981039346656037ull; // FNV-1a
+   auto combine = [&hash](const void *data, size_t size)
+   {
+      const uint8_t *byte = reinterpret_cast<const uint8_t *>(data);
+      for (size_t c = 0; c < size; c++)
+         hash = (hash ^ byte[c]) * 1099511628211ull;
+   };
+
+   const size_t startRange = reserved->nrOfLights;
+   const size_t endRange = startRange + reserved->nrOfOpaqueMeshes + reserved->nrOfTransparentMeshes;
+   for (size_t c = startRange; c < endRange; c++)
+   {
+      const RenderableElem &re = reserved->renderableElem[c];
+      const Eng::Mesh *mesh = dynamic_cast<const Eng::Mesh *>(&re.reference.get());
+      if (mesh == nullptr || !mesh->isStatic())
+         continue;
+      const uint32_t id = mesh->getId();
+      combine(&id, sizeof(uint32_t));
+      combine(glm::value_ptr(re.matrix), sizeof(glm::mat4));
+   }
+   combine(&reserved->staticCasterLod, sizeof(uint32_t));
+
+   // Done:
+   return hash;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Sets the LOD selection parameters. LOD n is used when the projected bounding sphere covers less than
+ * threshold / 2^(n - 1) of the viewport height.
+ * @param threshold projected size (fraction of the viewport height) below which LOD 1 is used
+ * @param hysteresis relative margin to cross before switching LOD, to avoid popping back and forth
+ */
+void ENG_API Eng::List::setLodThreshold(float threshold, float hysteresis)
+{
+   // Safety net:
+   if (threshold <= 0.0f || hysteresis < 0.0f || hysteresis >= 1.0f)
+   {
+      ENG_LOG_ERROR("Invalid params");
+      return;
+   }
+
+   reserved->lodThreshold = threshold;
+   reserved->lodHysteresis = hysteresis;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the projected size below which LOD 1 is used.
+ * @return threshold as a fraction of the viewport height
+ */
+float ENG_API Eng::List::getLodThreshold() const
+{
+   return reserved->lodThreshold;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Sets the LOD used to render the static casters with renderDepth() (Casters::statics). Unlike the camera-driven LOD,
+ * it does not change from frame to frame, so that depth data cached from them stays valid.
+ * @param lod level of detail (clamped to the coarsest available of each mesh)
+ */
+void ENG_API Eng::List::setStaticCasterLod(uint32_t lod)
+{
+   reserved->staticCasterLod = lod;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the LOD used to render the static casters.
+ * @return level of detail
+ */
+uint32_t ENG_API Eng::List::getStaticCasterLod() const
+{
+   return reserved->staticCasterLod;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the spatial index of the elements, as updated by the last updateBvh() or cull() call. Can be used for picking
+ * (see Bvh::queryRay()) and proximity queries.
+ * @return BVH
+ */
+const Eng::Bvh ENG_API &Eng::List::getBvh() const
+{
+   return reserved->bvh;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Enables or disables the software occlusion culling performed by cull(). Only meshes flagged with 
+ * Mesh::setOccluder() hide other meshes.
+ * @param enable true to enable
+ */
+void ENG_API Eng::List::setOcclusionCulling(bool enable)
+{
+   reserved->occlusionCulling = enable;
+   reserved->nrOfOccluded = 0;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets whether the software occlusion culling is enabled.
+ * @return TF
+ */
+bool ENG_API Eng::List::isOcclusionCulling() const
+{
+   return reserved->occlusionCulling;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the occlusion culler used by cull() (e.g., to inspect its depth pyramid).
+ * @return occlusion culler
+ */
+const Eng::Occlusion ENG_API &Eng::List::getOcclusion() const
+{
+   return reserved->occlusion;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the number of meshes hidden by occluders at the last cull() call.
+ * @return number of occluded meshes
+ */
+uint32_t ENG_API Eng::List::getNrOfOccluded() const
+{
+   return reserved->nrOfOccluded;
+}
+
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
  * Gets internal list of renderable elements.
@@ -160,6 +396,9 @@ const Eng::List::RenderableElem ENG_API &Eng::List::getRenderableElem(uint32_t e
  */
 bool ENG_API Eng::List::process(const Eng::Node &node, const glm::mat4 &prevMatrix)
 {
+   // Profiling (CPU):
+   Eng::Profiler::Scope profilerScope("List::process", false);
+
    // Safety net:
    if (node == Eng::Node::empty)
    {
@@ -170,6 +409,7 @@ bool ENG_API Eng::List::process(const Eng::Node &node, const glm::mat4 &prevMatr
    RenderableElem re;
    re.matrix = prevMatrix * node.getMatrix();
    re.reference = node;   
+   reserved->objectsValid = false;
    
    // Store only renderable elements:
    if (dynamic_cast<const Eng::Light *>(&node)) // Lights first
@@ -193,6 +433,8 @@ bool ENG_API Eng::List::process(const Eng::Node &node, const glm::mat4 &prevMatr
             reserved->renderableElem.insert(reserved->renderableElem.begin() + reserved->nrOfLights + reserved->nrOfOpaqueMeshes, 1, re);
             reserved->nrOfTransparentMeshes++;
        }
+       if (dynamic_cast<const Eng::Mesh*>(&node)->isStatic())
+            reserved->nrOfStaticMeshes++;
    }
 
    // Parse hierarchy recursively:
@@ -205,14 +447,249 @@ bool ENG_API Eng::List::process(const Eng::Node &node, const glm::mat4 &prevMatr
 }
 
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Selects the level of detail of each mesh in the list from the projected size of its bounding sphere. The choice is
+ * remembered across resets and only changed when the size crosses a LOD boundary by more than the hysteresis margin.
+ * @param camera camera used for rendering
+ * @return TF
+ */
+bool ENG_API Eng::List::selectLods(const Eng::Camera &camera)
+{
+   // Safety net:
+   if (camera == Eng::Camera::empty)
+   {
+      ENG_LOG_ERROR("Invalid params");
+      return false;
+   }
+
+   const glm::mat4 viewMatrix = glm::inverse(camera.getWorldMatrix());
+   const glm::mat4 &projMatrix = camera.getProjMatrix();
+   const bool isPerspective = projMatrix[3][3] == 0.0f;
+   const float threshold = reserved->lodThreshold;
+
+   // LOD for a given projected size:
+   auto getLevel = [threshold](float size, uint32_t nrOfLods) -> uint32_t
+   {
+      if (size >= threshold)
+         return 0;
+      if (size <= 0.0f)
+         return nrOfLods - 1;
+      const uint32_t level = static_cast<uint32_t>(glm::log2(threshold / size)) + 1;
+      return std::min(level, nrOfLods - 1);
+   };
+
+   const uint64_t stamp = ++reserved->lodStamp;
+   size_t nrOfSeen = 0;
+   for (size_t c = reserved->nrOfLights; c < reserved->nrOfLights + reserved->nrOfOpaqueMeshes + reserved->nrOfTransparentMeshes; c++)
+   {
+      RenderableElem &re = reserved->renderableElem[c];
+      const Eng::Mesh &mesh = dynamic_cast<const Eng::Mesh &>(re.reference.get());
+      const uint32_t nrOfLods = mesh.getNrOfLods();
+      if (nrOfLods < 2)
+      {
+         re.lod = 0;
+         continue;
+      }
+
+      // Projected diameter, as a fraction of the viewport height:
+      const float scale = glm::max(glm::length(glm::vec3(re.matrix[0])), glm::max(glm::length(glm::vec3(re.matrix[1])), glm::length(glm::vec3(re.matrix[2]))));
+      const float radius = mesh.getRadius() * scale;
+      float size = radius * projMatrix[1][1];
+      if (isPerspective)
+      {
+         const float distance = glm::length(glm::vec3((viewMatrix * re.matrix)[3]));
+         size = (distance > radius) ? size / distance : threshold;
+      }
+
+      // Hysteresis:
+      const uint32_t minLod = getLevel(size * (1.0f + reserved->lodHysteresis), nrOfLods);
+      const uint32_t maxLod = getLevel(size * (1.0f - reserved->lodHysteresis), nrOfLods);
+      auto it = reserved->lastLod.find(mesh.getId());
+      uint32_t lod = (it == reserved->lastLod.end()) ? getLevel(size, nrOfLods) : it->second.first;
+      if (lod < minLod)
+         lod = minLod;
+      else if (lod > maxLod)
+         lod = maxLod;
+
+      re.lod = lod;
+      std::pair<uint32_t, uint64_t> &last = reserved->lastLod[mesh.getId()];
+      if (last.second != stamp)
+         nrOfSeen++;
+      last = std::make_pair(lod, stamp);
+   }
+
+   // Forget the meshes no longer in the list (if any):
+   if (nrOfSeen < reserved->lastLod.size())
+   {
+      for (auto it = reserved->lastLod.begin(); it != reserved->lastLod.end(); )
+      {
+         if (it->second.second != stamp)
+            it = reserved->lastLod.erase(it);
+         else
+            ++it;
+      }
+   }
+
+   // Done:
+   return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Synchronizes the BVH with the current list: new elements are inserted, the ones whose world matrix changed are moved
+ * (the tree is only touched when they leave their enlarged box) and the ones no longer in the list are removed. 
+ * Proxies persist across resets, so unchanged elements cost a lookup and no box computation. Meshes use their 
+ * transformed bounding box, lights and particle emitters their position.
+ * @return TF
+ */
+bool ENG_API Eng::List::updateBvh()
+{
+   const uint64_t stamp = ++reserved->bvhStamp;
+   size_t nrOfSeen = 0;
+   for (uint32_t c = 0; c < reserved->renderableElem.size(); c++)
+   {
+      const RenderableElem &re = reserved->renderableElem[c];
+      const Eng::Object &object = re.reference.get();
+      auto it = reserved->proxy.find(object.getId());
+      Eng::Bvh::Proxy proxy = (it == reserved->proxy.end()) ? Eng::Bvh::invalidProxy : it->second;
+
+      // Insert or move, when needed:
+      if (proxy == Eng::Bvh::invalidProxy || reserved->tracked[proxy].matrix != re.matrix)
+      {
+         Eng::Bvh::Aabb box(glm::vec3(re.matrix[3]), glm::vec3(re.matrix[3]));
+         const Eng::Mesh *mesh = dynamic_cast<const Eng::Mesh *>(&object);
+         if (mesh)
+            box = Eng::Bvh::Aabb::transform(Eng::Bvh::Aabb(mesh->getBBoxMin(), mesh->getBBoxMax()), re.matrix);
+
+         if (proxy == Eng::Bvh::invalidProxy)
+         {
+            proxy = reserved->bvh.insert(box, object);
+            if (proxy == Eng::Bvh::invalidProxy)
+               return false;
+            reserved->proxy[object.getId()] = proxy;
+            if (proxy >= reserved->tracked.size())
+               reserved->tracked.resize(proxy + 1);
+         }
+         else
+            reserved->bvh.move(proxy, box);
+         reserved->tracked[proxy].matrix = re.matrix;
+      }
+
+      Reserved::Tracked &tracked = reserved->tracked[proxy];
+      if (tracked.stamp != stamp)
+         nrOfSeen++;
+      tracked.elem = c;
+      tracked.stamp = stamp;
+   }
+
+   // Remove the elements no longer in the list (if any):
+   if (nrOfSeen < reserved->proxy.size())
+   {
+      for (auto it = reserved->proxy.begin(); it != reserved->proxy.end(); )
+      {
+         if (reserved->tracked[it->second].stamp != stamp)
+         {
+            reserved->bvh.remove(it->second);
+            reserved->tracked[it->second] = Reserved::Tracked();
+            it = reserved->proxy.erase(it);
+         }
+         else
+            ++it;
+      }
+   }
+
+   // Done:
+   return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Updates the BVH and marks as not visible the meshes whose bounds are outside the camera frustum and, when occlusion
+ * culling is enabled, the ones hidden by occluders.
+ * @param camera camera used for rendering
+ * @return TF
+ */
+bool ENG_API Eng::List::cull(const Eng::Camera &camera)
+{
+   // Safety net:
+   if (camera == Eng::Camera::empty)
+   {
+      ENG_LOG_ERROR("Invalid params");
+      return false;
+   }
+
+   if (!updateBvh())
+      return false;
+
+   // Meshes are hidden unless found:
+   const size_t startRange = reserved->nrOfLights;
+   const size_t endRange = startRange + reserved->nrOfOpaqueMeshes + reserved->nrOfTransparentMeshes;
+   for (size_t c = startRange; c < endRange; c++)
+      reserved->renderableElem[c].visible = false;
+
+   const glm::mat4 viewProjMatrix = camera.getProjMatrix() * glm::inverse(camera.getWorldMatrix());
+
+   // Occluders are rasterized on the worker thread while the frustum is queried:
+   if (reserved->occlusionCulling)
+   {
+      reserved->occlusion.reset();
+      for (size_t c = startRange; c < endRange; c++)
+      {
+         const RenderableElem &re = reserved->renderableElem[c];
+         const Eng::Mesh *mesh = dynamic_cast<const Eng::Mesh *>(&re.reference.get());
+         if (mesh == nullptr || !mesh->isOccluder())
+            continue;
+         if (mesh->getTriangleBvh().getNrOfFaces())
+            reserved->occlusion.addOccluder(mesh->getTriangleBvh(), re.matrix);
+         else
+            reserved->occlusion.addOccluder(Eng::Bvh::Aabb(mesh->getBBoxMin(), mesh->getBBoxMax()), re.matrix);
+      }
+      reserved->occlusion.rasterize(viewProjMatrix);
+   }
+
+   reserved->found.clear();
+   reserved->bvh.queryFrustum(viewProjMatrix, reserved->found);
+   for (Eng::Bvh::Proxy proxy : reserved->found)
+      if (proxy < reserved->tracked.size() && reserved->tracked[proxy].stamp == reserved->bvhStamp)
+         reserved->renderableElem[reserved->tracked[proxy].elem].visible = true;
+
+   // Occlusion (occluders themselves are kept):
+   reserved->nrOfOccluded = 0;
+   if (reserved->occlusionCulling)
+   {
+      reserved->occlusion.wait();
+      for (size_t c = startRange; c < endRange; c++)
+      {
+         RenderableElem &re = reserved->renderableElem[c];
+         const Eng::Mesh *mesh = dynamic_cast<const Eng::Mesh *>(&re.reference.get());
+         if (mesh == nullptr || !re.visible || mesh->isOccluder())
+            continue;
+         if (!reserved->occlusion.isVisible(Eng::Bvh::Aabb::transform(Eng::Bvh::Aabb(mesh->getBBoxMin(), mesh->getBBoxMax()), re.matrix)))
+         {
+            re.visible = false;
+            reserved->nrOfOccluded++;
+         }
+      }
+   }
+
+   // Done:
+   return true;
+}
+
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
  * Parses the list and call the render method of each renderable.
  * @param cameraMatrix camera (also view) matrix (must be already inverted) 
  * @param pass type of pass
+ * @param projMatrix optional projection matrix: when given (camera passes), meshes culled by cull() are skipped and 
+ *        the others are drawn with per-meshlet culling
  * @return number of loaded renderable elements
  */
-bool ENG_API Eng::List::render(const glm::mat4 &cameraMatrix, Eng::List::Pass pass) const
+bool ENG_API Eng::List::render(const glm::mat4 &cameraMatrix, Eng::List::Pass pass, const glm::mat4 *projMatrix) const
 {	
    // Define range:
    size_t startRange = 0;
@@ -261,7 +738,7 @@ bool ENG_API Eng::List::render(const glm::mat4 &cameraMatrix, Eng::List::Pass pa
           break;
    }
    if (isTrasparent) {
-       glDepthMask(false);
+       Eng::State::setDepthMask(false);
    }
    if (isParticle) {
        // Iterate through the range:
@@ -276,16 +753,114 @@ bool ENG_API Eng::List::render(const glm::mat4 &cameraMatrix, Eng::List::Pass pa
        }
    }
    else {
+       // Per-object data through the uniform buffer, when read by the current program:
+       const bool useObjects = Eng::Program::getCached().hasUniformBlock(Eng::Ubo::objectBinding) && updateObjects(cameraMatrix);
+       const uint64_t objectStride = Eng::Ubo::getAlignedSize(sizeof(Eng::Mesh::ObjectBlock));
+
        for (size_t c = startRange; c < endRange; c++)
        {
            RenderableElem& re = reserved->renderableElem.at(c);
+           if (projMatrix && !re.visible)
+              continue;
            glm::mat4 modelViewMat = cameraMatrix * re.matrix;
-           re.reference.get().render(0, &modelViewMat);
+           const Eng::Mesh *mesh = dynamic_cast<const Eng::Mesh *>(&re.reference.get());
+           if (useObjects && mesh)
+              reserved->objectUbo.renderRange(Eng::Ubo::objectBinding, re.object * objectStride, sizeof(Eng::Mesh::ObjectBlock));
+           if (projMatrix && mesh)
+              mesh->renderCulled(re.lod, modelViewMat, *projMatrix);
+           else
+              re.reference.get().render(re.lod, &modelViewMat);
        }
    }
    if (isTrasparent) {
-       glDepthMask(true);
+       Eng::State::setDepthMask(true);
    }
    // Done:
    return true;
 }
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Fills the per-object uniform buffer with the data of all the meshes in the list (opaque and transparent) and 
+ * assigns each of them its slot. The upload is skipped when neither the list nor the view changed since the previous
+ * call, so that multiple passes over the same frame (e.g., one per light) share the same upload.
+ * @param viewMatrix inverse of the camera matrix
+ * @return TF
+ */
+bool ENG_API Eng::List::updateObjects(const glm::mat4 &viewMatrix) const
+{
+   if (reserved->objectsValid && reserved->objectView == viewMatrix)
+      return true;
+
+   // Fill the staging copy:
+   const uint64_t stride = Eng::Ubo::getAlignedSize(sizeof(Eng::Mesh::ObjectBlock));
+   const size_t startRange = reserved->nrOfLights;
+   const size_t endRange = startRange + reserved->nrOfOpaqueMeshes + reserved->nrOfTransparentMeshes;
+   reserved->objectData.resize(std::max<size_t>(endRange - startRange, 1) * stride);
+   uint32_t nrOfObjects = 0;
+   for (size_t c = startRange; c < endRange; c++)
+   {
+      RenderableElem &re = reserved->renderableElem[c];
+      const Eng::Mesh *mesh = dynamic_cast<const Eng::Mesh *>(&re.reference.get());
+      if (mesh == nullptr)
+         continue;
+      const Eng::Mesh::ObjectBlock block = mesh->getObjectBlock(viewMatrix * re.matrix);
+      memcpy(reserved->objectData.data() + nrOfObjects * stride, &block, sizeof(block));
+      re.object = nrOfObjects++;
+   }
+
+   // Upload (the buffer only grows):
+   const uint64_t size = reserved->objectData.size();
+   if (reserved->objectUbo.getSize() < size)
+   {
+      if (reserved->objectUbo.create(size, reserved->objectData.data()) == false)
+         return false;
+   }
+   else if (reserved->objectUbo.update(reserved->objectData.data(), size) == false)
+      return false;
+
+   // Done:
+   reserved->objectView = viewMatrix;
+   reserved->objectsValid = true;
+   return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Depth-only rendering of all the meshes (opaque and transparent), e.g. into a shadow map: meshes outside the given 
+ * view volume are skipped and the others are drawn with Mesh::renderDepth(), i.e. without materials. Visibility 
+ * computed by cull() for the camera is ignored, except for the Casters::opaque subset (which only covers the opaque 
+ * range, as used by a camera depth pre-pass). Casters::statics are drawn at the LOD given by setStaticCasterLod(), the 
+ * others at the one chosen by selectLods().
+ * @param viewMatrix inverse of the camera (or light) matrix
+ * @param projMatrix projection matrix
+ * @param casters subset of meshes to render
+ * @return number of meshes drawn
+ */
+uint32_t ENG_API Eng::List::renderDepth(const glm::mat4 &viewMatrix, const glm::mat4 &projMatrix, Casters casters) const
+{
+   uint32_t nrOfDrawn = 0;
+   const Eng::Program::Uniform<glm::mat4> modelviewUniform = Eng::Program::getCached().getUniform<glm::mat4>("modelviewMat");
+   const size_t startRange = reserved->nrOfLights;
+   const size_t endRange = startRange + reserved->nrOfOpaqueMeshes + (casters == Casters::opaque ? 0 : reserved->nrOfTransparentMeshes);
+   for (size_t c = startRange; c < endRange; c++)
+   {
+      const RenderableElem &re = reserved->renderableElem[c];
+      const Eng::Mesh *mesh = dynamic_cast<const Eng::Mesh *>(&re.reference.get());
+      if (mesh == nullptr || (casters == Casters::statics && !mesh->isStatic()) || (casters == Casters::dynamics && mesh->isStatic()))
+         continue;
+      if (casters == Casters::opaque && !re.visible)
+         continue;
+
+      const glm::mat4 modelViewMat = viewMatrix * re.matrix;
+      if (!listIsBoxInFrustum(projMatrix * modelViewMat, mesh->getBBoxMin(), mesh->getBBoxMax()))
+         continue;
+      mesh->renderDepth(casters == Casters::statics ? reserved->staticCasterLod : re.lod, modelViewMat, modelviewUniform);
+      nrOfDrawn++;
+   }
+
+   // Done:
+   return nrOfDrawn;
+}
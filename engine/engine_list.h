@@ -20,6 +20,11 @@ public: //
    // Special values:
    static List empty;   
 
+   // Consts:
+   static constexpr float dfltLodThreshold = 0.5f;    ///< Projected size (fraction of the viewport height) below which LOD 1 is used
+   static constexpr float dfltLodHysteresis = 0.1f;   ///< Relative margin to cross before switching LOD
+   static constexpr uint32_t dfltStaticCasterLod = 0; ///< LOD of the static casters in depth-only rendering
+
    
    /**
     * @brief Types of rendering passes. 
@@ -41,6 +46,24 @@ public: //
    };
 
 
+   /**
+    * @brief Mesh subsets for depth-only rendering. 
+    */
+   enum class Casters : uint32_t
+   {
+      none,
+
+      // Subsets:
+      all,
+      statics,       ///< Meshes flagged with Mesh::setStatic()
+      dynamics,      ///< All the others
+      opaque,        ///< Opaque meshes still visible after cull() (camera depth pre-pass)
+
+      // Terminator:
+      last
+   };
+
+
    /**
     * @brief Renderable element
     */
@@ -48,12 +71,15 @@ public: //
    {
       std::reference_wrapper<const Eng::Object> reference;  ///< Reference to the original object
       glm::mat4 matrix;                                     ///< Final position in world coordinates     
+      uint32_t lod;                                         ///< Level of detail (meshes only)
+      bool visible;                                         ///< False when culled (meshes only)
+      uint32_t object;                                      ///< Slot in the per-object uniform buffer (meshes only)
 
 
       /**
        * Constructor. 
        */
-      RenderableElem() : reference{ Eng::Object::empty }, matrix{ 1.0f }
+      RenderableElem() : reference{ Eng::Object::empty }, matrix{ 1.0f }, lod{ 0 }, visible{ true }, object{ 0 }
       {}
    };
 
@@ -69,13 +95,28 @@ public: //
    const Eng::List::RenderableElem &getRenderableElem(uint32_t elemNr) const;
    uint32_t getNrOfRenderableElems() const;
    uint32_t getNrOfLights() const;
+   uint32_t getNrOfStaticMeshes() const;
+   uint64_t getStaticHash() const;
+   void setLodThreshold(float threshold, float hysteresis = dfltLodHysteresis);
+   float getLodThreshold() const;
+   void setStaticCasterLod(uint32_t lod);
+   uint32_t getStaticCasterLod() const;
+   const Eng::Bvh &getBvh() const;
+   void setOcclusionCulling(bool enable);
+   bool isOcclusionCulling() const;
+   const Eng::Occlusion &getOcclusion() const;
+   uint32_t getNrOfOccluded() const;
      
    // Scene graph traversal:
    void reset();
    bool process(const Eng::Node &node, const glm::mat4 &prevMatrix = glm::mat4(1.0f));
+   bool selectLods(const Eng::Camera &camera);
+   bool updateBvh();
+   bool cull(const Eng::Camera &camera);
    
    // Rendering:   
-   bool render(const glm::mat4 &cameraMatrix, Pass pass = Pass::all) const;
+   bool render(const glm::mat4 &cameraMatrix, Pass pass = Pass::all, const glm::mat4 *projMatrix = nullptr) const;
+   uint32_t renderDepth(const glm::mat4 &viewMatrix, const glm::mat4 &projMatrix, Casters casters = Casters::all) const;
 
 
 ///////////
@@ -89,6 +130,9 @@ private: //
    // Const/dest:
    List(const std::string &name);
 
+   // Rendering:
+   bool updateObjects(const glm::mat4 &viewMatrix) const;
+
    // Workaround for disabling the unneeded rendering method:
    using Object::render;
 };
@@ -0,0 +1,372 @@
+/**
+ * @file		engine_loader.cpp
+ * @brief	Asynchronous (streaming) scene loader
+ *
+ * @author	Achille Peternier (achille.peternier@supsi.ch), (C) SUPSI
+ */
+
+
+
+//////////////
+// #INCLUDE //
+//////////////
+
+   // Main include:
+   #include "engine.h"
+
+   // C/C++:
+   #include <atomic>
+   #include <map>
+   #include <thread>
+
+
+
+////////////
+// STATIC //
+////////////
+
+   // Special values:
+   Eng::Loader Eng::Loader::empty("[empty]");
+
+
+
+/////////////////////////
+// RESERVED STRUCTURES //
+/////////////////////////
+
+/**
+ * @brief Loader reserved structure.
+ */
+struct Eng::Loader::Reserved
+{
+   /**
+    * @brief Single loading request.
+    */
+   struct Job
+   {
+      std::string filename;                                 ///< File being loaded
+      std::thread thread;                                   ///< Decoding thread
+      std::atomic<Eng::Loader::Status> status;              ///< Current status
+      std::atomic<bool> ready;                              ///< True when the chunk table and the objects are available
+      std::atomic<bool> abort;                              ///< Asks the worker to quit
+      std::atomic<uint32_t> nrOfDecoded;                    ///< Number of chunks decoded so far (in file order)
+
+      // Owned by the worker until ready:
+      Eng::Serializer serial;                               ///< File content
+      std::vector<Eng::Ovo::ChunkInfo> table;               ///< Chunk table
+      std::vector<std::unique_ptr<Eng::Object>> object;     ///< Objects waiting for upload
+
+      // Owned by the main thread:
+      uint32_t nrOfUploaded;                                ///< Number of chunks uploaded so far
+      std::vector<Eng::Node *> node;                        ///< Scene graph elements, once stored in the container
+      std::reference_wrapper<Eng::Node> root;               ///< Root node
+
+
+      /**
+       * Constructor.
+       */
+      Job() : status{ Eng::Loader::Status::loading }, ready{ false }, abort{ false }, nrOfDecoded{ 0 },
+              nrOfUploaded{ 0 }, root{ Eng::Node::empty }
+      {}
+
+      /**
+       * Destructor.
+       */
+      ~Job()
+      {
+         abort = true;
+         if (thread.joinable())
+            thread.join();
+      }
+   };
+
+
+   std::map<Eng::Loader::Handle, std::unique_ptr<Job>> job;          ///< Requests, by handle
+   Eng::Loader::Handle nextHandle;                                   ///< Next handle to assign
+   uint64_t budget;                                                  ///< Upload budget per frame (in bytes)
+
+
+   /**
+    * Constructor.
+    */
+   Reserved() : nextHandle{ Eng::Loader::invalidHandle + 1 }, budget{ Eng::Loader::dfltBudget }
+   {}
+};
+
+
+
+//////////////////////////
+// BODY OF CLASS Loader //
+//////////////////////////
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Constructor.
+ */
+ENG_API Eng::Loader::Loader() : reserved(std::make_unique<Eng::Loader::Reserved>())
+{
+   ENG_LOG_DETAIL("[+]");
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Constructor with name.
+ * @param name node name
+ */
+ENG_API Eng::Loader::Loader(const std::string &name) : Eng::Object(name), reserved(std::make_unique<Eng::Loader::Reserved>())
+{
+   ENG_LOG_DETAIL("[+]");
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Move constructor.
+ */
+ENG_API Eng::Loader::Loader(Loader &&other) : Eng::Object(std::move(other)), reserved(std::move(other.reserved))
+{
+   ENG_LOG_DETAIL("[M]");
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Destructor.
+ */
+ENG_API Eng::Loader::~Loader()
+{
+   ENG_LOG_DETAIL("[-]");
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Get singleton instance.
+ */
+Eng::Loader ENG_API &Eng::Loader::getInstance()
+{
+   static Loader instance("[default]");
+   return instance;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Sets the maximum amount of data uploaded to the GPU by each update() call. At least one object is uploaded per
+ * call, regardless of its size.
+ * @param bytesPerFrame budget in bytes
+ */
+void ENG_API Eng::Loader::setBudget(uint64_t bytesPerFrame)
+{
+   reserved->budget = bytesPerFrame;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the upload budget per frame.
+ * @return budget in bytes
+ */
+uint64_t ENG_API Eng::Loader::getBudget() const
+{
+   return reserved->budget;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the status of a loading request.
+ * @param handle request handle
+ * @return status, or Status::none if the handle is unknown
+ */
+Eng::Loader::Status ENG_API Eng::Loader::getStatus(Handle handle) const
+{
+   auto it = reserved->job.find(handle);
+   if (it == reserved->job.end())
+      return Eng::Loader::Status::none;
+   return it->second->status;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the progress of a loading request, as the ratio of chunks already uploaded.
+ * @param handle request handle
+ * @return progress in the [0, 1] range
+ */
+float ENG_API Eng::Loader::getProgress(Handle handle) const
+{
+   auto it = reserved->job.find(handle);
+   if (it == reserved->job.end() || !it->second->ready)
+      return 0.0f;
+
+   const Reserved::Job &job = *it->second;
+   if (job.status == Eng::Loader::Status::done || job.table.empty())
+      return 1.0f;
+   return static_cast<float>(job.nrOfUploaded) / static_cast<float>(job.table.size());
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the root node of a loading request. The root is available as soon as it is uploaded: its children are
+ * attached progressively by the following update() calls.
+ * @param handle request handle
+ * @return root node or Node::empty if not (yet) available
+ */
+Eng::Node ENG_API &Eng::Loader::getRoot(Handle handle) const
+{
+   auto it = reserved->job.find(handle);
+   if (it == reserved->job.end())
+      return Eng::Node::empty;
+   return it->second->root;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Starts loading an OVO file in background and returns immediately.
+ * @param filename 3D file
+ * @return handle of the request, or invalidHandle if error
+ */
+Eng::Loader::Handle ENG_API Eng::Loader::load(const std::string &filename)
+{
+   // Safety net:
+   if (filename.empty())
+   {
+      ENG_LOG_ERROR("Invalid params");
+      return Eng::Loader::invalidHandle;
+   }
+
+   std::unique_ptr<Reserved::Job> job = std::make_unique<Reserved::Job>();
+   job->filename = filename;
+
+   // Decoding thread:
+   Reserved::Job *_job = job.get();
+   job->thread = std::thread([_job]()
+   {
+      Eng::Ovo ovo;
+      if (!ovo.open(_job->filename, _job->serial, _job->table))
+      {
+         _job->status = Eng::Loader::Status::failed;
+         return;
+      }
+
+      // Objects are only constructed here, registration happens in update():
+      _job->object.resize(_job->table.size());
+      for (uint32_t c = 0; c < _job->table.size(); c++)
+      {
+         _job->object[c] = Eng::Ovo::createObject(_job->table[c].id);
+         if (_job->object[c] == nullptr)
+            ENG_LOG_WARN("Unknown chunk ID (%u) found: ignored", static_cast<uint32_t>(_job->table[c].id));
+      }
+      _job->ready = true;
+
+      // Decode in file order, so that update() can upload as soon as possible:
+      const uint8_t *data = static_cast<const uint8_t *>(_job->serial.getData());
+      for (uint32_t c = 0; c < _job->table.size() && !_job->abort; c++)
+      {
+         Eng::Ovo *ovo = dynamic_cast<Eng::Ovo *>(_job->object[c].get());
+         if (ovo)
+         {
+            Eng::Serializer chunk(data + _job->table[c].position, _job->table[c].size);
+            ovo->loadChunk(chunk);
+         }
+         _job->nrOfDecoded = c + 1;
+      }
+   });
+
+   // Done:
+   Eng::Loader::Handle handle = reserved->nextHandle++;
+   reserved->job[handle] = std::move(job);
+   ENG_LOG_DEBUG("Streaming of file '%s' started (handle %u)", filename.c_str(), handle);
+   return handle;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Uploads the decoded objects to the GPU within the per-frame budget, stores them into the container and links them
+ * to the scene graph. Must be called once per frame from the thread owning the OpenGL context.
+ * @return TF
+ */
+bool ENG_API Eng::Loader::update()
+{
+   Eng::Container &container = Eng::Container::getInstance();
+   uint64_t spent = 0;
+   for (auto &j : reserved->job)
+   {
+      Reserved::Job &job = *j.second;
+      if (job.status != Eng::Loader::Status::loading)
+      {
+         if (job.thread.joinable())
+            job.thread.join();
+         continue;
+      }
+      if (!job.ready)
+         continue;
+      if (job.node.empty())
+         job.node.resize(job.table.size(), nullptr);
+
+      // Upload in file order (materials always precede the meshes using them):
+      const uint32_t nrOfDecoded = job.nrOfDecoded;
+      while (job.nrOfUploaded < nrOfDecoded && spent < reserved->budget)
+      {
+         const uint32_t c = job.nrOfUploaded++;
+         if (job.object[c] == nullptr)
+            continue;
+
+         Eng::Ovo *ovo = dynamic_cast<Eng::Ovo *>(job.object[c].get());
+         spent += ovo->getUploadSize();
+         ovo->upload();
+         container.add(*job.object[c]);
+         job.object[c].reset();
+
+         switch (job.table[c].id)
+         {
+            case Eng::Ovo::ChunkId::node:    job.node[c] = &container.getLastNode();  break;
+            case Eng::Ovo::ChunkId::mesh:    job.node[c] = &container.getLastMesh();  break;
+            case Eng::Ovo::ChunkId::light:   job.node[c] = &container.getLastLight(); break;
+            default:                                                                   break;
+         }
+
+         // Link (parents always precede their children):
+         if (job.node[c])
+         {
+            if (job.table[c].parent < 0)
+               job.root = *job.node[c];
+            else if (job.node[job.table[c].parent])
+               job.node[job.table[c].parent]->addChild(*job.node[c]);
+         }
+      }
+
+      // Completed?
+      if (job.nrOfUploaded == job.table.size())
+      {
+         job.thread.join();
+         job.status = Eng::Loader::Status::done;
+         job.serial.clear();
+         job.object.clear();
+         job.node.clear();
+         ENG_LOG_DEBUG("Streaming of file '%s' completed", job.filename.c_str());
+      }
+   }
+
+   // Done:
+   return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Aborts pending requests and forgets all handles. Objects already stored in the container are not affected.
+ * @return TF
+ */
+bool ENG_API Eng::Loader::reset()
+{
+   reserved->job.clear();
+
+   // Done:
+   return true;
+}
@@ -0,0 +1,88 @@
+/**
+ * @file		engine_loader.h
+ * @brief	Asynchronous (streaming) scene loader
+ *
+ * @author	Achille Peternier (achille.peternier@supsi.ch), (C) SUPSI
+ */
+#pragma once
+
+
+
+/**
+ * @brief Class for loading OVO files in background. CPU-side decoding runs on a worker thread, while GPU uploads are
+ *        drained by update() (invoked once per frame by Base::processEvents()) within a configurable budget. Objects
+ *        are added to the container and linked to the scene graph progressively. This class is a singleton.
+ */
+class ENG_API Loader final : public Eng::Object
+{
+//////////
+public: //
+//////////
+
+   // Special values:
+   static Loader empty;
+
+   // Consts:
+   static constexpr uint64_t dfltBudget = 8 * 1024 * 1024;   ///< Default upload budget per frame (in bytes)
+
+
+   /**
+    * @brief Handle to a loading request.
+    */
+   typedef uint32_t Handle;
+   static constexpr Handle invalidHandle = 0;                  ///< Returned on error
+
+
+   /**
+    * @brief Status of a loading request.
+    */
+   enum class Status : uint32_t
+   {
+      none,
+
+      // States:
+      loading,
+      done,
+      failed,
+
+      // Terminator:
+      last
+   };
+
+
+   // Const/dest:
+   Loader(Loader const &) = delete;
+   virtual ~Loader();
+
+   // Singleton:
+   static Loader &getInstance();
+
+   // Get/set:
+   void setBudget(uint64_t bytesPerFrame);
+   uint64_t getBudget() const;
+   Status getStatus(Handle handle) const;
+   float getProgress(Handle handle) const;
+   Eng::Node &getRoot(Handle handle) const;
+
+   // Management:
+   Handle load(const std::string &filename);
+   bool update();
+   bool reset();
+
+
+///////////
+private: //
+///////////
+
+   // Reserved:
+   struct Reserved;
+   std::unique_ptr<Reserved> reserved;
+
+   // Const/dest:
+   Loader(const std::string &name);
+   Loader();
+   Loader(Loader &&other);
+
+   // Workaround for disabling the unneeded rendering method:
+   using Object::render;
+};
@@ -18,6 +18,7 @@
    #include <stdarg.h>
    #include <stdio.h>   
    #include <fstream>    
+   #include <mutex>
 
 
 
@@ -32,6 +33,7 @@ struct Eng::Log::StaticReserved
 {
    std::ofstream outputFile;              ///< Textual output file   
    CustomCallbackProto customCallback;    ///< Optional callback invoked after each message
+   std::mutex mutex;                      ///< Serializes outputs coming from different threads
 
 
    /**
@@ -123,7 +125,7 @@ bool ENG_API Eng::Log::free()
  * @param fileName name of the file invoking the log
  * @param functionName name of the function invoking the log
  * @param text message, with custom series of params
- * @warning race conditions when run concurrently
+ * @warning lazy initialization is not thread-safe: log at least once from the main thread before spawning workers
  */
 bool ENG_API Eng::Log::log(level lvl, const char *fileName, const char *functionName, int32_t codeLine, const char *text, ...)
 {
@@ -185,6 +187,9 @@ bool ENG_API Eng::Log::log(level lvl, const char *fileName, const char *function
    if (lvl > Eng::Log::debugLvl)
       return returnMessage;
 
+   // Serialize outputs:
+   std::lock_guard<std::mutex> lock(staticReserved->mutex);
+
    // To file:
    staticReserved->outputFile << prefix << buffer << std::endl;
 
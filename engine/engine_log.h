@@ -25,7 +25,7 @@
 
 
 /**
- * @brief Logging facilities. Static components are lazy-loaded at first usage. Beware that it is not thread-safe yet.
+ * @brief Logging facilities. Static components are lazy-loaded at first usage. Outputs are serialized among threads, but the lazy-loading is not thread-safe.
  */
 class ENG_API Log final
 {
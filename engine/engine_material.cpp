@@ -23,6 +23,27 @@
    // Special values:
    Eng::Material Eng::Material::empty("[empty]");
 
+   // Size of the material uniform block (std140), i.e. of the first members of the reserved structure:
+   static constexpr uint64_t materialBlockSize = 48;
+
+
+   /**
+    * Maps a texture type to its slot in the material.
+    * @param type texture level
+    * @return slot or -1 if not supported
+    */
+   static int32_t materialSlot(Eng::Texture::Type type)
+   {
+      switch (type)
+      {
+         case Eng::Texture::Type::albedo:    return 0;
+         case Eng::Texture::Type::normal:    return 1;
+         case Eng::Texture::Type::roughness: return 2;
+         case Eng::Texture::Type::metalness: return 3;
+         default:                            return -1;
+      }
+   }
+
 
 
 /////////////////////////
@@ -34,7 +55,7 @@
  */
 struct Eng::Material::Reserved
 {
-   // Keep these vars first and in this order...:
+   // Keep these vars first and in this order (std140 layout of the material uniform block)...:
    glm::vec3 emission;                                   ///< Emissive term
    float opacity;                                        ///< Transparency (1 = solid, 0 = invisible)
    glm::vec3 albedo;                                     ///< Albedo color
@@ -44,6 +65,15 @@ struct Eng::Material::Reserved
    // ...48 bytes
 
    std::reference_wrapper<const Eng::Texture> texture[Eng::Material::maxNrOfTextures];
+   std::string cachedFile[Eng::Material::maxNrOfTextures];      ///< Container cache entry held by each slot (empty if none)
+
+   // Image files referenced by loadChunk(), and images waiting for upload() (decoded only when not already cached):
+   std::string textureFile[Eng::Material::maxNrOfTextures];
+   std::shared_ptr<const Eng::Bitmap> pendingBitmap[Eng::Material::maxNrOfTextures];
+
+   // Uniform block, uploaded on first use and after each change:
+   Eng::Ubo ubo;
+   bool uboDirty;
 
 
    /**
@@ -54,7 +84,8 @@ struct Eng::Material::Reserved
                 opacity{ 1.0f },
                 roughness{ 0.5f }, metalness{ 0.01f }, 
                 _pad{ 0.0f },
-                texture{ Eng::Texture::empty, Eng::Texture::empty, Eng::Texture::empty, Eng::Texture::empty }
+                texture{ Eng::Texture::empty, Eng::Texture::empty, Eng::Texture::empty, Eng::Texture::empty },
+                uboDirty{ true }
    {}
 };
 
@@ -102,6 +133,12 @@ ENG_API Eng::Material::Material(Material &&other) : Eng::Object(std::move(other)
 ENG_API Eng::Material::~Material()
 {
    ENG_LOG_DETAIL("[-]");
+
+   // Release the textures taken from the container cache:
+   if (reserved)
+      for (auto &file : reserved->cachedFile)
+         if (!file.empty())
+            Eng::Container::getInstance().releaseTexture(file);
 }
 
 
@@ -113,6 +150,7 @@ ENG_API Eng::Material::~Material()
 void ENG_API Eng::Material::setEmission(const glm::vec3 &emission)
 {
    reserved->emission = emission;
+   reserved->uboDirty = true;
    setDirty(true);
 }
 
@@ -125,6 +163,7 @@ void ENG_API Eng::Material::setEmission(const glm::vec3 &emission)
 void ENG_API Eng::Material::setAlbedo(const glm::vec3 &albedo)
 {
    reserved->albedo = albedo;
+   reserved->uboDirty = true;
    setDirty(true);
 }
 
@@ -137,6 +176,7 @@ void ENG_API Eng::Material::setAlbedo(const glm::vec3 &albedo)
 void ENG_API Eng::Material::setRoughness(float roughness)
 {
    reserved->roughness = roughness;
+   reserved->uboDirty = true;
    setDirty(true);
 }
 
@@ -149,6 +189,7 @@ void ENG_API Eng::Material::setRoughness(float roughness)
 void ENG_API Eng::Material::setMetalness(float metalness)
 {
    reserved->metalness = metalness;
+   reserved->uboDirty = true;
    setDirty(true);
 }
 
@@ -205,6 +246,7 @@ float ENG_API Eng::Material::getMetalness() const
 void ENG_API Eng::Material::setOpacity(float opacity)
 {
    reserved->opacity = opacity;
+   reserved->uboDirty = true;
    setDirty(true);
 }
 
@@ -222,23 +264,27 @@ float ENG_API Eng::Material::getOpacity() const
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
- * Sets texture. 
+ * Sets texture. A texture previously taken from the container cache for the same level is released. 
  * @param tex texture
  * @param type texture level
  * @return TF
  */
 bool ENG_API Eng::Material::setTexture(const Eng::Texture &tex, Eng::Texture::Type type)
 {  
+   // Safety net:
+   const int32_t slot = materialSlot(type);
+   if (slot == -1)
+   {
+      ENG_LOG_ERROR("Unsupported texture level");
+      return false;
+   }
+
    // Set texture accordingly:
-   switch (type)
-   {  
-      case Eng::Texture::Type::albedo:    reserved->texture[0] = tex; break;
-      case Eng::Texture::Type::normal:    reserved->texture[1] = tex; break;
-      case Eng::Texture::Type::roughness: reserved->texture[2] = tex; break;
-      case Eng::Texture::Type::metalness: reserved->texture[3] = tex; break;
-      default:
-         ENG_LOG_ERROR("Unsupported texture level");
-         return false;
+   reserved->texture[slot] = tex;
+   if (!reserved->cachedFile[slot].empty())
+   {
+      Eng::Container::getInstance().releaseTexture(reserved->cachedFile[slot]);
+      reserved->cachedFile[slot].clear();
    }
 
    // Done:
@@ -246,6 +292,37 @@ bool ENG_API Eng::Material::setTexture(const Eng::Texture &tex, Eng::Texture::Ty
 }
 
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Sets a texture taken from the container cache (see Container::acquireTexture()). The cache entry is held until the 
+ * texture is replaced or the material destroyed. 
+ * @param filename image file name
+ * @param type texture level
+ * @param bitmap optional already decoded image, used on a cache miss
+ * @return TF
+ */
+bool ENG_API Eng::Material::setCachedTexture(const std::string &filename, Eng::Texture::Type type, const Eng::Bitmap *bitmap)
+{
+   // Safety net:
+   const int32_t slot = materialSlot(type);
+   if (filename.empty() || slot == -1)
+   {
+      ENG_LOG_ERROR("Invalid params");
+      return false;
+   }
+
+   // Acquire first, in case the same file is already held by this slot:
+   Eng::Texture &tex = Eng::Container::getInstance().acquireTexture(filename, bitmap);
+   if (tex == Eng::Texture::empty)
+      return false;
+   this->setTexture(tex, type);
+   reserved->cachedFile[slot] = filename;
+
+   // Done:
+   return true;
+}
+
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
  * Gets texture. 
@@ -268,9 +345,32 @@ const Eng::Texture ENG_API &Eng::Material::getTexture(Eng::Texture::Type type) c
 }
 
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the image file name of a texture, as read from the file. 
+ * @param type texture level
+ * @return file name, empty if none
+ */
+const std::string ENG_API &Eng::Material::getTextureFile(Eng::Texture::Type type) const
+{
+   static const std::string none;
+   switch (type)
+   {
+      case Eng::Texture::Type::albedo:    return reserved->textureFile[0];    
+      case Eng::Texture::Type::normal:    return reserved->textureFile[1];
+      case Eng::Texture::Type::roughness: return reserved->textureFile[2];
+      case Eng::Texture::Type::metalness: return reserved->textureFile[3];
+      default:
+         ENG_LOG_ERROR("Unsupported texture level");
+         return none;
+   }
+}
+
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
  * Loads the specific information of a given object. In its base class, this function loads the file version chunk.
+ * Texture images are only decoded here (safe to call from a worker thread): OpenGL textures are created by upload().
  * @param serializer serial data
  * @param data optional pointer
  * @return 1 on success, 0 if error
@@ -300,42 +400,24 @@ uint32_t ENG_API Eng::Material::loadChunk(Eng::Serializer &serial, void *data)
    serial.deserialize(reserved->metalness);
    serial.deserialize(reserved->opacity);
 
-   // Textures:
-   Eng::Container &container = Eng::Container::getInstance();
+   // Textures (decoded into the slot used by setTexture(), once per file even across materials loaded in parallel):
+   auto decode = [this](const std::string &name, uint32_t slot)
+   {
+      if (name == "[none]")
+         return;
+      reserved->textureFile[slot] = name;
+      Eng::Container::getInstance().decodeTexture(name, reserved->pendingBitmap[slot]);
+   };
 
    // Albedo:
    serial.deserialize(name); 
    ENG_LOG_PLAIN("Texture (albedo): %s", name.c_str());
-   if (name != "[none]")
-   {
-      Eng::Bitmap bitmap;
-      if (!bitmap.load(name))
-         ENG_LOG_ERROR("Unable to load image file '%s'", name.c_str());
-      else
-      {
-         Eng::Texture tex;
-         tex.load(bitmap);
-         container.add(tex);     
-         this->setTexture(container.getLastTexture(), Eng::Texture::Type::albedo);
-      }
-   }
+   decode(name, 0);
 
    // Normal:
    serial.deserialize(name); 
    ENG_LOG_PLAIN("Texture (normal): %s", name.c_str());
-   if (name != "[none]")
-   {
-      Eng::Bitmap bitmap;
-      if (!bitmap.load(name))
-         ENG_LOG_ERROR("Unable to load image file '%s'", name.c_str());
-      else
-      {
-         Eng::Texture tex;
-         tex.load(bitmap);
-         container.add(tex);     
-         this->setTexture(container.getLastTexture(), Eng::Texture::Type::normal);
-      }
-   }
+   decode(name, 1);
 
    // Height (ignored):
    serial.deserialize(name); 
@@ -344,39 +426,65 @@ uint32_t ENG_API Eng::Material::loadChunk(Eng::Serializer &serial, void *data)
    // Roughness:
    serial.deserialize(name); 
    ENG_LOG_PLAIN("Texture (roughness): %s", name.c_str());
-   if (name != "[none]")
-   {
-      Eng::Bitmap bitmap;
-      if (!bitmap.load(name))
-         ENG_LOG_ERROR("Unable to load image file '%s'", name.c_str());
-      else
-      {
-         Eng::Texture tex;
-         tex.load(bitmap);
-         container.add(tex);     
-         this->setTexture(container.getLastTexture(), Eng::Texture::Type::roughness);
-      }
-   }
+   decode(name, 2);
 
    // Metalness:
-   serial.deserialize(name); // Metalness
+   serial.deserialize(name); 
    ENG_LOG_PLAIN("Texture (metalness): %s", name.c_str());
-   if (name != "[none]")
-   {
-      Eng::Bitmap bitmap;
-      if (!bitmap.load(name))
-         ENG_LOG_ERROR("Unable to load image file '%s'", name.c_str());
-      else
+   decode(name, 3);
+
+   // Done:
+   return 1;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Returns the size of the images decoded by loadChunk() and not yet uploaded.
+ * @return size in bytes
+ */
+uint64_t ENG_API Eng::Material::getUploadSize() const
+{
+   uint64_t size = 0;
+   for (uint32_t c = 0; c < Eng::Material::maxNrOfTextures; c++)
+      if (reserved->pendingBitmap[c])
       {
-         Eng::Texture tex;
-         tex.load(bitmap);
-         container.add(tex);     
-         this->setTexture(container.getLastTexture(), Eng::Texture::Type::metalness);
+         const Eng::Bitmap &bitmap = *reserved->pendingBitmap[c];
+         for (uint32_t s = 0; s < bitmap.getNrOfSides(); s++)
+            for (uint32_t l = 0; l < bitmap.getNrOfLevels(); l++)
+               size += bitmap.getNrOfBytes(l, s);
       }
-   }   
 
    // Done:
-   return 1;
+   return size;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Binds the textures referenced by loadChunk(), taking them from the container cache (so that each image file is 
+ * decoded and uploaded only once). Must be called from the thread owning the OpenGL context.
+ * @return TF
+ */
+bool ENG_API Eng::Material::upload()
+{
+   const Eng::Texture::Type slotType[Eng::Material::maxNrOfTextures] = { Eng::Texture::Type::albedo,
+                                                                          Eng::Texture::Type::normal,
+                                                                          Eng::Texture::Type::roughness,
+                                                                          Eng::Texture::Type::metalness };
+   bool result = true;
+   for (uint32_t c = 0; c < Eng::Material::maxNrOfTextures; c++)
+   {
+      if (reserved->textureFile[c].empty())
+         continue;
+
+      if (!this->setCachedTexture(reserved->textureFile[c], slotType[c], reserved->pendingBitmap[c].get()))
+         result = false;
+      reserved->pendingBitmap[c].reset();
+   }
+
+   // Done:
+   return result;
 }
 
 
@@ -391,11 +499,26 @@ bool ENG_API Eng::Material::render(uint32_t value, void *data) const
 {	
    Eng::Program &prog = Eng::Program::getCached();
 
-   // Pass (some) params:
-   prog.setVec3("mtlEmission", reserved->emission);
-   prog.setVec3("mtlAlbedo", reserved->albedo);
-   prog.setFloat("mtlRoughness", reserved->roughness);
-   prog.setFloat("mtlOpacity", reserved->opacity);
+   // Pass params (through the uniform block, when used by the program):
+   if (prog.hasUniformBlock(Eng::Ubo::materialBinding))
+   {
+      if (reserved->uboDirty)
+      {
+         if (reserved->ubo.getSize() == 0)
+            reserved->ubo.create(materialBlockSize, &reserved->emission);
+         else
+            reserved->ubo.update(&reserved->emission, materialBlockSize);
+         reserved->uboDirty = false;
+      }
+      reserved->ubo.render(Eng::Ubo::materialBinding);
+   }
+   else
+   {
+      prog.setVec3("mtlEmission", reserved->emission);
+      prog.setVec3("mtlAlbedo", reserved->albedo);
+      prog.setFloat("mtlRoughness", reserved->roughness);
+      prog.setFloat("mtlOpacity", reserved->opacity);
+   }
     
    // Pass textures:
    for (uint32_t c = 0; c < Eng::Material::maxNrOfTextures; c++)
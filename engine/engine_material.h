@@ -40,13 +40,17 @@ public: //
    float getRoughness() const;
    float getMetalness() const;   
    bool setTexture(const Eng::Texture &tex, Eng::Texture::Type type = Eng::Texture::Type::albedo);
+   bool setCachedTexture(const std::string &filename, Eng::Texture::Type type = Eng::Texture::Type::albedo, const Eng::Bitmap *bitmap = nullptr);
    const Eng::Texture &getTexture(Eng::Texture::Type type = Eng::Texture::Type::albedo) const;
+   const std::string &getTextureFile(Eng::Texture::Type type = Eng::Texture::Type::albedo) const;
 
    // Rendering methods:   
    bool render(uint32_t value = 0, void *data = nullptr) const;
 
    // Ovo:   
    uint32_t loadChunk(Eng::Serializer &serial, void *data = nullptr) override;
+   uint64_t getUploadSize() const override;
+   bool upload() override;
 
 
 ///////////
@@ -14,6 +14,10 @@
    // Main include:
    #include "engine.h"
 
+   // C/C++:
+   #include <algorithm>
+   #include <limits>
+
    // GLM:
    #include <glm/gtc/packing.hpp>  
 
@@ -30,6 +34,317 @@
    // Special values:
    Eng::Mesh Eng::Mesh::empty("[empty]");
 
+   // Vertex format:
+   Eng::Vbo::Format Eng::Mesh::dfltVertexFormat = Eng::Vbo::Format::full;
+
+   // Retained geometry:
+   bool Eng::Mesh::dfltRetainGeometry = false;
+
+
+   /**
+    * Simulates a FIFO post-transform vertex cache and counts the misses.
+    * @param faces face list
+    * @param nrOfVertices number of vertices
+    * @param cacheSize number of cache entries
+    * @return number of transformed vertices
+    */
+   static uint32_t meshSimulateCache(const std::vector<Eng::Ebo::FaceData> &faces, uint32_t nrOfVertices, uint32_t cacheSize)
+   {
+      std::vector<uint32_t> timestamp(nrOfVertices, 0);
+      uint32_t time = cacheSize + 1;
+      uint32_t misses = 0;
+      for (const auto &f : faces)
+      {
+         const uint32_t v[3] = { f.a, f.b, f.c };
+         for (uint32_t c = 0; c < 3; c++)
+            if (time - timestamp[v[c]] > cacheSize)
+            {
+               timestamp[v[c]] = time++;
+               misses++;
+            }
+      }
+      return misses;
+   }
+
+
+   /**
+    * Reorders triangles for vertex cache locality (Tipsify, Sander et al. 2007). The output is split into clusters
+    * at each dead-end, i.e. where the cache is expected to be flushed.
+    * @param faces face list, reordered in place
+    * @param nrOfVertices number of vertices
+    * @param cacheSize number of cache entries
+    * @param clusters filled with the first face of each cluster
+    */
+   static void meshTipsify(std::vector<Eng::Ebo::FaceData> &faces, uint32_t nrOfVertices, uint32_t cacheSize, std::vector<uint32_t> &clusters)
+   {
+      const uint32_t nrOfFaces = static_cast<uint32_t>(faces.size());
+
+      // Vertex-triangle adjacency (CSR):
+      std::vector<uint32_t> live(nrOfVertices, 0);
+      for (const auto &f : faces)
+      {
+         live[f.a]++;
+         live[f.b]++;
+         live[f.c]++;
+      }
+      std::vector<uint32_t> first(nrOfVertices + 1, 0);
+      for (uint32_t c = 0; c < nrOfVertices; c++)
+         first[c + 1] = first[c] + live[c];
+      std::vector<uint32_t> adjacency(first[nrOfVertices]);
+      std::vector<uint32_t> cursor(first.begin(), first.end() - 1);
+      for (uint32_t c = 0; c < nrOfFaces; c++)
+      {
+         adjacency[cursor[faces[c].a]++] = c;
+         adjacency[cursor[faces[c].b]++] = c;
+         adjacency[cursor[faces[c].c]++] = c;
+      }
+
+      std::vector<uint32_t> timestamp(nrOfVertices, 0);
+      std::vector<bool> emitted(nrOfFaces, false);
+      std::vector<uint32_t> deadEnd;
+      std::vector<uint32_t> candidates;
+      std::vector<Eng::Ebo::FaceData> output;
+      output.reserve(nrOfFaces);
+      clusters.clear();
+
+      uint32_t time = cacheSize + 1;
+      uint32_t scan = 0;
+      int64_t fanning = 0;
+      bool newCluster = true;
+      while (fanning >= 0)
+      {
+         // Emit all the live triangles around the fanning vertex:
+         candidates.clear();
+         for (uint32_t c = first[fanning]; c < first[fanning + 1]; c++)
+         {
+            const uint32_t t = adjacency[c];
+            if (emitted[t])
+               continue;
+            if (newCluster)
+            {
+               clusters.push_back(static_cast<uint32_t>(output.size()));
+               newCluster = false;
+            }
+            output.push_back(faces[t]);
+            emitted[t] = true;
+
+            const uint32_t v[3] = { faces[t].a, faces[t].b, faces[t].c };
+            for (uint32_t i = 0; i < 3; i++)
+            {
+               deadEnd.push_back(v[i]);
+               candidates.push_back(v[i]);
+               live[v[i]]--;
+               if (time - timestamp[v[i]] > cacheSize)
+                  timestamp[v[i]] = time++;
+            }
+         }
+
+         // Next fanning vertex, among the candidates still in cache:
+         fanning = -1;
+         int64_t best = -1;
+         for (uint32_t v : candidates)
+         {
+            if (live[v] == 0)
+               continue;
+            int64_t priority = 0;
+            if (time - timestamp[v] + 2 * live[v] <= cacheSize)
+               priority = time - timestamp[v];
+            if (priority > best)
+            {
+               best = priority;
+               fanning = v;
+            }
+         }
+         if (fanning >= 0)
+            continue;
+
+         // Dead-end, start a new cluster:
+         newCluster = true;
+         while (!deadEnd.empty() && fanning < 0)
+         {
+            const uint32_t v = deadEnd.back();
+            deadEnd.pop_back();
+            if (live[v] > 0)
+               fanning = v;
+         }
+         while (scan < nrOfVertices && fanning < 0)
+         {
+            if (live[scan] > 0)
+               fanning = scan;
+            scan++;
+         }
+      }
+
+      faces = std::move(output);
+   }
+
+
+   /**
+    * Sorts the clusters produced by meshTipsify() front to back with respect to the mesh center, so that faces
+    * oriented outwards are rasterized first and occlude the inner ones (overdraw reduction, Sander et al. 2007).
+    * @param faces face list, reordered in place
+    * @param vertices vertex list
+    * @param clusters first face of each cluster
+    */
+   static void meshSortClusters(std::vector<Eng::Ebo::FaceData> &faces, const std::vector<Eng::Vbo::VertexData> &vertices, const std::vector<uint32_t> &clusters)
+   {
+      const uint32_t nrOfClusters = static_cast<uint32_t>(clusters.size());
+      if (nrOfClusters < 2)
+         return;
+
+      // Mesh center, as the area-weighted centroid:
+      glm::vec3 meshCenter(0.0f);
+      float meshArea = 0.0f;
+      std::vector<glm::vec3> center(nrOfClusters, glm::vec3(0.0f));
+      std::vector<glm::vec3> normal(nrOfClusters, glm::vec3(0.0f));
+      std::vector<float> area(nrOfClusters, 0.0f);
+      for (uint32_t c = 0; c < nrOfClusters; c++)
+      {
+         const uint32_t end = (c + 1 < nrOfClusters) ? clusters[c + 1] : static_cast<uint32_t>(faces.size());
+         for (uint32_t t = clusters[c]; t < end; t++)
+         {
+            const glm::vec3 &p0 = vertices[faces[t].a].vertex;
+            const glm::vec3 &p1 = vertices[faces[t].b].vertex;
+            const glm::vec3 &p2 = vertices[faces[t].c].vertex;
+            const glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+            const float a = glm::length(n) * 0.5f;
+            center[c] += (p0 + p1 + p2) * (a / 3.0f);
+            normal[c] += n;
+            area[c] += a;
+         }
+         meshCenter += center[c];
+         meshArea += area[c];
+      }
+      if (meshArea > 0.0f)
+         meshCenter /= meshArea;
+
+      // Sort by decreasing outward orientation:
+      std::vector<float> sortKey(nrOfClusters, 0.0f);
+      for (uint32_t c = 0; c < nrOfClusters; c++)
+      {
+         if (area[c] <= 0.0f || glm::length(normal[c]) <= 0.0f)
+            continue;
+         sortKey[c] = glm::dot(center[c] / area[c] - meshCenter, glm::normalize(normal[c]));
+      }
+      std::vector<uint32_t> order(nrOfClusters);
+      for (uint32_t c = 0; c < nrOfClusters; c++)
+         order[c] = c;
+      std::stable_sort(order.begin(), order.end(), [&sortKey](uint32_t a, uint32_t b) { return sortKey[a] > sortKey[b]; });
+
+      std::vector<Eng::Ebo::FaceData> output;
+      output.reserve(faces.size());
+      for (uint32_t c : order)
+      {
+         const uint32_t end = (c + 1 < nrOfClusters) ? clusters[c + 1] : static_cast<uint32_t>(faces.size());
+         output.insert(output.end(), faces.begin() + clusters[c], faces.begin() + end);
+      }
+      faces = std::move(output);
+   }
+
+
+   /**
+    * Renumbers the vertices in order of first use, so that vertex fetches are (mostly) sequential. Unreferenced
+    * vertices are dropped.
+    * @param faces face list, remapped in place
+    * @param vertices vertex list, reordered in place
+    */
+   static void meshRemapVertices(std::vector<Eng::Ebo::FaceData> &faces, std::vector<Eng::Vbo::VertexData> &vertices)
+   {
+      constexpr uint32_t unused = 0xFFFFFFFF;
+      std::vector<uint32_t> remap(vertices.size(), unused);
+      std::vector<Eng::Vbo::VertexData> output;
+      output.reserve(vertices.size());
+      for (auto &f : faces)
+      {
+         uint32_t *v[3] = { &f.a, &f.b, &f.c };
+         for (uint32_t c = 0; c < 3; c++)
+         {
+            if (remap[*v[c]] == unused)
+            {
+               remap[*v[c]] = static_cast<uint32_t>(output.size());
+               output.push_back(vertices[*v[c]]);
+            }
+            *v[c] = remap[*v[c]];
+         }
+      }
+      vertices = std::move(output);
+   }
+
+
+   /**
+    * Splits the given faces into meshlets of consecutive faces, each referencing at most Mesh::maxMeshletVertices
+    * unique vertices and Mesh::maxMeshletFaces faces, and computes their bounding spheres and normal cones.
+    * @param vertices vertex list
+    * @param faces face list (indices relative to vertices)
+    * @param nrOfFaces number of faces
+    * @param meshlets filled with the meshlets
+    */
+   static void meshBuildMeshlets(const Eng::Vbo::VertexData *vertices, const Eng::Ebo::FaceData *faces, uint32_t nrOfFaces, std::vector<Eng::Mesh::Meshlet> &meshlets)
+   {
+      meshlets.clear();
+      std::vector<uint32_t> used;
+      used.reserve(Eng::Mesh::maxMeshletVertices);
+      uint32_t first = 0;
+      for (uint32_t c = 0; c <= nrOfFaces; c++)
+      {
+         // Can the face be added to the current meshlet?
+         if (c < nrOfFaces)
+         {
+            const uint32_t v[3] = { faces[c].a, faces[c].b, faces[c].c };
+            uint32_t fresh[3];
+            uint32_t nrOfNew = 0;
+            for (uint32_t i = 0; i < 3; i++)
+               if (std::find(used.begin(), used.end(), v[i]) == used.end() && std::find(fresh, fresh + nrOfNew, v[i]) == fresh + nrOfNew)
+                  fresh[nrOfNew++] = v[i];
+            if (used.size() + nrOfNew <= Eng::Mesh::maxMeshletVertices && c - first < Eng::Mesh::maxMeshletFaces)
+            {
+               used.insert(used.end(), fresh, fresh + nrOfNew);
+               continue;
+            }
+         }
+         if (c == first)
+            continue;
+
+         // Close the meshlet, bounding sphere:
+         Eng::Mesh::Meshlet m;
+         m.firstFace = first;
+         m.nrOfFaces = c - first;
+         glm::vec3 bboxMin(std::numeric_limits<float>::max()), bboxMax(-std::numeric_limits<float>::max());
+         for (uint32_t v : used)
+         {
+            bboxMin = glm::min(bboxMin, vertices[v].vertex);
+            bboxMax = glm::max(bboxMax, vertices[v].vertex);
+         }
+         m.center = (bboxMin + bboxMax) * 0.5f;
+         m.radius = 0.0f;
+         for (uint32_t v : used)
+            m.radius = glm::max(m.radius, glm::length(vertices[v].vertex - m.center));
+
+         // Normal cone:
+         glm::vec3 axis(0.0f);
+         std::vector<glm::vec3> normal(m.nrOfFaces, glm::vec3(0.0f));
+         for (uint32_t t = 0; t < m.nrOfFaces; t++)
+         {
+            const Eng::Ebo::FaceData &f = faces[first + t];
+            const glm::vec3 n = glm::cross(vertices[f.b].vertex - vertices[f.a].vertex, vertices[f.c].vertex - vertices[f.a].vertex);
+            if (glm::length(n) > 0.0f)
+               normal[t] = glm::normalize(n);
+            axis += normal[t];
+         }
+         m.coneAxis = (glm::length(axis) > 0.0f) ? glm::normalize(axis) : glm::vec3(0.0f, 0.0f, 1.0f);
+         float minDot = 1.0f;
+         for (const auto &n : normal)
+            minDot = glm::min(minDot, glm::dot(n, m.coneAxis));
+         m.coneCutoff = (minDot <= 0.0f) ? 1.0f : glm::sqrt(1.0f - minDot * minDot);
+         meshlets.push_back(m);
+
+         // Next one:
+         used.clear();
+         first = c;
+         c--;
+      }
+   }
+
 
 
 /////////////////////////
@@ -46,14 +361,50 @@ struct Eng::Mesh::Reserved
    Eng::Vbo vbo;
    Eng::Ebo ebo;
 
+   // Position-only stream for depth passes (shares the index buffer):
+   Eng::Vao depthVao;
+   Eng::Vbo depthVbo;
+
    // Material:
    std::reference_wrapper<const Eng::Material> material;
+   std::string materialName;
+
+   // Bounding volumes:
+   float radius;
+   glm::vec3 bboxMin;
+   glm::vec3 bboxMax;
+
+   // Decoding of quantized positions (identity if not quantized):
+   glm::mat4 decodeMat;
+
+   // Levels of detail (ranges of the buffers):
+   std::vector<Eng::Mesh::Lod> lods;
+
+   // Meshlets of LOD 0 and per-frame multi-draw arguments:
+   std::vector<Eng::Mesh::Meshlet> meshlets;
+   mutable std::vector<GLsizei> drawCount;
+   mutable std::vector<void *> drawOffset;
+   mutable std::vector<GLint> drawBaseVertex;
+   mutable uint32_t nrOfVisibleMeshlets;
+
+   // Retained CPU geometry of LOD 0, for ray casting:
+   Eng::TriangleBvh triangleBvh;
+
+   // Software occlusion culling:
+   bool occluder;
+
+   // Never moved nor changed (e.g., cached in static shadow maps):
+   bool isStatic;
+
+   // Decoded data waiting for upload (all LODs, packed):
+   std::vector<Eng::Vbo::VertexData> vertices;
+   std::vector<Eng::Ebo::FaceData> faces;
    
 
    /**
     * Constructor
     */
-   Reserved() : material{ Eng::Material::empty }
+   Reserved() : material{ Eng::Material::empty }, radius{ 0.0f }, bboxMin{ 0.0f }, bboxMax{ 0.0f }, decodeMat{ 1.0f }, nrOfVisibleMeshlets{ 0 }, occluder{ false }, isStatic{ false }
    {}
 };
 
@@ -130,9 +481,446 @@ const Eng::Material ENG_API &Eng::Mesh::getMaterial() const
 }
 
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the name of the material, as read from the file.  
+ * @return material name
+ */
+const std::string ENG_API &Eng::Mesh::getMaterialName() const
+{
+   return reserved->materialName;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the radius of the bounding sphere (centered at the origin of the mesh).  
+ * @return radius
+ */
+float ENG_API Eng::Mesh::getRadius() const
+{
+   return reserved->radius;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the minimum corner of the bounding box.  
+ * @return bounding box minimum
+ */
+const glm::vec3 ENG_API &Eng::Mesh::getBBoxMin() const
+{
+   return reserved->bboxMin;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the maximum corner of the bounding box.  
+ * @return bounding box maximum
+ */
+const glm::vec3 ENG_API &Eng::Mesh::getBBoxMax() const
+{
+   return reserved->bboxMax;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the vertices decoded by loadChunk(). Empty once uploaded.  
+ * @return vertices
+ */
+const std::vector<Eng::Vbo::VertexData> ENG_API &Eng::Mesh::getVertexData() const
+{
+   return reserved->vertices;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the faces decoded by loadChunk(). Empty once uploaded.  
+ * @return faces
+ */
+const std::vector<Eng::Ebo::FaceData> ENG_API &Eng::Mesh::getFaceData() const
+{
+   return reserved->faces;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the levels of detail, as ranges of the vertex and face data. LOD 0 is the most detailed.  
+ * @return levels of detail
+ */
+const std::vector<Eng::Mesh::Lod> ENG_API &Eng::Mesh::getLods() const
+{
+   return reserved->lods;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the number of levels of detail.  
+ * @return number of LODs
+ */
+uint32_t ENG_API Eng::Mesh::getNrOfLods() const
+{
+   return static_cast<uint32_t>(reserved->lods.size());
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the meshlets of LOD 0 (empty when the mesh is too small to be split).  
+ * @return meshlets
+ */
+const std::vector<Eng::Mesh::Meshlet> ENG_API &Eng::Mesh::getMeshlets() const
+{
+   return reserved->meshlets;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the number of meshlets drawn by the last renderCulled() call.  
+ * @return number of visible meshlets
+ */
+uint32_t ENG_API Eng::Mesh::getNrOfVisibleMeshlets() const
+{
+   return reserved->nrOfVisibleMeshlets;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Sets the vertex format used by the following create() calls (and therefore by OVO and cooked loading). With
+ * Vbo::Format::quantized, positions are stored as 16-bit unorm within the bounding box and decoded by the modelview
+ * matrix, for a 16-byte vertex.
+ * @param format vertex format
+ */
+void ENG_API Eng::Mesh::setDfltVertexFormat(Eng::Vbo::Format format)
+{
+   // Safety net:
+   if (format != Eng::Vbo::Format::full && format != Eng::Vbo::Format::quantized)
+   {
+      ENG_LOG_ERROR("Invalid params");
+      return;
+   }
+
+   dfltVertexFormat = format;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the vertex format used by create().
+ * @return vertex format
+ */
+Eng::Vbo::Format ENG_API Eng::Mesh::getDfltVertexFormat()
+{
+   return dfltVertexFormat;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the vertex format of this mesh.
+ * @return vertex format or Vbo::Format::none if not created
+ */
+Eng::Vbo::Format ENG_API Eng::Mesh::getVertexFormat() const
+{
+   return reserved->vbo.getFormat();
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Sets whether the following create() calls (and therefore OVO and cooked loading) keep a CPU copy of LOD 0, arranged 
+ * in a triangle BVH for ray casting (picking, visibility, baking, etc.).
+ * @param retain true to retain the geometry
+ */
+void ENG_API Eng::Mesh::setDfltRetainGeometry(bool retain)
+{
+   dfltRetainGeometry = retain;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets whether create() retains a CPU copy of the geometry.
+ * @return TF
+ */
+bool ENG_API Eng::Mesh::getDfltRetainGeometry()
+{
+   return dfltRetainGeometry;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the triangle BVH over LOD 0, in mesh coordinates (empty if the geometry was not retained).
+ * @return triangle BVH
+ */
+const Eng::TriangleBvh ENG_API &Eng::Mesh::getTriangleBvh() const
+{
+   return reserved->triangleBvh;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Marks this mesh as occluder for the software occlusion culling (see List::setOcclusionCulling()). Occluders are
+ * rasterized with their retained triangles when available, or with their bounding box otherwise: the latter is only
+ * correct for meshes filling their box (walls, floors, pillars, etc.).
+ * @param occluder true to use this mesh as occluder
+ */
+void ENG_API Eng::Mesh::setOccluder(bool occluder)
+{
+   reserved->occluder = occluder;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets whether this mesh is used as occluder.
+ * @return TF
+ */
+bool ENG_API Eng::Mesh::isOccluder() const
+{
+   return reserved->occluder;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Marks this mesh as static, i.e. neither moved nor modified from frame to frame. Static meshes are rendered into 
+ * cached shadow maps, which are only refreshed when the light or a static mesh changes.
+ * @param isStatic true if static
+ */
+void ENG_API Eng::Mesh::setStatic(bool isStatic)
+{
+   reserved->isStatic = isStatic;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets whether this mesh is static.
+ * @return TF
+ */
+bool ENG_API Eng::Mesh::isStatic() const
+{
+   return reserved->isStatic;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the per-object data to store into the object uniform block for a given placement.
+ * @param modelViewMat modelview matrix
+ * @return per-object data
+ */
+Eng::Mesh::ObjectBlock ENG_API Eng::Mesh::getObjectBlock(const glm::mat4 &modelViewMat) const
+{
+   ObjectBlock block;
+   block.modelviewMat = modelViewMat * reserved->decodeMat;
+   block.normalMat = glm::mat4(glm::inverseTranspose(glm::mat3(modelViewMat)));
+
+   // Done:
+   return block;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Creates the GPU buffers directly from the given data. 
+ * @param vertices pointer to vertex data
+ * @param nrOfVertices number of vertices
+ * @param faces pointer to face data
+ * @param nrOfFaces number of faces
+ * @param radius bounding sphere radius
+ * @param bboxMin bounding box minimum
+ * @param bboxMax bounding box maximum
+ * @param lods optional levels of detail packed in the given data (a single LOD covering all the data if nullptr)
+ * @param nrOfLods number of levels of detail
+ * @return TF
+ */
+bool ENG_API Eng::Mesh::create(const Eng::Vbo::VertexData *vertices, uint32_t nrOfVertices, const Eng::Ebo::FaceData *faces, uint32_t nrOfFaces, 
+                               float radius, const glm::vec3 &bboxMin, const glm::vec3 &bboxMax, const Lod *lods, uint32_t nrOfLods)
+{
+   // Safety net:
+   if (vertices == nullptr || faces == nullptr)
+   {
+      ENG_LOG_ERROR("Invalid params");
+      return false;
+   }
+
+   // Levels of detail:
+   if (lods && nrOfLods)
+   {
+      for (uint32_t c = 0; c < nrOfLods; c++)
+         if (static_cast<uint64_t>(lods[c].baseVertex) + lods[c].nrOfVertices > nrOfVertices || 
+             static_cast<uint64_t>(lods[c].firstFace) + lods[c].nrOfFaces > nrOfFaces)
+         {
+            ENG_LOG_ERROR("Invalid LOD ranges");
+            return false;
+         }
+      reserved->lods.assign(lods, lods + nrOfLods);
+   }
+   else
+      reserved->lods = { { 0, nrOfVertices, 0, nrOfFaces } };
+
+   reserved->radius = radius;
+   reserved->bboxMin = bboxMin;
+   reserved->bboxMax = bboxMax;
+
+   // Buffers:
+   reserved->vao.init();
+   reserved->vao.render();
+
+   std::vector<uint16_t> quantizedPositions;
+   std::vector<glm::vec3> positions;
+   if (dfltVertexFormat == Eng::Vbo::Format::quantized)
+   {
+      // Quantize positions within the bounding box (degenerate axes are left at 0):
+      const glm::vec3 extent = bboxMax - bboxMin;
+      const glm::vec3 scale = glm::vec3(extent.x > 0.0f ? 65535.0f / extent.x : 0.0f,
+                                        extent.y > 0.0f ? 65535.0f / extent.y : 0.0f,
+                                        extent.z > 0.0f ? 65535.0f / extent.z : 0.0f);
+      std::vector<Eng::Vbo::QuantizedVertexData> quantized(nrOfVertices);
+      for (uint32_t c = 0; c < nrOfVertices; c++)
+      {
+         const glm::vec3 q = glm::clamp((vertices[c].vertex - bboxMin) * scale + 0.5f, glm::vec3(0.0f), glm::vec3(65535.0f));
+         quantized[c].vertex[0] = static_cast<uint16_t>(q.x);
+         quantized[c].vertex[1] = static_cast<uint16_t>(q.y);
+         quantized[c].vertex[2] = static_cast<uint16_t>(q.z);
+         quantized[c].normal = vertices[c].normal;
+         quantized[c].uv = vertices[c].uv;
+         quantized[c].tangent = vertices[c].tangent;
+      }
+      reserved->vbo.create(nrOfVertices, quantized.data(), Eng::Vbo::Format::quantized);
+      quantizedPositions.resize(nrOfVertices * 4);
+      for (uint32_t c = 0; c < nrOfVertices; c++)
+         std::copy(quantized[c].vertex, quantized[c].vertex + 3, quantizedPositions.begin() + c * 4);
+      reserved->decodeMat = glm::scale(glm::translate(glm::mat4(1.0f), bboxMin), extent);
+   }
+   else
+   {
+      reserved->vbo.create(nrOfVertices, vertices);
+      reserved->decodeMat = glm::mat4(1.0f);
+      positions.resize(nrOfVertices);
+      for (uint32_t c = 0; c < nrOfVertices; c++)
+         positions[c] = vertices[c].vertex;
+   }
+   reserved->ebo.create(nrOfFaces, faces);
+
+   reserved->depthVao.init();
+   reserved->depthVao.render();
+   if (quantizedPositions.empty())
+      reserved->depthVbo.create(nrOfVertices, positions.data(), Eng::Vbo::Format::position);
+   else
+      reserved->depthVbo.create(nrOfVertices, quantizedPositions.data(), Eng::Vbo::Format::quantizedPosition);
+   reserved->ebo.render();
+
+   // Meshlets (LOD 0 only):
+   const Eng::Mesh::Lod &lod = reserved->lods.front();
+   if (lod.nrOfFaces > maxMeshletFaces)
+      meshBuildMeshlets(vertices + lod.baseVertex, faces + lod.firstFace, lod.nrOfFaces, reserved->meshlets);
+   else
+      reserved->meshlets.clear();
+
+   // Retained geometry (LOD 0 only):
+   if (dfltRetainGeometry && lod.nrOfFaces)
+      reserved->triangleBvh.build(vertices + lod.baseVertex, lod.nrOfVertices, faces + lod.firstFace, lod.nrOfFaces);
+   else
+      reserved->triangleBvh.reset();
+
+   // Done:
+   return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Optimizes the data decoded by loadChunk() before upload: triangles are reordered for post-transform vertex cache
+ * locality (Tipsify), the resulting clusters are sorted to reduce overdraw and vertices are renumbered for sequential
+ * fetch. The average cache miss ratio (ACMR, misses per triangle) and average transform to vertex ratio (ATVR, misses
+ * per vertex) are logged before and after. CPU only, rendering output is unchanged.
+ * @param cacheSize number of entries of the simulated vertex cache
+ * @return TF
+ */
+bool ENG_API Eng::Mesh::optimize(uint32_t cacheSize)
+{
+   // Safety net:
+   if (cacheSize < 3)
+   {
+      ENG_LOG_ERROR("Invalid params");
+      return false;
+   }
+   if (reserved->vertices.empty() || reserved->faces.empty())
+   {
+      ENG_LOG_ERROR("No data to optimize (mesh '%s' already uploaded?)", this->getName().c_str());
+      return false;
+   }
+   for (const auto &lod : reserved->lods)
+      for (uint32_t c = lod.firstFace; c < lod.firstFace + lod.nrOfFaces; c++)
+      {
+         const Eng::Ebo::FaceData &f = reserved->faces[c];
+         if (f.a >= lod.nrOfVertices || f.b >= lod.nrOfVertices || f.c >= lod.nrOfVertices)
+         {
+            ENG_LOG_ERROR("Mesh '%s' has out of range indices", this->getName().c_str());
+            return false;
+         }
+      }
+
+   // Optimize each LOD separately:
+   std::vector<Eng::Vbo::VertexData> vertices;
+   std::vector<Eng::Ebo::FaceData> faces;
+   vertices.reserve(reserved->vertices.size());
+   faces.reserve(reserved->faces.size());
+   for (uint32_t l = 0; l < reserved->lods.size(); l++)
+   {
+      Eng::Mesh::Lod &lod = reserved->lods[l];
+      std::vector<Eng::Vbo::VertexData> lodVertices(reserved->vertices.begin() + lod.baseVertex, reserved->vertices.begin() + lod.baseVertex + lod.nrOfVertices);
+      std::vector<Eng::Ebo::FaceData> lodFaces(reserved->faces.begin() + lod.firstFace, reserved->faces.begin() + lod.firstFace + lod.nrOfFaces);
+      if (!lodFaces.empty())
+      {
+         const float nrOfFaces = static_cast<float>(lodFaces.size());
+         const float nrOfVerticesBefore = static_cast<float>(lod.nrOfVertices);   // Unused vertices are dropped by the remap
+         const uint32_t before = meshSimulateCache(lodFaces, lod.nrOfVertices, cacheSize);
+
+         std::vector<uint32_t> clusters;
+         meshTipsify(lodFaces, lod.nrOfVertices, cacheSize, clusters);
+         meshSortClusters(lodFaces, lodVertices, clusters);
+         meshRemapVertices(lodFaces, lodVertices);
+
+         // Report:
+         const uint32_t after = meshSimulateCache(lodFaces, static_cast<uint32_t>(lodVertices.size()), cacheSize);
+         const float nrOfVerticesAfter = static_cast<float>(lodVertices.size());
+         ENG_LOG_PLAIN("Mesh '%s', LOD %u: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, %u clusters", this->getName().c_str(), l,
+                       before / nrOfFaces, after / nrOfFaces, before / nrOfVerticesBefore, after / nrOfVerticesAfter, static_cast<uint32_t>(clusters.size()));
+      }
+
+      // Repack:
+      lod.baseVertex = static_cast<uint32_t>(vertices.size());
+      lod.nrOfVertices = static_cast<uint32_t>(lodVertices.size());
+      lod.firstFace = static_cast<uint32_t>(faces.size());
+      vertices.insert(vertices.end(), lodVertices.begin(), lodVertices.end());
+      faces.insert(faces.end(), lodFaces.begin(), lodFaces.end());
+   }
+   reserved->vertices = std::move(vertices);
+   reserved->faces = std::move(faces);
+
+   // Done:
+   return true;
+}
+
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
  * Loads the specific information of a given object. In its base class, this function loads the file version chunk.
+ * This method only decodes data on the CPU (and is safe to call from a worker thread): OpenGL buffers and material
+ * binding are deferred to upload().
  * @param serializer serial data
  * @param data optional pointer
  * @return TF
@@ -169,20 +957,11 @@ uint32_t ENG_API Eng::Mesh::loadChunk(Eng::Serializer &serial, void *data)
    uint8_t subtype;
    serial.deserialize(subtype);
    
-   std::string materialName;
-   serial.deserialize(materialName);      
-   std::reference_wrapper<const Eng::Material> mat = Eng::Material::empty;
-   mat = dynamic_cast<Eng::Material &>(Eng::Container::getInstance().find(materialName));
-   this->setMaterial(mat);
-
-   float radius;
-   serial.deserialize(radius);
-
-   glm::vec3 bboxMin;
-   serial.deserialize(bboxMin);
+   serial.deserialize(reserved->materialName);      
 
-   glm::vec3 bboxMax;
-   serial.deserialize(bboxMax);
+   serial.deserialize(reserved->radius);
+   serial.deserialize(reserved->bboxMin);
+   serial.deserialize(reserved->bboxMax);
 
    uint8_t hasPhysics;
    serial.deserialize(hasPhysics);
@@ -195,6 +974,10 @@ uint32_t ENG_API Eng::Mesh::loadChunk(Eng::Serializer &serial, void *data)
    uint32_t nrOfLods;
    serial.deserialize(nrOfLods);
 
+   // All LODs are packed into the same buffers:
+   reserved->lods.clear();
+   reserved->vertices.clear();
+   reserved->faces.clear();
    for (uint32_t curLod = 0; curLod < nrOfLods; curLod++)
    {
       uint32_t nrOfVertices;
@@ -205,21 +988,18 @@ uint32_t ENG_API Eng::Mesh::loadChunk(Eng::Serializer &serial, void *data)
 
       ENG_LOG_PLAIN("LOD: %u, v: %u, f: %u", curLod + 1, nrOfVertices, nrOfFaces);
 
-      std::vector<Eng::Vbo::VertexData> allVertices(nrOfVertices);
-      serial.deserialize(allVertices.data(), nrOfVertices * sizeof(Eng::Vbo::VertexData));
+      Eng::Mesh::Lod lod;
+      lod.baseVertex = static_cast<uint32_t>(reserved->vertices.size());
+      lod.nrOfVertices = nrOfVertices;
+      lod.firstFace = static_cast<uint32_t>(reserved->faces.size());
+      lod.nrOfFaces = nrOfFaces;
+      reserved->lods.push_back(lod);
 
-      std::vector<Eng::Ebo::FaceData> allFaces(nrOfFaces);
-      serial.deserialize(allFaces.data(), nrOfFaces * sizeof(Eng::Ebo::FaceData));
+      reserved->vertices.resize(lod.baseVertex + nrOfVertices);
+      serial.deserialize(reserved->vertices.data() + lod.baseVertex, nrOfVertices * sizeof(Eng::Vbo::VertexData));
 
-      // Store only first LOD for now:
-      if (curLod == 0)
-      {
-         reserved->vao.init();
-         reserved->vao.render();
-         
-         reserved->vbo.create(nrOfVertices, allVertices.data());
-         reserved->ebo.create(nrOfFaces, allFaces.data());
-      }
+      reserved->faces.resize(lod.firstFace + nrOfFaces);
+      serial.deserialize(reserved->faces.data() + lod.firstFace, nrOfFaces * sizeof(Eng::Ebo::FaceData));
    }   
 
    // Done:      
@@ -229,22 +1009,198 @@ uint32_t ENG_API Eng::Mesh::loadChunk(Eng::Serializer &serial, void *data)
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
- * Rendering method. 
- * @param value generic value
- * @param data generic pointer to any kind of data
+ * Returns the size of the vertex and index data decoded by loadChunk() and not yet uploaded.
+ * @return size in bytes
+ */
+uint64_t ENG_API Eng::Mesh::getUploadSize() const
+{
+   return reserved->vertices.size() * (sizeof(Eng::Vbo::VertexData) + sizeof(glm::vec3)) + reserved->faces.size() * sizeof(Eng::Ebo::FaceData);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Uploads the data decoded by loadChunk() to the GPU and binds the material. Must be called from the thread owning 
+ * the OpenGL context, after the mesh material has been added to the container.
  * @return TF
  */
-bool ENG_API Eng::Mesh::render(uint32_t value, void *data) const
+bool ENG_API Eng::Mesh::upload()
+{
+   // Material:
+   std::reference_wrapper<const Eng::Material> mat = Eng::Material::empty;
+   mat = dynamic_cast<Eng::Material &>(Eng::Container::getInstance().find(reserved->materialName));
+   this->setMaterial(mat);
+
+   // Buffers:
+   create(reserved->vertices.data(), static_cast<uint32_t>(reserved->vertices.size()), 
+          reserved->faces.data(), static_cast<uint32_t>(reserved->faces.size()),
+          reserved->radius, reserved->bboxMin, reserved->bboxMax, reserved->lods.data(), static_cast<uint32_t>(reserved->lods.size()));
+
+   // Release staging data:
+   reserved->vertices.clear();
+   reserved->vertices.shrink_to_fit();
+   reserved->faces.clear();
+   reserved->faces.shrink_to_fit();
+
+   // Done:
+   return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Sets the uniforms, material and vertex arrays needed for drawing. 
+ * @param modelViewMat modelview matrix
+ */
+void ENG_API Eng::Mesh::setup(const glm::mat4 &modelViewMat) const
 {	
+   // Per-object data (unless read from the object uniform block, bound by List::render()):
    Eng::Program &program = dynamic_cast<Eng::Program &>(Eng::Program::getCached());
-   program.setMat4("modelviewMat", *((glm::mat4 *) data));
-   program.setMat3("normalMat", glm::inverseTranspose(glm::mat3(*((glm::mat4 *) data))));
+   if (!program.hasUniformBlock(Eng::Ubo::objectBinding))
+   {
+      program.setMat4("modelviewMat", modelViewMat * reserved->decodeMat);
+      program.setMat3("normalMat", glm::inverseTranspose(glm::mat3(modelViewMat)));
+   }
 
    reserved->material.get().render();
   
    reserved->vao.render();   
-   glDrawElements(GL_TRIANGLES, reserved->ebo.getNrOfFaces() * 3, GL_UNSIGNED_INT, nullptr);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Rendering method. 
+ * @param value level of detail to render (clamped to the coarsest available)
+ * @param data pointer to the modelview matrix
+ * @return TF
+ */
+bool ENG_API Eng::Mesh::render(uint32_t value, void *data) const
+{	
+   // Safety net:
+   if (reserved->lods.empty())
+      return true;
+   const Eng::Mesh::Lod &lod = reserved->lods[std::min(value, static_cast<uint32_t>(reserved->lods.size()) - 1)];
+
+   setup(*((glm::mat4 *) data));
+
+   const GLenum indexType = reserved->ebo.getOglIndexType();
+   const uint64_t offset = static_cast<uint64_t>(lod.firstFace) * 3 * reserved->ebo.getIndexSize();
+   glDrawElementsBaseVertex(GL_TRIANGLES, lod.nrOfFaces * 3, indexType, reinterpret_cast<void *>(offset), lod.baseVertex);
    
    // Done:
    return true;
 }
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Rendering method with per-meshlet culling. Meshlets outside the view frustum or whose normal cone faces away from 
+ * the viewer are skipped, the others are drawn with a single multi-draw call. Falls back to render() for LODs other 
+ * than 0 and for meshes without meshlets.
+ * @param lod level of detail to render
+ * @param modelViewMat modelview matrix
+ * @param projMatrix projection matrix
+ * @return TF
+ */
+bool ENG_API Eng::Mesh::renderCulled(uint32_t lod, const glm::mat4 &modelViewMat, const glm::mat4 &projMatrix) const
+{	
+   if (lod != 0 || reserved->meshlets.empty())
+   {
+      reserved->nrOfVisibleMeshlets = 0;
+      return render(lod, const_cast<glm::mat4 *>(&modelViewMat));
+   }
+
+   // Frustum planes in view space (Gribb/Hartmann):
+   const glm::mat4 m = glm::transpose(projMatrix);
+   glm::vec4 plane[6] = { m[3] + m[0], m[3] - m[0], m[3] + m[1], m[3] - m[1], m[3] + m[2], m[3] - m[2] };
+   for (auto &p : plane)
+      p /= glm::length(glm::vec3(p));
+
+   // Scale and normal transform:
+   const glm::vec3 scale(glm::length(glm::vec3(modelViewMat[0])), glm::length(glm::vec3(modelViewMat[1])), glm::length(glm::vec3(modelViewMat[2])));
+   const float maxScale = glm::max(scale.x, glm::max(scale.y, scale.z));
+   const bool isUniform = maxScale - glm::min(scale.x, glm::min(scale.y, scale.z)) <= maxScale * 0.01f;
+   const glm::mat3 normalMat = glm::inverseTranspose(glm::mat3(modelViewMat));
+
+   // Cull:
+   const Eng::Mesh::Lod &base = reserved->lods.front();
+   const uint32_t indexSize = reserved->ebo.getIndexSize();
+   reserved->drawCount.clear();
+   reserved->drawOffset.clear();
+   reserved->drawBaseVertex.clear();
+   reserved->nrOfVisibleMeshlets = 0;
+   for (const auto &meshlet : reserved->meshlets)
+   {
+      const glm::vec3 center = glm::vec3(modelViewMat * glm::vec4(meshlet.center, 1.0f));
+      const float radius = meshlet.radius * maxScale;
+
+      bool visible = true;
+      for (uint32_t p = 0; p < 6 && visible; p++)
+         if (glm::dot(glm::vec3(plane[p]), center) + plane[p].w < -radius)
+            visible = false;
+      if (visible && isUniform && meshlet.coneCutoff < 1.0f)
+      {
+         const glm::vec3 axis = glm::normalize(normalMat * meshlet.coneAxis);
+         if (glm::dot(center, axis) >= meshlet.coneCutoff * glm::length(center) + radius)
+            visible = false;
+      }
+      if (!visible)
+         continue;
+      reserved->nrOfVisibleMeshlets++;
+
+      // Merge with the previous range when contiguous:
+      const uint64_t offset = static_cast<uint64_t>(base.firstFace + meshlet.firstFace) * 3 * indexSize;
+      if (!reserved->drawCount.empty() && 
+          reinterpret_cast<uint64_t>(reserved->drawOffset.back()) + reserved->drawCount.back() * indexSize == offset)
+      {
+         reserved->drawCount.back() += meshlet.nrOfFaces * 3;
+         continue;
+      }
+      reserved->drawCount.push_back(meshlet.nrOfFaces * 3);
+      reserved->drawOffset.push_back(reinterpret_cast<void *>(offset));
+      reserved->drawBaseVertex.push_back(base.baseVertex);
+   }
+   if (reserved->drawCount.empty())
+      return true;
+
+   // Draw:
+   setup(modelViewMat);
+   const GLenum indexType = reserved->ebo.getOglIndexType();
+   glMultiDrawElementsBaseVertex(GL_TRIANGLES, reserved->drawCount.data(), indexType, reserved->drawOffset.data(),
+                                 static_cast<GLsizei>(reserved->drawCount.size()), reserved->drawBaseVertex.data());
+
+   // Done:
+   return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Depth-only rendering method (e.g., for shadow maps): only the modelview matrix is set, the material is not bound 
+ * and vertices are fetched from a position-only stream. Requires a program reading just the vertex position.
+ * @param lod level of detail to render (clamped to the coarsest available)
+ * @param modelViewMat modelview matrix
+ * @param modelviewUniform location of "modelviewMat" in the current program, when already resolved
+ * @return TF
+ */
+bool ENG_API Eng::Mesh::renderDepth(uint32_t lod, const glm::mat4 &modelViewMat, Eng::Program::Uniform<glm::mat4> modelviewUniform) const
+{
+   // Safety net:
+   if (reserved->lods.empty())
+      return true;
+   const Eng::Mesh::Lod &range = reserved->lods[std::min(lod, static_cast<uint32_t>(reserved->lods.size()) - 1)];
+
+   Eng::Program &program = dynamic_cast<Eng::Program &>(Eng::Program::getCached());
+   if (!modelviewUniform.isValid())
+      modelviewUniform = program.getUniform<glm::mat4>("modelviewMat");
+   program.set(modelviewUniform, modelViewMat * reserved->decodeMat);
+   reserved->depthVao.render();
+
+   const GLenum indexType = reserved->ebo.getOglIndexType();
+   const uint64_t offset = static_cast<uint64_t>(range.firstFace) * 3 * reserved->ebo.getIndexSize();
+   glDrawElementsBaseVertex(GL_TRIANGLES, range.nrOfFaces * 3, indexType, reinterpret_cast<void *>(offset), range.baseVertex);
+
+   // Done:
+   return true;
+}
@@ -20,6 +20,47 @@ public: //
    // Special values:
    static Mesh empty;   
 
+   // Consts:
+   static constexpr uint32_t dfltCacheSize = 16;         ///< Post-transform vertex cache size assumed by optimize()
+   static constexpr uint32_t maxMeshletVertices = 64;    ///< Max number of unique vertices per meshlet
+   static constexpr uint32_t maxMeshletFaces = 124;      ///< Max number of faces per meshlet
+
+
+   /**
+    * @brief Level of detail, as a range of the vertex and face buffers (indices are relative to baseVertex)
+    */
+   struct Lod
+   {
+      uint32_t baseVertex;       ///< First vertex
+      uint32_t nrOfVertices;     ///< Number of vertices
+      uint32_t firstFace;        ///< First face
+      uint32_t nrOfFaces;        ///< Number of faces
+   };
+
+
+   /**
+    * @brief Cluster of adjacent faces of LOD 0, with its bounding volumes (in mesh coordinates)
+    */
+   struct Meshlet
+   {
+      glm::vec3 center;          ///< Bounding sphere center
+      float radius;              ///< Bounding sphere radius
+      glm::vec3 coneAxis;        ///< Average normal of the faces
+      float coneCutoff;          ///< Sine of the normal cone half-angle (1 if the cone is too wide for culling)
+      uint32_t firstFace;        ///< First face
+      uint32_t nrOfFaces;        ///< Number of faces
+   };
+
+
+   /**
+    * @brief Per-object data, as read by shaders from the object uniform block (std140, see Ubo::objectBinding)
+    */
+   struct ObjectBlock
+   {
+      glm::mat4 modelviewMat;    ///< Modelview matrix (including the decoding of quantized positions)
+      glm::mat4 normalMat;       ///< Normal matrix (a mat3 in std140 is stored as three vec4 columns)
+   };
+
    // Const/dest:
    Mesh();
    Mesh(Mesh &&other);
@@ -32,12 +73,42 @@ public: //
    // Get/set:
    bool setMaterial(const Eng::Material &mat);
    const Eng::Material &getMaterial() const;
+   const std::string &getMaterialName() const;
+   float getRadius() const;
+   const glm::vec3 &getBBoxMin() const;
+   const glm::vec3 &getBBoxMax() const;
+   const std::vector<Eng::Vbo::VertexData> &getVertexData() const;
+   const std::vector<Eng::Ebo::FaceData> &getFaceData() const;
+   const std::vector<Lod> &getLods() const;
+   uint32_t getNrOfLods() const;
+   const std::vector<Meshlet> &getMeshlets() const;
+   uint32_t getNrOfVisibleMeshlets() const;
+   static void setDfltVertexFormat(Eng::Vbo::Format format);
+   static Eng::Vbo::Format getDfltVertexFormat();
+   Eng::Vbo::Format getVertexFormat() const;
+   static void setDfltRetainGeometry(bool retain);
+   static bool getDfltRetainGeometry();
+   const Eng::TriangleBvh &getTriangleBvh() const;
+   void setOccluder(bool occluder);
+   bool isOccluder() const;
+   void setStatic(bool isStatic);
+   bool isStatic() const;
+   ObjectBlock getObjectBlock(const glm::mat4 &modelViewMat) const;
+
+   // Geometry:
+   bool create(const Eng::Vbo::VertexData *vertices, uint32_t nrOfVertices, const Eng::Ebo::FaceData *faces, uint32_t nrOfFaces, 
+               float radius, const glm::vec3 &bboxMin, const glm::vec3 &bboxMax, const Lod *lods = nullptr, uint32_t nrOfLods = 0);
+   bool optimize(uint32_t cacheSize = dfltCacheSize);
    
    // Rendering methods:   
    bool render(uint32_t value = 0, void *data = nullptr) const;   
+   bool renderCulled(uint32_t lod, const glm::mat4 &modelViewMat, const glm::mat4 &projMatrix) const;
+   bool renderDepth(uint32_t lod, const glm::mat4 &modelViewMat, Eng::Program::Uniform<glm::mat4> modelviewUniform = Eng::Program::Uniform<glm::mat4>()) const;
 
    // Ovo:   
    uint32_t loadChunk(Eng::Serializer &serial, void *data = nullptr) override;
+   uint64_t getUploadSize() const override;
+   bool upload() override;
 
 
 ///////////
@@ -48,8 +119,17 @@ private: //
    struct Reserved;
    std::unique_ptr<Reserved> reserved;
 
+   // Vertex format used by create():
+   static Eng::Vbo::Format dfltVertexFormat;
+
+   // CPU copy of LOD 0 for ray casting, built by create():
+   static bool dfltRetainGeometry;
+
    // Const/dest:
    Mesh(const std::string &name);
+
+   // Rendering:
+   void setup(const glm::mat4 &modelViewMat) const;
 };
 
 
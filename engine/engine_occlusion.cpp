@@ -0,0 +1,596 @@
+/**
+ * @file		engine_occlusion.cpp
+ * @brief	Software hierarchical-Z occlusion culling
+ *
+ * @author	Achille Peternier (achille.peternier@supsi.ch), (C) SUPSI
+ */
+
+
+
+//////////////
+// #INCLUDE //
+//////////////
+
+   // Main include:
+   #include "engine.h"
+
+   // C/C++:
+   #include <algorithm>
+   #include <atomic>
+   #include <condition_variable>
+   #include <mutex>
+   #include <thread>
+
+   // SIMD:
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+   #define ENG_OCCLUSION_SSE
+   #include <emmintrin.h>
+#endif
+
+
+
+////////////
+// STATIC //
+////////////
+
+   // Special values:
+   Eng::Occlusion Eng::Occlusion::empty("[empty]");
+
+   // Box corners, as 12 triangles:
+   static constexpr uint8_t occlusionBoxFaces[36] = { 0, 2, 1,  1, 2, 3,  4, 5, 6,  5, 7, 6,  0, 1, 4,  1, 5, 4,
+                                                      2, 6, 3,  3, 6, 7,  0, 4, 2,  2, 4, 6,  1, 3, 5,  3, 7, 5 };
+
+
+
+/////////////////////////
+// RESERVED STRUCTURES //
+/////////////////////////
+
+/**
+ * @brief Occlusion reserved structure.
+ */
+struct Eng::Occlusion::Reserved
+{
+   /**
+    * @brief Group of occluder triangles sharing the same model matrix.
+    */
+   struct Batch
+   {
+      glm::mat4 matrix;       ///< Model matrix
+      uint32_t first;         ///< First vertex
+      uint32_t count;         ///< Number of vertices (3 per triangle)
+   };
+
+
+   // Occluders (written by the main thread, read by the worker while busy):
+   std::vector<glm::vec3> vertex;                        ///< Triangle soup, in model coordinates
+   std::vector<Batch> batch;                             ///< Batches
+   glm::mat4 viewProjMatrix;                             ///< View-projection matrix of the last rasterize()
+
+   // Hi-Z pyramid (level 0 is the depth buffer):
+   uint32_t sizeX;                                       ///< Width of level 0
+   uint32_t sizeY;                                       ///< Height of level 0
+   std::vector<std::vector<float>> level;                ///< Levels, row-major
+   std::vector<glm::uvec2> levelSize;                    ///< Size of each level
+   bool ready;                                           ///< True when the pyramid matches the last rasterize()
+
+   // Worker:
+   std::thread thread;                                   ///< Rasterization thread (started on first use)
+   std::mutex mutex;                                     ///< Guards the flags below
+   std::condition_variable cv;                           ///< Signals flag changes
+   std::atomic<bool> busy;                               ///< Rasterization requested or running
+   bool quit;                                            ///< Asks the worker to quit
+
+
+   /**
+    * Constructor.
+    */
+   Reserved() : viewProjMatrix{ 1.0f }, sizeX{ 0 }, sizeY{ 0 }, ready{ false }, busy{ false }, quit{ false }
+   {
+      resize(Eng::Occlusion::dfltSizeX, Eng::Occlusion::dfltSizeY);
+   }
+
+   /**
+    * Destructor.
+    */
+   ~Reserved()
+   {
+      if (thread.joinable())
+      {
+         {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+         }
+         cv.notify_all();
+         thread.join();
+      }
+   }
+
+   /**
+    * Allocates the pyramid.
+    * @param _sizeX width (multiple of 4)
+    * @param _sizeY height
+    */
+   void resize(uint32_t _sizeX, uint32_t _sizeY)
+   {
+      sizeX = _sizeX;
+      sizeY = _sizeY;
+      level.clear();
+      levelSize.clear();
+      glm::uvec2 size(sizeX, sizeY);
+      while (true)
+      {
+         level.push_back(std::vector<float>(size.x * size.y, 1.0f));
+         levelSize.push_back(size);
+         if (size.x == 1 && size.y == 1)
+            break;
+         size = glm::max(glm::uvec2(1), (size + 1u) / 2u);
+      }
+      ready = false;
+   }
+
+   /**
+    * Rasterizes a triangle in screen coordinates into level 0, keeping the nearest depth.
+    * @param a first vertex (x, y in pixels, z depth in [0, 1])
+    * @param b second vertex
+    * @param c third vertex
+    */
+   void rasterize(glm::vec3 a, glm::vec3 b, glm::vec3 c)
+   {
+      // Counter-clockwise:
+      float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+      if (glm::abs(area) < 1e-8f)
+         return;
+      if (area < 0.0f)
+      {
+         std::swap(b, c);
+         area = -area;
+      }
+
+      // Bounds:
+      const int32_t minX = std::max(0, static_cast<int32_t>(glm::floor(std::min(a.x, std::min(b.x, c.x)))));
+      const int32_t maxX = std::min(static_cast<int32_t>(sizeX) - 1, static_cast<int32_t>(glm::floor(std::max(a.x, std::max(b.x, c.x)))));
+      const int32_t minY = std::max(0, static_cast<int32_t>(glm::floor(std::min(a.y, std::min(b.y, c.y)))));
+      const int32_t maxY = std::min(static_cast<int32_t>(sizeY) - 1, static_cast<int32_t>(glm::floor(std::max(a.y, std::max(b.y, c.y)))));
+      if (minX > maxX || minY > maxY)
+         return;
+
+      // Edge functions (E = A * x + B * y + C, positive inside), each weighting the opposite vertex:
+      const glm::vec3 eA(b.y - c.y, c.y - a.y, a.y - b.y);
+      const glm::vec3 eB(c.x - b.x, a.x - c.x, b.x - a.x);
+      const glm::vec3 eC(b.x * c.y - b.y * c.x, c.x * a.y - c.y * a.x, a.x * b.y - a.y * b.x);
+      const glm::vec3 z = glm::vec3(a.z, b.z, c.z) / area;
+
+      float *depth = level[0].data();
+      const int32_t startX = minX & ~3;
+      for (int32_t y = minY; y <= maxY; y++)
+      {
+         const float py = y + 0.5f;
+         const glm::vec3 row = eB * py + eC;
+         float *line = depth + y * sizeX;
+
+#ifdef ENG_OCCLUSION_SSE
+         const __m128 zero = _mm_setzero_ps();
+         for (int32_t x = startX; x <= maxX; x += 4)
+         {
+            const __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f));
+            const __m128 e0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(eA.x), px), _mm_set1_ps(row.x));
+            const __m128 e1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(eA.y), px), _mm_set1_ps(row.y));
+            const __m128 e2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(eA.z), px), _mm_set1_ps(row.z));
+            const __m128 mask = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+            if (_mm_movemask_ps(mask) == 0)
+               continue;
+            const __m128 pz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e0, _mm_set1_ps(z.x)), _mm_mul_ps(e1, _mm_set1_ps(z.y))), _mm_mul_ps(e2, _mm_set1_ps(z.z)));
+            const __m128 old = _mm_loadu_ps(line + x);
+            _mm_storeu_ps(line + x, _mm_or_ps(_mm_and_ps(mask, _mm_min_ps(old, pz)), _mm_andnot_ps(mask, old)));
+         }
+#else
+         for (int32_t x = startX; x <= maxX; x++)
+         {
+            const float px = x + 0.5f;
+            const glm::vec3 e = eA * px + row;
+            if (e.x < 0.0f || e.y < 0.0f || e.z < 0.0f)
+               continue;
+            line[x] = std::min(line[x], glm::dot(e, z));
+         }
+#endif
+      }
+   }
+
+   /**
+    * Clips a triangle in clip coordinates against the near plane, then rasterizes it.
+    * @param v clip coordinates of the 3 vertices
+    */
+   void rasterize(const glm::vec4 *v)
+   {
+      // Trivial rejection:
+      for (uint32_t axis = 0; axis < 3; axis++)
+      {
+         if (v[0][axis] > v[0].w && v[1][axis] > v[1].w && v[2][axis] > v[2].w)
+            return;
+         if (axis < 2 && v[0][axis] < -v[0].w && v[1][axis] < -v[1].w && v[2][axis] < -v[2].w)
+            return;
+      }
+
+      // Near plane (z >= -w), at most 4 vertices:
+      glm::vec4 poly[4];
+      uint32_t nrOfVertices = 0;
+      for (uint32_t c = 0; c < 3; c++)
+      {
+         const glm::vec4 &p = v[c];
+         const glm::vec4 &q = v[(c + 1) % 3];
+         const float dp = p.z + p.w;
+         const float dq = q.z + q.w;
+         if (dp >= 0.0f)
+            poly[nrOfVertices++] = p;
+         if ((dp >= 0.0f) != (dq >= 0.0f))
+            poly[nrOfVertices++] = p + (q - p) * (dp / (dp - dq));
+      }
+      if (nrOfVertices < 3)
+         return;
+
+      // Screen coordinates:
+      glm::vec3 s[4];
+      for (uint32_t c = 0; c < nrOfVertices; c++)
+      {
+         const float invW = 1.0f / glm::max(poly[c].w, 1e-6f);
+         s[c] = glm::vec3((poly[c].x * invW * 0.5f + 0.5f) * sizeX,
+                          (poly[c].y * invW * 0.5f + 0.5f) * sizeY,
+                          glm::clamp(poly[c].z * invW * 0.5f + 0.5f, 0.0f, 1.0f));
+      }
+      rasterize(s[0], s[1], s[2]);
+      if (nrOfVertices == 4)
+         rasterize(s[0], s[2], s[3]);
+   }
+
+   /**
+    * Rasterizes all the occluders and builds the pyramid (worker side).
+    */
+   void process()
+   {
+      std::fill(level[0].begin(), level[0].end(), 1.0f);
+
+      // Occluders:
+      for (const Batch &b : batch)
+      {
+         const glm::mat4 mvp = viewProjMatrix * b.matrix;
+         for (uint32_t c = b.first; c + 2 < b.first + b.count; c += 3)
+         {
+            const glm::vec4 v[3] = { mvp * glm::vec4(vertex[c], 1.0f), mvp * glm::vec4(vertex[c + 1], 1.0f), mvp * glm::vec4(vertex[c + 2], 1.0f) };
+            rasterize(v);
+         }
+      }
+
+      // Pyramid (farthest depth of each 2x2 block):
+      for (uint32_t l = 1; l < level.size(); l++)
+      {
+         const glm::uvec2 src = levelSize[l - 1];
+         const glm::uvec2 dst = levelSize[l];
+         const float *in = level[l - 1].data();
+         float *out = level[l].data();
+         for (uint32_t y = 0; y < dst.y; y++)
+         {
+            const uint32_t y0 = std::min(2 * y, src.y - 1);
+            const uint32_t y1 = std::min(2 * y + 1, src.y - 1);
+            for (uint32_t x = 0; x < dst.x; x++)
+            {
+               const uint32_t x0 = std::min(2 * x, src.x - 1);
+               const uint32_t x1 = std::min(2 * x + 1, src.x - 1);
+               out[y * dst.x + x] = std::max(std::max(in[y0 * src.x + x0], in[y0 * src.x + x1]),
+                                             std::max(in[y1 * src.x + x0], in[y1 * src.x + x1]));
+            }
+         }
+      }
+   }
+
+   /**
+    * Worker loop.
+    */
+   void run()
+   {
+      std::unique_lock<std::mutex> lock(mutex);
+      while (true)
+      {
+         cv.wait(lock, [this] { return busy || quit; });
+         if (quit)
+            return;
+
+         lock.unlock();
+         process();
+         lock.lock();
+
+         busy = false;
+         cv.notify_all();
+      }
+   }
+};
+
+
+
+/////////////////////////////
+// BODY OF CLASS Occlusion //
+/////////////////////////////
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Constructor.
+ */
+ENG_API Eng::Occlusion::Occlusion() : reserved(std::make_unique<Eng::Occlusion::Reserved>())
+{
+   ENG_LOG_DETAIL("[+]");
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Constructor with name.
+ * @param name node name
+ */
+ENG_API Eng::Occlusion::Occlusion(const std::string &name) : Eng::Object(name), reserved(std::make_unique<Eng::Occlusion::Reserved>())
+{
+   ENG_LOG_DETAIL("[+]");
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Move constructor.
+ */
+ENG_API Eng::Occlusion::Occlusion(Occlusion &&other) : Eng::Object(std::move(other)), reserved(std::move(other.reserved))
+{
+   ENG_LOG_DETAIL("[M]");
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Destructor.
+ */
+ENG_API Eng::Occlusion::~Occlusion()
+{
+   ENG_LOG_DETAIL("[-]");
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Sets the resolution of the depth buffer. Waits for a pending rasterization and invalidates the pyramid.
+ * @param sizeX width (rounded up to a multiple of 4)
+ * @param sizeY height
+ * @return TF
+ */
+bool ENG_API Eng::Occlusion::setSize(uint32_t sizeX, uint32_t sizeY)
+{
+   // Safety net:
+   if (sizeX == 0 || sizeY == 0)
+   {
+      ENG_LOG_ERROR("Invalid params");
+      return false;
+   }
+
+   wait();
+   reserved->resize((sizeX + 3) & ~3u, sizeY);
+
+   // Done:
+   return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the resolution of the depth buffer.
+ * @return width and height
+ */
+glm::uvec2 ENG_API Eng::Occlusion::getSize() const
+{
+   return glm::uvec2(reserved->sizeX, reserved->sizeY);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the number of occluder triangles added since the last reset().
+ * @return number of faces
+ */
+uint32_t ENG_API Eng::Occlusion::getNrOfOccluderFaces() const
+{
+   return static_cast<uint32_t>(reserved->vertex.size() / 3);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the number of levels of the Hi-Z pyramid.
+ * @return number of levels
+ */
+uint32_t ENG_API Eng::Occlusion::getNrOfLevels() const
+{
+   return static_cast<uint32_t>(reserved->level.size());
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Removes all the occluders (waits for a pending rasterization).
+ */
+void ENG_API Eng::Occlusion::reset()
+{
+   wait();
+   reserved->vertex.clear();
+   reserved->batch.clear();
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Adds the triangles of a retained geometry as occluder.
+ * @param geometry triangles (see Mesh::setDfltRetainGeometry())
+ * @param matrix model matrix
+ * @return TF
+ */
+bool ENG_API Eng::Occlusion::addOccluder(const Eng::TriangleBvh &geometry, const glm::mat4 &matrix)
+{
+   // Safety net:
+   if (geometry.getNrOfFaces() == 0)
+   {
+      ENG_LOG_ERROR("Invalid params");
+      return false;
+   }
+
+   wait();
+   Reserved::Batch b;
+   b.matrix = matrix;
+   b.first = static_cast<uint32_t>(reserved->vertex.size());
+   b.count = geometry.getTriangles(reserved->vertex) * 3;
+   reserved->batch.push_back(b);
+
+   // Done:
+   return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Adds a box as occluder. Only suitable for geometry filling its bounding box (walls, floors, pillars, etc.).
+ * @param box box in model coordinates
+ * @param matrix model matrix
+ * @return TF
+ */
+bool ENG_API Eng::Occlusion::addOccluder(const Eng::Bvh::Aabb &box, const glm::mat4 &matrix)
+{
+   wait();
+   Reserved::Batch b;
+   b.matrix = matrix;
+   b.first = static_cast<uint32_t>(reserved->vertex.size());
+   b.count = 36;
+   for (uint32_t c = 0; c < 36; c++)
+   {
+      const uint8_t corner = occlusionBoxFaces[c];
+      reserved->vertex.push_back(glm::vec3((corner & 1) ? box.max.x : box.min.x,
+                                           (corner & 2) ? box.max.y : box.min.y,
+                                           (corner & 4) ? box.max.z : box.min.z));
+   }
+   reserved->batch.push_back(b);
+
+   // Done:
+   return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Starts rasterizing the occluders on the worker thread and returns immediately. Call wait() before isVisible().
+ * @param viewProjMatrix projection matrix times inverse camera matrix
+ * @return TF
+ */
+bool ENG_API Eng::Occlusion::rasterize(const glm::mat4 &viewProjMatrix)
+{
+   wait();
+   reserved->viewProjMatrix = viewProjMatrix;
+   reserved->ready = true;
+
+   // Lazy-start the worker:
+   if (!reserved->thread.joinable())
+   {
+      Reserved *r = reserved.get();
+      reserved->thread = std::thread([r]() { r->run(); });
+   }
+
+   {
+      std::lock_guard<std::mutex> lock(reserved->mutex);
+      reserved->busy = true;
+   }
+   reserved->cv.notify_all();
+
+   // Done:
+   return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Blocks until the pending rasterization (if any) is complete.
+ * @return TF
+ */
+bool ENG_API Eng::Occlusion::wait()
+{
+   std::unique_lock<std::mutex> lock(reserved->mutex);
+   reserved->cv.wait(lock, [this] { return !reserved->busy; });
+
+   // Done:
+   return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Tests a box against the pyramid built by the last rasterize() (after wait()). The test is conservative: boxes
+ * crossing the near plane, off-screen or tested before any rasterization are reported as visible.
+ * @param box box in world coordinates
+ * @return false if the box is entirely hidden by the occluders
+ */
+bool ENG_API Eng::Occlusion::isVisible(const Eng::Bvh::Aabb &box) const
+{
+   if (!reserved->ready || reserved->busy)
+      return true;
+
+   // Screen-space bounds and nearest depth:
+   glm::vec2 sMin(std::numeric_limits<float>::max()), sMax(-std::numeric_limits<float>::max());
+   float zMin = std::numeric_limits<float>::max();
+   for (uint32_t c = 0; c < 8; c++)
+   {
+      const glm::vec4 p = reserved->viewProjMatrix * glm::vec4((c & 1) ? box.max.x : box.min.x,
+                                                               (c & 2) ? box.max.y : box.min.y,
+                                                               (c & 4) ? box.max.z : box.min.z, 1.0f);
+      if (p.w <= 1e-6f || p.z < -p.w)
+         return true;
+      const glm::vec3 ndc = glm::vec3(p) / p.w;
+      sMin = glm::min(sMin, glm::vec2(ndc));
+      sMax = glm::max(sMax, glm::vec2(ndc));
+      zMin = std::min(zMin, ndc.z * 0.5f + 0.5f);
+   }
+   if (sMax.x < -1.0f || sMax.y < -1.0f || sMin.x > 1.0f || sMin.y > 1.0f)
+      return true;
+
+   // Pixel rectangle:
+   const glm::vec2 size(static_cast<float>(reserved->sizeX), static_cast<float>(reserved->sizeY));
+   const glm::ivec2 maxPixel(reserved->sizeX - 1, reserved->sizeY - 1);
+   glm::ivec2 p0 = glm::clamp(glm::ivec2(glm::floor((sMin * 0.5f + 0.5f) * size)), glm::ivec2(0), maxPixel);
+   glm::ivec2 p1 = glm::clamp(glm::ivec2(glm::floor((sMax * 0.5f + 0.5f) * size)), glm::ivec2(0), maxPixel);
+
+   // Level where the rectangle spans at most 2x2 texels:
+   uint32_t l = 0;
+   while (l + 1 < reserved->level.size() && std::max(p1.x - p0.x, p1.y - p0.y) > 1)
+   {
+      p0 /= 2;
+      p1 /= 2;
+      l++;
+   }
+
+   // Farthest occluder depth within the rectangle:
+   const glm::uvec2 levelSize = reserved->levelSize[l];
+   const float *depth = reserved->level[l].data();
+   float zMax = 0.0f;
+   for (int32_t y = p0.y; y <= p1.y; y++)
+      for (int32_t x = p0.x; x <= p1.x; x++)
+         zMax = std::max(zMax, depth[y * levelSize.x + x]);
+
+   // Done:
+   return zMin <= zMax;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets a texel of the pyramid (for debugging).
+ * @param x column
+ * @param y row (bottom-up)
+ * @param level pyramid level
+ * @return depth in [0, 1], or 1 if out of range
+ */
+float ENG_API Eng::Occlusion::getDepth(uint32_t x, uint32_t y, uint32_t level) const
+{
+   if (level >= reserved->level.size() || x >= reserved->levelSize[level].x || y >= reserved->levelSize[level].y || reserved->busy)
+      return 1.0f;
+   return reserved->level[level][y * reserved->levelSize[level].x + x];
+}
@@ -0,0 +1,68 @@
+/**
+ * @file		engine_occlusion.h
+ * @brief	Software hierarchical-Z occlusion culling
+ *
+ * @author	Achille Peternier (achille.peternier@supsi.ch), (C) SUPSI
+ */
+#pragma once
+
+
+
+/**
+ * @brief Software occlusion culler. Occluders (triangles or boxes) are rasterized on the CPU into a low resolution
+ *        depth buffer, from which a hierarchical-Z pyramid (farthest depth per texel) is built. World-space boxes are
+ *        then tested against the pyramid. Rasterization runs on a worker thread (4 pixels at a time with SSE), so
+ *        that it overlaps with other CPU work between rasterize() and wait(). No GPU queries are involved.
+ */
+class ENG_API Occlusion final : public Eng::Object
+{
+//////////
+public: //
+//////////
+
+   // Special values:
+   static Occlusion empty;
+
+   // Consts:
+   static constexpr uint32_t dfltSizeX = 256;            ///< Default depth buffer width (multiple of 4)
+   static constexpr uint32_t dfltSizeY = 128;            ///< Default depth buffer height
+
+
+   // Const/dest:
+   Occlusion();
+   Occlusion(Occlusion &&other);
+   Occlusion(Occlusion const &) = delete;
+   virtual ~Occlusion();
+
+   // Get/set:
+   bool setSize(uint32_t sizeX, uint32_t sizeY);
+   glm::uvec2 getSize() const;
+   uint32_t getNrOfOccluderFaces() const;
+   uint32_t getNrOfLevels() const;
+
+   // Management:
+   void reset();
+   bool addOccluder(const Eng::TriangleBvh &geometry, const glm::mat4 &matrix);
+   bool addOccluder(const Eng::Bvh::Aabb &box, const glm::mat4 &matrix);
+   bool rasterize(const glm::mat4 &viewProjMatrix);
+   bool wait();
+
+   // Queries:
+   bool isVisible(const Eng::Bvh::Aabb &box) const;
+   float getDepth(uint32_t x, uint32_t y, uint32_t level = 0) const;
+
+
+///////////
+private: //
+///////////
+
+   // Reserved:
+   struct Reserved;
+   std::unique_ptr<Reserved> reserved;
+
+   // Const/dest:
+   Occlusion(const std::string &name);
+
+   // Workaround for disabling the unneeded rendering method:
+   using Object::render;
+};
@@ -13,8 +13,12 @@
 
    // Main include:
    #include "engine.h"
-   #include <functional>
-   #include <map>
+   
+   // C/C++:
+   #include <algorithm>
+   #include <atomic>
+   #include <cstring>
+   #include <thread>
 
    // GLM:
    #include <glm/gtc/packing.hpp>  
@@ -83,28 +87,156 @@ uint32_t ENG_API Eng::Ovo::ignoreChunk(Eng::Serializer &serial)
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
- * Loads an OVO file.
+ * Returns the amount of data decoded by loadChunk() and still waiting to be uploaded by upload(). In its base class,
+ * this function returns 0.
+ * @return size in bytes
+ */
+uint64_t ENG_API Eng::Ovo::getUploadSize() const
+{
+   return 0;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Finalizes the data decoded by loadChunk(), e.g., by creating the related OpenGL objects. Unlike loadChunk(), this
+ * method must be called from the thread owning the OpenGL context. In its base class, this function does nothing.
+ * @return TF
+ */
+bool ENG_API Eng::Ovo::upload()
+{
+   // Done:
+   return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Scans the chunks from the current position of the serializer to its end, without decoding them. Only the chunk 
+ * headers and the number of children of hierarchical chunks are read, which is enough to rebuild the scene graph 
+ * and to later parse the chunks independently.
+ * @param serial serial data (its position is not changed)
+ * @param table chunk table, in file order
+ * @return TF
+ */
+bool ENG_API Eng::Ovo::buildChunkTable(const Eng::Serializer &serial, std::vector<ChunkInfo> &table)
+{
+   table.clear();
+
+   // Safety net:
+   const uint8_t *data = static_cast<const uint8_t *>(serial.getData());
+   const uint8_t *cur = static_cast<const uint8_t *>(serial.getDataAtCurPos());
+   if (cur == nullptr)
+      return true;
+
+   // Stack of open parents (chunk index, children still to be found):
+   std::vector<std::pair<int32_t, uint32_t>> stack;
+
+   // Iterate:
+   const uint64_t length = serial.getNrOfBytes();
+   uint64_t position = static_cast<uint64_t>(cur - data);
+   while (position < length)
+   {
+      if (position + 2 * sizeof(uint32_t) > length)
+      {
+         ENG_LOG_ERROR("Truncated chunk header at offset %llu", static_cast<unsigned long long>(position));
+         return false;
+      }
+
+      uint32_t chunkId, chunkSize;
+      memcpy(&chunkId, data + position, sizeof(uint32_t));
+      memcpy(&chunkSize, data + position + sizeof(uint32_t), sizeof(uint32_t));
+
+      ChunkInfo info;
+      info.id = static_cast<ChunkId>(chunkId);
+      info.position = position;
+      info.size = 2 * sizeof(uint32_t) + chunkSize;
+      info.nrOfChildren = 0;
+      info.parent = -1;
+      if (position + info.size > length)
+      {
+         ENG_LOG_ERROR("Truncated chunk (ID %u) at offset %llu", chunkId, static_cast<unsigned long long>(position));
+         return false;
+      }
+
+      // Hierarchical chunks start with name, matrix and number of children:
+      const bool isHierarchical = (info.id == ChunkId::node || info.id == ChunkId::mesh || info.id == ChunkId::light);
+      if (isHierarchical)
+      {
+         const char *name = reinterpret_cast<const char *>(data + position + 2 * sizeof(uint32_t));
+         const uint64_t offset = 2 * sizeof(uint32_t) + strnlen(name, chunkSize) + 1 + sizeof(glm::mat4);
+         if (offset + sizeof(uint32_t) > info.size)
+         {
+            ENG_LOG_ERROR("Corrupted chunk (ID %u) at offset %llu", chunkId, static_cast<unsigned long long>(position));
+            return false;
+         }
+         memcpy(&info.nrOfChildren, data + position + offset, sizeof(uint32_t));
+
+         if (!stack.empty())
+         {
+            info.parent = stack.back().first;
+            stack.back().second--;
+         }
+      }
+      table.push_back(info);
+
+      // Update hierarchy:
+      if (isHierarchical && info.nrOfChildren)
+         stack.push_back(std::make_pair(static_cast<int32_t>(table.size() - 1), info.nrOfChildren));
+      while (!stack.empty() && stack.back().second == 0)
+         stack.pop_back();
+
+      position += info.size;
+   }
+
+   // Done:
+   return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Creates an empty object of the type matching the given chunk ID. Objects are not registered anywhere, so this 
+ * method can be called from a worker thread.
+ * @param id chunk ID
+ * @return new object, or nullptr if the chunk ID does not map to an object
+ */
+std::unique_ptr<Eng::Object> ENG_API Eng::Ovo::createObject(ChunkId id)
+{
+   switch (id)
+   {
+      case Eng::Ovo::ChunkId::material:   return std::make_unique<Eng::Material>();
+      case Eng::Ovo::ChunkId::node:       return std::make_unique<Eng::Node>();
+      case Eng::Ovo::ChunkId::mesh:       return std::make_unique<Eng::Mesh>();
+      case Eng::Ovo::ChunkId::light:      return std::make_unique<Eng::Light>();
+      default:                            return nullptr;
+   }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Reads an OVO file into memory, checks its version and builds its chunk table. No object is created.
  * @param filename 3D file 
- * @return root node or Node::empty if error
+ * @param serial file content (positioned right after the version chunk)
+ * @param table chunk table, in file order
+ * @return TF
  */
-Eng::Node ENG_API &Eng::Ovo::load(const std::string &filename)
+bool ENG_API Eng::Ovo::open(const std::string &filename, Eng::Serializer &serial, std::vector<ChunkInfo> &table)
 {
    // Safety net:
    if (filename.empty())
    {
       ENG_LOG_ERROR("Invalid params");
-      return Eng::Node::empty;
+      return false;
    }
 
-
-   /////////////////////////////////////////
-   // STEP 1: load file into a memory buffer
-   bool error = false;
+   // Load file into a memory buffer:
    FILE *dat = fopen(filename.c_str(), "rb");
    if (dat == nullptr)
    {
       ENG_LOG_ERROR("Unable to open file '%s'", filename.c_str());
-      return Eng::Node::empty;
+      return false;
    }
 
    // Get file length (max 2 GB):
@@ -114,100 +246,142 @@ Eng::Node ENG_API &Eng::Ovo::load(const std::string &filename)
    fseek(dat, 0L, SEEK_SET);
 
    // Init mem and copy:
-   Eng::Serializer serial(nullptr, length);
+   serial.resize(length);
    if (fread(serial.getData(), sizeof(uint8_t), length, dat) != length)
    {
       ENG_LOG_ERROR("File '%s' is corrupted", filename.c_str());
       fclose(dat);
-      return Eng::Node::empty;
+      return false;
    }
    fclose(dat);  
 
    // First chunk must be the format version:   
-   if (loadChunk(serial) == 0)
+   if (Eng::Ovo::loadChunk(serial) == 0)
    {
       ENG_LOG_ERROR("Invalid format version or wrong file format for file '%s'", filename.c_str());
+      return false;
+   }
+
+   // Prescan the chunk table:
+   if (!buildChunkTable(serial, table))
+   {
+      ENG_LOG_ERROR("File '%s' is corrupted", filename.c_str());
+      return false;
+   }
+
+   // Done:
+   return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Loads an OVO file. The file is first prescanned to build a chunk table, then the chunks are decoded in parallel by
+ * a pool of worker threads. OpenGL uploads, container insertion and hierarchy linking are finally performed by the
+ * calling thread, in file order.
+ * @param filename 3D file 
+ * @param nrOfThreads number of decoding threads (0 to use the number of hardware threads)
+ * @return root node or Node::empty if error
+ */
+Eng::Node ENG_API &Eng::Ovo::load(const std::string &filename, uint32_t nrOfThreads)
+{
+   // Profiling (CPU):
+   Eng::Profiler::Scope profilerScope("Ovo::load", false);
+
+   // Safety net:
+   if (filename.empty())
+   {
+      ENG_LOG_ERROR("Invalid params");
       return Eng::Node::empty;
    }
-   
 
-   ///////////////////////////////
-   // STEP 2: Materials and geoms:  
-   Eng::Container &container = Eng::Container::getInstance();
-   std::function<Eng::Node& (void)> parse;
-   parse = [&serial, &container, this, &parse, &error](void)->Eng::Node&
+
+   //////////////////////////////////////////////////
+   // STEP 1: load file and prescan the chunk table
+   Eng::Serializer serial;
+   std::vector<ChunkInfo> table;
+   if (!open(filename, serial, table))
+      return Eng::Node::empty;
+
+
+   ///////////////////////////////////////////////////////////
+   // STEP 2: create objects (here, to keep IDs deterministic)
+   std::vector<std::unique_ptr<Eng::Object>> object(table.size());
+   std::vector<Eng::Ovo *> ovo(table.size(), nullptr);
+   for (uint32_t c = 0; c < table.size(); c++)
    {
-      switch (*(static_cast<uint8_t *>(serial.getDataAtCurPos())))
+      object[c] = createObject(table[c].id);
+      if (object[c] == nullptr)
       {
-         ///////////////////////////////////////////////////////////
-         case static_cast<uint32_t>(Eng::Ovo::ChunkId::material): //
-         {
-            ENG_LOG_DEBUG("Processing material...");
+         ENG_LOG_WARN("Unknown chunk ID (%u) found: ignored", static_cast<uint32_t>(table[c].id));
+         continue;
+      }
+      ovo[c] = dynamic_cast<Eng::Ovo *>(object[c].get());
+   }
 
-            Eng::Material mat;
-            mat.loadChunk(serial);
-            container.add(mat);
-            return Eng::Node::empty;            
-         }
-         break;
 
-         ///////////////////////////////////////////////////////
-         case static_cast<uint32_t>(Eng::Ovo::ChunkId::node): //
-         {
-            ENG_LOG_DEBUG("Processing node...");
-
-            Eng::Node node;
-            uint32_t nrOfChildren = node.loadChunk(serial);            
-            container.add(node);
-            std::reference_wrapper<Eng::Node> _node = container.getLastNode();
-            while (_node.get().getNrOfChildren() < nrOfChildren)
-               _node.get().addChild(parse());              
-            return _node;
-         }
-         break;
+   ///////////////////////////////////////
+   // STEP 3: decode chunks (worker threads)
+   if (nrOfThreads == 0)
+      nrOfThreads = std::max(1u, std::thread::hardware_concurrency());
+   nrOfThreads = std::min(nrOfThreads, std::max(1u, static_cast<uint32_t>(table.size())));
 
-         ///////////////////////////////////////////////////////
-         case static_cast<uint32_t>(Eng::Ovo::ChunkId::mesh): //
+   const uint8_t *data = static_cast<const uint8_t *>(serial.getData());
+   std::atomic<uint32_t> nextChunk{ 0 };
+   auto decode = [&table, &ovo, &nextChunk, data]()
+   {
+      for (uint32_t c = nextChunk++; c < table.size(); c = nextChunk++)
+         if (ovo[c])
          {
-            ENG_LOG_DEBUG("Processing mesh...");
-
-            Eng::Mesh mesh;
-            uint32_t nrOfChildren = mesh.loadChunk(serial);            
-            container.add(mesh);
-            std::reference_wrapper<Eng::Mesh> _mesh = container.getLastMesh();
-            while (_mesh.get().getNrOfChildren() < nrOfChildren)
-               _mesh.get().addChild(parse());              
-            return _mesh;
+            Eng::Serializer chunk(data + table[c].position, table[c].size);
+            ovo[c]->loadChunk(chunk);
          }
-         break;
+   };
+
+   ENG_LOG_DEBUG("Decoding %u chunks with %u thread(s)...", static_cast<uint32_t>(table.size()), nrOfThreads);
+   std::vector<std::thread> worker;
+   for (uint32_t c = 1; c < nrOfThreads; c++)
+      worker.push_back(std::thread(decode));
+   decode();
+   for (auto &w : worker)
+      w.join();
 
-         ////////////////////////////////////////////////////////
-         case static_cast<uint32_t>(Eng::Ovo::ChunkId::light): //
-         {
-            ENG_LOG_DEBUG("Processing light...");
-
-            Eng::Light light;
-            uint32_t nrOfChildren = light.loadChunk(serial);
-            container.add(light);
-            std::reference_wrapper<Eng::Light> _light = container.getLastLight();
-            while (_light.get().getNrOfChildren() < nrOfChildren)
-               _light.get().addChild(parse());              
-            return _light;
-         }
-         break;
 
-         ///////////
-         default: //
-            ENG_LOG_WARN("Unknown chunk ID (%u) found: ignored", *(static_cast<uint32_t *>(serial.getDataAtCurPos())));
-            ignoreChunk(serial);
-            return Eng::Node::empty;
+   ///////////////////////////////////////////////////////////
+   // STEP 4: upload and store (calling thread, in file order)
+   Eng::Container &container = Eng::Container::getInstance();
+   std::vector<Eng::Node *> node(table.size(), nullptr);
+   for (uint32_t c = 0; c < table.size(); c++)
+   {
+      if (ovo[c] == nullptr)
+         continue;
+
+      ovo[c]->upload();
+      container.add(*object[c]);
+      switch (table[c].id)
+      {
+         case Eng::Ovo::ChunkId::node:    node[c] = &container.getLastNode();  break;
+         case Eng::Ovo::ChunkId::mesh:    node[c] = &container.getLastMesh();  break;
+         case Eng::Ovo::ChunkId::light:   node[c] = &container.getLastLight(); break;
+         default:                                                               break;
       }
-   };
+   }
+   object.clear();
 
-   // Iterate:
+
+   /////////////////////////
+   // STEP 5: link hierarchy
    std::reference_wrapper<Eng::Node> root(Eng::Node::empty);
-   while (serial.getDataAtCurPos() && !error)
-      root = parse();
+   for (uint32_t c = 0; c < table.size(); c++)
+   {
+      if (node[c] == nullptr)
+         continue;
+
+      if (table[c].parent < 0)
+         root = *node[c];
+      else if (node[table[c].parent])
+         node[table[c].parent]->addChild(*node[c]);
+   }
 
    // Done:   
    return root;
@@ -46,9 +46,27 @@ public: //
    };
 
 
+   /**
+    * @brief Chunk table entry, built by a fast prescan of the file before parsing.
+    */
+   struct ChunkInfo
+   {
+      ChunkId id;                            ///< Chunk ID
+      uint64_t position;                     ///< Offset of the chunk header (in bytes, from the file begin)
+      uint32_t size;                         ///< Size of the chunk, header included
+      uint32_t nrOfChildren;                 ///< Number of children (for node, mesh and light chunks only)
+      int32_t parent;                        ///< Index of the parent chunk, -1 when top level
+   };
+
+
    // Loading methods:
-   Eng::Node &load(const std::string &filename);
+   Eng::Node &load(const std::string &filename, uint32_t nrOfThreads = 0);
+   bool open(const std::string &filename, Eng::Serializer &serial, std::vector<ChunkInfo> &table);
    virtual uint32_t loadChunk(Eng::Serializer &serial, void *data = nullptr);
+   virtual uint64_t getUploadSize() const;
+   virtual bool upload();
    uint32_t ignoreChunk(Eng::Serializer &serial);
+   static bool buildChunkTable(const Eng::Serializer &serial, std::vector<ChunkInfo> &table);
+   static std::unique_ptr<Eng::Object> createObject(ChunkId id);
 };
 
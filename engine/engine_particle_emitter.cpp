@@ -36,8 +36,15 @@ struct Eng::ParticleEmitter::Reserved
 {
     std::shared_ptr<std::vector<Particle>> particles;
     Eng::PipelineParticle particlePipe;
-    Eng::Texture texture;
+    Eng::Texture ownTexture;                              ///< Used by setTexture(const Bitmap &)
+    std::reference_wrapper<const Eng::Texture> texture;   ///< Texture in use (owned or shared)
     Eng::PipelineCompute computePipe;
+
+    /**
+     * Constructor.
+     */
+    Reserved() : texture{ ownTexture }
+    {}
 };
 
 ///////////////////////////////////
@@ -93,13 +100,13 @@ bool ENG_API Eng::ParticleEmitter::render(uint32_t value, void* data) const
     reserved->computePipe.render();
 
     //THINGS TO DO WHEN DRAW IN FRAGMENT SHADER
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glDepthMask(GL_FALSE);
+    Eng::State::setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    Eng::State::setDepthMask(false);
     reserved->particlePipe.setModel(renderData.model);
     reserved->particlePipe.setView(renderData.view);
     reserved->particlePipe.render(reserved->texture, reserved->particles->size());
-    glDepthMask(GL_TRUE);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    Eng::State::setDepthMask(true);
+    Eng::State::setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
     // Done:
     return true;
@@ -107,7 +114,18 @@ bool ENG_API Eng::ParticleEmitter::render(uint32_t value, void* data) const
 
 void ENG_API Eng::ParticleEmitter::setTexture(const Eng::Bitmap& sprite)
 {
-    reserved->texture.load(sprite);
+    reserved->ownTexture.load(sprite);
+    reserved->texture = reserved->ownTexture;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Uses an existing texture (e.g., from the container cache) as sprite, so that emitters can share it.
+ * @param sprite texture, must outlive the emitter
+ */
+void ENG_API Eng::ParticleEmitter::setTexture(const Eng::Texture& sprite)
+{
+    reserved->texture = sprite;
 }
 
 void ENG_API Eng::ParticleEmitter::setProjection(glm::mat4 projection)
@@ -123,18 +141,21 @@ void ENG_API Eng::ParticleEmitter::setParticles(std::shared_ptr<std::vector<Part
 
 void ENG_API Eng::ParticleEmitter::setDt(float dT)
 {
-    reserved->computePipe.getProgram().render();
-    reserved->computePipe.getProgram().setFloat("dT", dT);
+    Eng::PipelineCompute::Params params = reserved->computePipe.getParams();
+    params.dT = dT;
+    reserved->computePipe.setParams(params);
 }
 
 void ENG_API Eng::ParticleEmitter::setPlaneMinimum(float planeMinimum)
 {
-    reserved->computePipe.getProgram().render();
-    reserved->computePipe.getProgram().setFloat("planeMinimum", planeMinimum);
+    Eng::PipelineCompute::Params params = reserved->computePipe.getParams();
+    params.planeMinimum = planeMinimum;
+    reserved->computePipe.setParams(params);
 }
 
 void ENG_API Eng::ParticleEmitter::setBounciness(float bounciness)
 {
-    reserved->computePipe.getProgram().render();
-    reserved->computePipe.getProgram().setFloat("bounciness", bounciness);
+    Eng::PipelineCompute::Params params = reserved->computePipe.getParams();
+    params.bounciness = bounciness;
+    reserved->computePipe.setParams(params);
 }
@@ -36,6 +36,7 @@ class ENG_API ParticleEmitter final : public Eng::Node
 	bool render(uint32_t value = 0, void* data = nullptr) const;
 
 	void setTexture(const Eng::Bitmap& sprite);
+	void setTexture(const Eng::Texture& sprite);
 	void setProjection(glm::mat4 projection);
 	void setParticles(std::shared_ptr<std::vector<Particle>> particles);
 	void setDt(float dT);
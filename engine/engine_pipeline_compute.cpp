@@ -29,14 +29,18 @@
 
 static const std::string LOCAL_SIZE = "8";
 
-static const std::string pipeline_cs = R"(
+static const std::string pipeline_cs = "#define EMITTER_BINDING " + std::to_string(Eng::Ubo::emitterBinding) + R"(
 
 // This is the (hard-coded) workgroup size:
 layout (local_size_x = )"+LOCAL_SIZE+R"() in;
 
-uniform float dT;
-uniform float planeMinimum;
-uniform float bounciness;
+// Uniform block (mirrored by PipelineCompute::Params):
+layout(std140, binding = EMITTER_BINDING) uniform EmitterParams
+{
+    float dT;
+    float planeMinimum;
+    float bounciness;
+};
 
    
 struct ParticleCompute 
@@ -141,11 +145,16 @@ struct Eng::PipelineCompute::Reserved
     glm::mat4 model;
     Eng::Ssbo particles;
     Eng::Ssbo particleMatrices;
-    float dT;
+
+    // Simulation parameters (uploaded by render(), only when changed):
+    Eng::PipelineCompute::Params params;
+    Eng::Ubo paramsUbo;
+    bool paramsDirty;
+
     /**
      * Constructor.
      */
-    Reserved()
+    Reserved() : paramsDirty{ true }
     {}
 };
 
@@ -253,6 +262,29 @@ void ENG_API Eng::PipelineCompute::setModel(glm::mat4 model)
     reserved->model = model;
 }
 
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Sets the simulation parameters. Only the CPU-side copy is changed: no OpenGL call is made until the next render().
+ * @param params simulation parameters
+ */
+void ENG_API Eng::PipelineCompute::setParams(const Params &params)
+{
+    reserved->params = params;
+    reserved->paramsDirty = true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the simulation parameters.
+ * @return simulation parameters
+ */
+const Eng::PipelineCompute::Params ENG_API &Eng::PipelineCompute::getParams() const
+{
+    return reserved->params;
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
  * Main rendering method for the pipeline.
@@ -263,6 +295,9 @@ void ENG_API Eng::PipelineCompute::setModel(glm::mat4 model)
 void ENG_API Eng::PipelineCompute::render()
 {
 
+    // Profiling (CPU and GPU):
+    Eng::Profiler::Scope profilerScope("PipelineCompute::render");
+
     // Lazy-loading:
     if (this->isDirty()) {
         if (!this->init())
@@ -278,6 +313,17 @@ void ENG_API Eng::PipelineCompute::render()
         ENG_LOG_ERROR("Invalid program");
     }
     program.render();
+
+    // Upload the parameters (once per change), right before the dispatch:
+    if (reserved->paramsDirty)
+    {
+        if (reserved->paramsUbo.getSize() == 0)
+            reserved->paramsUbo.create(sizeof(Eng::PipelineCompute::Params), &reserved->params);
+        else
+            reserved->paramsUbo.update(&reserved->params, sizeof(Eng::PipelineCompute::Params));
+        reserved->paramsDirty = false;
+    }
+    reserved->paramsUbo.render(Eng::Ubo::emitterBinding);
     reserved->particles.render(0);
     reserved->particleMatrices.render(1);
     program.compute(reserved->particleSize); // 8 is the hard-coded size of the workgroup
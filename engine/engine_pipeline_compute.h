@@ -30,12 +30,31 @@ public: //
 		float scaleStart;
 		float scaleEnd;
 	};
+
+	/**
+	 * @brief Simulation parameters (std140 layout of the EmitterParams uniform block).
+	 */
+	struct Params
+	{
+		float dT;                  ///< Time step
+		float planeMinimum;        ///< Height of the bouncing plane
+		float bounciness;          ///< Velocity kept after a bounce
+		float _pad;                ///< Padding
+
+		/**
+		 * Constructor.
+		 */
+		Params() : dT{ 0.0f }, planeMinimum{ 0.0f }, bounciness{ 0.0f }, _pad{ 0.0f }
+		{}
+	};
 	   // Const/dest:
 	PipelineCompute();
 	PipelineCompute(PipelineCompute&& other);
 	PipelineCompute(PipelineCompute const&) = delete;
 	virtual ~PipelineCompute();
 	void setModel(glm::mat4 model);
+	void setParams(const Params &params);
+	const Params &getParams() const;
 	// Rendering methods:
 	// bool render(uint32_t value = 0, void *data = nullptr) const = delete;
 	bool convert(std::shared_ptr<std::vector<Eng::ParticleEmitter::Particle>> particles);
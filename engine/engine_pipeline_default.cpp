@@ -24,11 +24,38 @@
 // SHADERS //
 /////////////
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Binding points of the uniform blocks, and blocks shared by both stages (std140, mirrored by FrameBlock and 
+ * Mesh::ObjectBlock).
+ */
+static const std::string pipeline_blocks = "#define FRAME_BINDING " + std::to_string(Eng::Ubo::frameBinding) + 
+                                           "\n#define LIGHT_BINDING " + std::to_string(Eng::Ubo::lightBinding) + 
+                                           "\n#define MATERIAL_BINDING " + std::to_string(Eng::Ubo::materialBinding) + 
+                                           "\n#define OBJECT_BINDING " + std::to_string(Eng::Ubo::objectBinding) + 
+                                           "\n#define MAX_NR_OF_CASCADES " + std::to_string(Eng::PipelineShadowMapping::maxNrOfCascades) + R"(
+
+// Uniform block (per frame):
+layout(std140, binding = FRAME_BINDING) uniform Frame
+{
+   mat4 projectionMat;
+   uint totNrOfLights;
+};
+
+// Uniform block (per object):
+layout(std140, binding = OBJECT_BINDING) uniform Object
+{
+   mat4 modelviewMat;
+   mat3 normalMat;
+};
+)";
+
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
  * Default pipeline vertex shader.
  */
-static const std::string pipeline_vs = R"(
+static const std::string pipeline_vs = pipeline_blocks + R"(
  
 // Per-vertex data from VBOs:
 layout(location = 0) in vec3 a_vertex;
@@ -36,34 +63,63 @@ layout(location = 1) in vec4 a_normal;
 layout(location = 2) in vec2 a_uv;
 layout(location = 3) in vec4 a_tangent;
 
-// Uniforms:
-uniform mat4 modelviewMat;
-uniform mat4 projectionMat;
-uniform mat3 normalMat;
-uniform mat4 lightMatrix;
-
 // Varying:
 out vec4 fragPosition;
-out vec4 fragPositionLightSpace;
 out vec3 normal;
 out vec2 uv;
 
+// Must match the depth pre-pass exactly:
+invariant gl_Position;
+
 void main()
 {
    normal = normalMat * a_normal.xyz;
    uv = a_uv;
 
    fragPosition = modelviewMat * vec4(a_vertex, 1.0f);
-   fragPositionLightSpace = lightMatrix * fragPosition;
    gl_Position = projectionMat * fragPosition;
 })";
 
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Depth pre-pass vertex shader (same transform as the default one, position-only stream).
+ */
+static const std::string pipeline_depth_vs = R"(
+ 
+// Per-vertex data from VBOs (position-only stream):
+layout(location = 0) in vec3 a_vertex;
+
+// Uniforms:
+uniform mat4 modelviewMat;
+uniform mat4 projectionMat;
+
+// Must match the color pass exactly:
+invariant gl_Position;
+
+void main()
+{
+   vec4 fragPosition = modelviewMat * vec4(a_vertex, 1.0f);
+   gl_Position = projectionMat * fragPosition;
+})";
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Depth pre-pass fragment shader.
+ */
+static const std::string pipeline_depth_fs = R"(
+
+void main()
+{
+})";
+
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
  * Default pipeline fragment shader.
  */
-static const std::string pipeline_fs = R"(
+static const std::string pipeline_fs = pipeline_blocks + R"(
 
 // Uniform:
 #ifdef ENG_BINDLESS_SUPPORTED
@@ -71,31 +127,38 @@ static const std::string pipeline_fs = R"(
    layout (bindless_sampler) uniform sampler2D texture1; // Normal
    layout (bindless_sampler) uniform sampler2D texture2; // Roughness
    layout (bindless_sampler) uniform sampler2D texture3; // Metalness
-   layout (bindless_sampler) uniform sampler2D texture4; // Shadow map
+   layout (bindless_sampler) uniform sampler2DArray texture4; // Shadow map (one layer per cascade)
 #else
    layout (binding = 0) uniform sampler2D texture0; // Albedo
    layout (binding = 1) uniform sampler2D texture1; // Normal
    layout (binding = 2) uniform sampler2D texture2; // Roughness
    layout (binding = 3) uniform sampler2D texture3; // Metalness
-   layout (binding = 4) uniform sampler2D texture4; // Shadow map
+   layout (binding = 4) uniform sampler2DArray texture4; // Shadow map (one layer per cascade)
 #endif
 
-// Uniform (material):
-uniform vec3 mtlEmission;
-uniform vec3 mtlAlbedo;
-uniform float mtlOpacity;
-uniform float mtlRoughness;
-uniform float mtlMetalness;
+// Uniform block (material, mirrored by Material):
+layout(std140, binding = MATERIAL_BINDING) uniform Material
+{
+   vec3 mtlEmission;
+   float mtlOpacity;
+   vec3 mtlAlbedo;
+   float mtlRoughness;
+   float mtlMetalness;
+};
 
-// Uniform (light):
-uniform uint totNrOfLights;
-uniform vec3 lightColor;
-uniform vec3 lightAmbient;
-uniform vec3 lightPosition;
+// Uniform block (light and its shadow cascades, mirrored by LightBlock):
+layout(std140, binding = LIGHT_BINDING) uniform Light
+{
+   vec3 lightColor;
+   uint nrOfCascades;
+   vec3 lightAmbient;
+   vec3 lightPosition;
+   mat4 cascadeMatrix[MAX_NR_OF_CASCADES];    // Eye to light clip coordinates
+   float cascadeSplit[MAX_NR_OF_CASCADES];    // Far end of each cascade (eye distance)
+};
 
 // Varying:
 in vec4 fragPosition;
-in vec4 fragPositionLightSpace;
 in vec3 normal;
 in vec2 uv;
  
@@ -105,11 +168,19 @@ out vec4 outFragment;
 
 /**
  * Computes the amount of shadow for a given fragment.
- * @param fragPosLightSpace frament coords in light space
  * @return shadow intensity
  */
-float shadowAmount(vec4 fragPosLightSpace)
+float shadowAmount()
 {
+   // Select the cascade:
+   float dist = -fragPosition.z;
+   if (nrOfCascades == 0 || dist > cascadeSplit[nrOfCascades - 1])
+      return 0.0;
+   uint cascade = 0;
+   while (cascade + 1 < nrOfCascades && dist > cascadeSplit[cascade])
+      cascade++;
+   vec4 fragPosLightSpace = cascadeMatrix[cascade] * fragPosition;
+
    // From "clip" to "ndc" coords:
    vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
     
@@ -117,7 +188,7 @@ float shadowAmount(vec4 fragPosLightSpace)
    projCoords = projCoords * 0.5f + 0.5f;
    
    // Get closest depth in the shadow map:
-   float closestDepth = texture(texture4, projCoords.xy).r;    
+   float closestDepth = texture(texture4, vec3(projCoords.xy, cascade)).r;    
        float currentDepth = projCoords.z;
     // calculate bias (based on depth map resolution and slope)
     vec3 new_normal = normalize(normal);
@@ -127,12 +198,12 @@ float shadowAmount(vec4 fragPosLightSpace)
     // float shadow = currentDepth - bias > closestDepth  ? 1.0 : 0.0;
     // PCF
     float shadow = 0.0;
-    vec2 texelSize = 1.0 / textureSize(texture4, 0);
+    vec2 texelSize = 1.0 / vec2(textureSize(texture4, 0).xy);
     for(int x = -1; x <= 1; ++x)
     {
         for(int y = -1; y <= 1; ++y)
         {
-            float pcfDepth = texture(texture4, projCoords.xy + vec2(x, y) * texelSize).r; 
+            float pcfDepth = texture(texture4, vec3(projCoords.xy + vec2(x, y) * texelSize, cascade)).r; 
             shadow += currentDepth - bias > pcfDepth  ? 1.0 : 0.0;        
         }    
     }
@@ -157,7 +228,7 @@ void main()
    vec4 normal_texel = texture(texture1, uv);
    vec4 roughness_texel = mtlRoughness * texture(texture2, uv);
    vec4 metalness_texel = mtlMetalness * texture(texture3, uv);
-   float shadow_texel = texture(texture4, uv).r;
+   float shadow_texel = texture(texture4, vec3(uv, 0.0f)).r;
    float justUseIt = albedo_texel.r + normal_texel.r + roughness_texel.r + metalness_texel.r + shadow_texel;
 
    // Material props:
@@ -172,15 +243,16 @@ void main()
    // Light only front faces:
    if (dot(N, V) > 0.0f)
    {
+      float lit = 1.0f - shadowAmount();
       
       // Diffuse term:   
       float nDotL = max(0.0f, dot(N, L));      
-      fragColor += roughness_texel.r * nDotL * lightColor;
+      fragColor += lit * roughness_texel.r * nDotL * lightColor;
       
       // Specular term:     
       vec3 H = normalize(L + V);                     
       float nDotH = max(0.0f, dot(N, H));         
-      fragColor += (1.0f - roughness_texel.r) * pow(nDotH, 70.0f) * lightColor;         
+      fragColor += lit * (1.0f - roughness_texel.r) * pow(nDotH, 70.0f) * lightColor;         
    }
    
    outFragment = vec4((mtlEmission / float(totNrOfLights)) + fragColor * albedo_texel.xyz, mtlOpacity);      
@@ -197,9 +269,47 @@ void main()
  */
 struct Eng::PipelineDefault::Reserved
 {  
+   /**
+    * @brief Per-frame data (std140 layout of the Frame uniform block).
+    */
+   struct FrameBlock
+   {
+      glm::mat4 projectionMat;                                             ///< Camera projection
+      uint32_t totNrOfLights;                                              ///< Number of light passes
+      uint32_t _pad[3];                                                    ///< Padding
+   };
+
+
+   /**
+    * @brief Per-light data (std140 layout of the Light uniform block).
+    */
+   struct LightBlock
+   {
+      glm::vec3 color;                                                     ///< Light color
+      uint32_t nrOfCascades;                                               ///< Number of shadow cascades in use
+      glm::vec3 ambient;                                                   ///< Ambient term
+      float _pad0;                                                         ///< Padding
+      glm::vec3 position;                                                  ///< Position in eye coordinates
+      float _pad1;                                                         ///< Padding
+      glm::mat4 cascadeMatrix[Eng::PipelineShadowMapping::maxNrOfCascades]; ///< Eye to light clip coordinates
+      glm::vec4 cascadeSplit[Eng::PipelineShadowMapping::maxNrOfCascades];  ///< Far end of each cascade (x only, std140 array stride)
+   };
+
+
    Eng::Shader vs;
    Eng::Shader fs;
    Eng::Program program;
+
+   // Depth pre-pass:
+   Eng::Shader depthVs;
+   Eng::Shader depthFs;
+   Eng::Program depthProgram;
+   Eng::Program::Uniform<glm::mat4> depthProjectionMat;
+   bool depthPrepass;
+
+   // Uniform buffers:
+   Eng::Ubo frameUbo;                  ///< One FrameBlock
+   Eng::Ubo lightUbo;                  ///< One LightBlock per light, aligned for binding
    
    bool wireframe;
 
@@ -209,7 +319,7 @@ struct Eng::PipelineDefault::Reserved
    /**
     * Constructor. 
     */
-   Reserved() : wireframe{ false }
+   Reserved() : depthPrepass{ false }, wireframe{ false }
    {}
 };
 
@@ -287,6 +397,15 @@ bool ENG_API Eng::PipelineDefault::init()
    }
    this->setProgram(reserved->program);
 
+   reserved->depthVs.load(Eng::Shader::Type::vertex, pipeline_depth_vs);
+   reserved->depthFs.load(Eng::Shader::Type::fragment, pipeline_depth_fs);
+   if (reserved->depthProgram.build({ reserved->depthVs, reserved->depthFs }) == false)
+   {
+      ENG_LOG_ERROR("Unable to build depth pre-pass program");
+      return false;
+   }
+   reserved->depthProjectionMat = reserved->depthProgram.getUniform<glm::mat4>("projectionMat");
+
    // Done: 
    this->setDirty(false);
    return true;
@@ -341,6 +460,30 @@ void ENG_API Eng::PipelineDefault::setWireframe(bool flag)
 }
 
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the status of the depth pre-pass.
+ * @return depth pre-pass status
+ */
+bool ENG_API Eng::PipelineDefault::isDepthPrepass() const
+{
+   return reserved->depthPrepass;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Enables/disables the depth pre-pass. When on, the opaque meshes are first rendered depth-only, then shaded with 
+ * GL_EQUAL depth test and depth writes off, so that each visible pixel is shaded once per light. Worth it when shading
+ * dominates (overdraw, several lights); otherwise it only adds a geometry pass. Ignored in wireframe mode.
+ * @param flag depth pre-pass flag
+ */
+void ENG_API Eng::PipelineDefault::setDepthPrepass(bool flag)
+{
+   reserved->depthPrepass = flag;
+}
+
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
  * Main rendering method for the pipeline.  
@@ -357,6 +500,9 @@ bool ENG_API Eng::PipelineDefault::render(const Eng::Camera &camera, const Eng::
       return false;
    }
 
+   // Profiling (CPU and GPU):
+   Eng::Profiler::Scope profilerScope("PipelineDefault::render");
+
    // Just to update the cache:
    this->Eng::Pipeline::render(list); 
 
@@ -380,52 +526,101 @@ bool ENG_API Eng::PipelineDefault::render(const Eng::Camera &camera, const Eng::
    // Apply camera:   
    camera.render();
    glm::mat4 viewMatrix = glm::inverse(camera.getWorldMatrix());
+
+   // Per-frame data (one upload per frame):
+   Reserved::FrameBlock frameBlock = {};
+   frameBlock.projectionMat = camera.getProjMatrix();
+   frameBlock.totNrOfLights = list.getNrOfLights();
+   if (reserved->frameUbo.getSize() == 0)
+      reserved->frameUbo.create(sizeof(Reserved::FrameBlock), &frameBlock);
+   else
+      reserved->frameUbo.update(&frameBlock, sizeof(Reserved::FrameBlock));
+   reserved->frameUbo.render(Eng::Ubo::frameBinding);
+
+   // Per-light data (one slot per light, so that no range is overwritten while in use):
+   const uint64_t lightStride = Eng::Ubo::getAlignedSize(sizeof(Reserved::LightBlock));
+   if (list.getNrOfLights() && reserved->lightUbo.getSize() < list.getNrOfLights() * lightStride)
+      reserved->lightUbo.create(list.getNrOfLights() * lightStride);
    
    // Wireframe is on?
    if (isWireframe())
-      glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);      
+      Eng::State::setPolygonMode(GL_LINE);      
+
+   // Depth pre-pass (opaque meshes only):
+   const bool depthPrepass = isDepthPrepass() && !isWireframe();
+   if (depthPrepass)
+   {
+      reserved->depthProgram.render();
+      reserved->depthProgram.set(reserved->depthProjectionMat, camera.getProjMatrix());
+      Eng::State::setColorMask(false);
+      list.renderDepth(viewMatrix, camera.getProjMatrix(), Eng::List::Casters::opaque);
+      Eng::State::setColorMask(true);
+      program.render();
+   }
 
    // Multipass rendering:
-   uint32_t totNrOfLights = list.getNrOfLights();
-   program.setUInt("totNrOfLights", totNrOfLights);
    for (uint32_t l = 0; l < list.getNrOfLights(); l++)
    {
       // Enable addictive blending from light 1 on:
       if (l == 1)      
       {
-         glEnable(GL_BLEND);
-         glBlendFunc(GL_ONE, GL_ONE);         
+         Eng::State::setBlending(true);
+         Eng::State::setBlendFunc(GL_ONE, GL_ONE);         
       }
       
       // Render one light at time:
       const Eng::List::RenderableElem &lightRe = list.getRenderableElem(l);     
-      const Eng::Light &light = dynamic_cast<const Eng::Light &>(lightRe.reference.get());
 
-      // Render shadow map:
-      //reserved->shadowMapping.render(lightRe, list);
+      // Render shadow maps (always filled, even in wireframe):
+      if (isWireframe())
+         Eng::State::setPolygonMode(GL_FILL);
+      reserved->shadowMapping.render(camera, lightRe, list);
+      if (isWireframe())
+         Eng::State::setPolygonMode(GL_LINE);
 
       // Re-enable this pipeline's program:
       program.render();   
-      glm::mat4 lightFinalMatrix = viewMatrix * lightRe.matrix; // Light position in eye coords
-      lightRe.reference.get().render(0, &lightFinalMatrix);
 
-      lightFinalMatrix = light.getProjMatrix() * glm::inverse(lightRe.matrix) * glm::inverse(viewMatrix); // To convert from eye coords into light space    
-      program.setMat4("lightMatrix", lightFinalMatrix);
+      // Light and shadow cascades (from eye coords into light space):
+      const Eng::Light &light = dynamic_cast<const Eng::Light &>(lightRe.reference.get());
+      const Eng::PipelineShadowMapping &shadowMapping = reserved->shadowMapping;
+      Reserved::LightBlock lightBlock = {};
+      lightBlock.color = light.getColor();
+      lightBlock.ambient = light.getAmbient();
+      lightBlock.position = glm::vec3((viewMatrix * lightRe.matrix)[3]); // Light position in eye coords
+      lightBlock.nrOfCascades = shadowMapping.getNrOfCascades();
+      for (uint32_t c = 0; c < shadowMapping.getNrOfCascades(); c++)
+      {
+         lightBlock.cascadeMatrix[c] = shadowMapping.getCascadeMatrix(c) * camera.getWorldMatrix();
+         lightBlock.cascadeSplit[c].x = shadowMapping.getCascadeSplit(c);
+      }
+      reserved->lightUbo.update(&lightBlock, sizeof(Reserved::LightBlock), l * lightStride);
+      reserved->lightUbo.renderRange(Eng::Ubo::lightBinding, l * lightStride, sizeof(Reserved::LightBlock));
       reserved->shadowMapping.getShadowMap().render(4);      
       
-      // Render meshes:
-      list.render(viewMatrix, Eng::List::Pass::meshes);     
-      list.render(viewMatrix, Eng::List::Pass::trasparent);
+      // Render meshes (only the pixels that passed the pre-pass, if any):
+      if (depthPrepass)
+      {
+         Eng::State::setDepthFunc(GL_EQUAL);
+         Eng::State::setDepthMask(false);
+      }
+      list.render(viewMatrix, Eng::List::Pass::meshes, &camera.getProjMatrix());     
+      if (depthPrepass)
+      {
+         Eng::State::setDepthFunc(GL_LEQUAL);
+         Eng::State::setDepthMask(true);
+      }
+      list.render(viewMatrix, Eng::List::Pass::trasparent, &camera.getProjMatrix());
       list.render(viewMatrix, Eng::List::Pass::particleemitters);
    }
 
    // Disable blending, in case we used it:
    if (list.getNrOfLights() > 1)         
-      glDisable(GL_BLEND);            
+      Eng::State::setBlending(false);            
 
    // Wireframe is on?
    if (isWireframe())
-      glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+      Eng::State::setPolygonMode(GL_FILL);
 
    // Done:   
    return true;
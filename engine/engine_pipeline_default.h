@@ -27,6 +27,8 @@ public: //
    const Eng::PipelineShadowMapping &getShadowMappingPipeline() const;
    void setWireframe(bool flag);
    bool isWireframe() const;
+   void setDepthPrepass(bool flag);
+   bool isDepthPrepass() const;
 
    // Rendering methods:
    // bool render(uint32_t value = 0, void *data = nullptr) const = delete;
@@ -213,6 +213,9 @@ bool ENG_API Eng::PipelineFullscreen2D::render(const Eng::Texture &texture, cons
       return false;
    }
 
+   // Profiling (CPU and GPU):
+   Eng::Profiler::Scope profilerScope("PipelineFullscreen2D::render");
+
    // Just to update the cache
    this->Eng::Pipeline::render(list); 
 
@@ -129,6 +129,11 @@ struct Eng::PipelineParticle::Reserved
     glm::mat4 view;
     glm::mat4 projection;
 
+    // Uniforms (resolved by init()):
+    Eng::Program::Uniform<glm::mat4> projectionUniform;
+    Eng::Program::Uniform<glm::mat4> modelUniform;
+    Eng::Program::Uniform<glm::mat4> viewUniform;
+
     /**
      * Constructor.
      */
@@ -209,6 +214,9 @@ bool ENG_API Eng::PipelineParticle::init()
         return false;
     }
     this->setProgram(reserved->program);
+    reserved->projectionUniform = reserved->program.getUniform<glm::mat4>("projection");
+    reserved->modelUniform = reserved->program.getUniform<glm::mat4>("model");
+    reserved->viewUniform = reserved->program.getUniform<glm::mat4>("view");
 
     // Init dummy VAO:
     if (reserved->vao.init() == false)
@@ -262,6 +270,9 @@ void ENG_API Eng::PipelineParticle::setProjection(glm::mat4 projection)
  */
 bool ENG_API Eng::PipelineParticle::render(const Eng::Texture& texture, unsigned int particleCount)
 {
+    // Profiling (CPU and GPU):
+    Eng::Profiler::Scope profilerScope("PipelineParticle::render");
+
     // Safety net:
     if (texture == Eng::Texture::empty)
     {
@@ -286,9 +297,9 @@ bool ENG_API Eng::PipelineParticle::render(const Eng::Texture& texture, unsigned
     }
     program.render();
     texture.render(0);
-    program.setMat4("projection", reserved->projection);
-    program.setMat4("model", reserved->model);
-    program.setMat4("view", reserved->view);
+    program.set(reserved->projectionUniform, reserved->projection);
+    program.set(reserved->modelUniform, reserved->model);
+    program.set(reserved->viewUniform, reserved->view);
     reserved->vao.render();
     glDrawArraysInstanced(GL_TRIANGLES, 0, 6, particleCount);
 
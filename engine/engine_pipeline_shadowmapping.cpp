@@ -14,6 +14,9 @@
    // Main include:
    #include "engine.h"
 
+   // C/C++:
+   #include <unordered_map>
+
    // OGL:      
    #include <GL/glew.h>
    #include <GLFW/glfw3.h>
@@ -30,11 +33,8 @@
  */
 static const std::string pipeline_vs_2 = R"(
  
-// Per-vertex data from VBOs:
+// Per-vertex data from VBOs (position-only stream):
 layout(location = 0) in vec3 a_vertex;
-layout(location = 1) in vec4 a_normal;
-layout(location = 2) in vec2 a_uv;
-layout(location = 3) in vec4 a_tangent;
 
 // Uniforms:
 uniform mat4 modelviewMat;
@@ -67,18 +67,147 @@ void main()
  */
 struct Eng::PipelineShadowMapping::Reserved
 {  
+   /**
+    * @brief Cached depth of the static casters, for one light (one layer per cascade).
+    */
+   struct Cache
+   {
+      Eng::Texture depthMap;                                         ///< Static depth
+      Eng::Fbo fbo[Eng::PipelineShadowMapping::maxNrOfCascades];     ///< FBOs writing into each layer of depthMap
+      uint64_t hash[Eng::PipelineShadowMapping::maxNrOfCascades];    ///< List::getStaticHash() at the last refresh
+      glm::mat4 matrix[Eng::PipelineShadowMapping::maxNrOfCascades]; ///< Cascade matrix at the last refresh
+      bool valid[Eng::PipelineShadowMapping::maxNrOfCascades];       ///< False until rendered once
+      uint64_t lastHash[Eng::PipelineShadowMapping::maxNrOfCascades];    ///< List::getStaticHash() at the previous frame
+      glm::mat4 lastMatrix[Eng::PipelineShadowMapping::maxNrOfCascades]; ///< Cascade matrix at the previous frame
+
+
+      /**
+       * Constructor.
+       */
+      Cache()
+      {
+         for (uint32_t c = 0; c < Eng::PipelineShadowMapping::maxNrOfCascades; c++)
+         {
+            hash[c] = 0;
+            matrix[c] = glm::mat4(1.0f);
+            valid[c] = false;
+            lastHash[c] = 0;
+            lastMatrix[c] = glm::mat4(1.0f);
+         }
+      }
+   };
+
+
    Eng::Shader vs;
    Eng::Shader fs;
    Eng::Program program;
-   Eng::Texture depthMap;
-   Eng::Fbo fbo;
+   Eng::Program::Uniform<glm::mat4> projectionMat;                      ///< Resolved by init()
+   Eng::Texture depthMap;                                               ///< Array texture, one layer per cascade
+   Eng::Fbo fbo[Eng::PipelineShadowMapping::maxNrOfCascades];           ///< FBOs writing into each layer
+
+   // Cascades:
+   uint32_t nrOfCascades;                                               ///< Requested number of cascades
+   uint32_t nrOfUsedCascades;                                           ///< Cascades rendered by the last render()
+   float splitLambda;                                                   ///< Blend between uniform (0) and logarithmic (1) splits
+   float maxDistance;                                                   ///< Max shadow distance from the camera
+   glm::mat4 cascadeMatrix[Eng::PipelineShadowMapping::maxNrOfCascades];///< World to light clip coordinates
+   glm::mat4 cascadeProj[Eng::PipelineShadowMapping::maxNrOfCascades];  ///< Light projection matrices
+   float cascadeSplit[Eng::PipelineShadowMapping::maxNrOfCascades];     ///< Far end of each cascade (eye distance)
+
+   // Static caster caching:
+   bool staticCaching;                                                  ///< Enabled by setStaticCaching()
+   std::unordered_map<uint32_t, std::unique_ptr<Cache>> cache;          ///< Caches, by light ID
+   uint32_t lastLight;                                                  ///< Light whose static depth is in depthMap (0 if none)
+   bool isStaticOnly[Eng::PipelineShadowMapping::maxNrOfCascades];      ///< Layer holds nothing but the static depth of lastLight
+   uint64_t nrOfRefreshes;                                              ///< Number of static depth renderings so far
 
 
    /**
     * Constructor. 
     */
-   Reserved()
-   {}
+   Reserved() : nrOfCascades{ Eng::PipelineShadowMapping::dfltNrOfCascades }, nrOfUsedCascades{ 0 }, 
+                splitLambda{ Eng::PipelineShadowMapping::dfltSplitLambda }, maxDistance{ Eng::PipelineShadowMapping::dfltMaxDistance },
+                staticCaching{ true }, lastLight{ 0 }, nrOfRefreshes{ 0 }
+   {
+      for (uint32_t c = 0; c < Eng::PipelineShadowMapping::maxNrOfCascades; c++)
+      {
+         cascadeMatrix[c] = glm::mat4(1.0f);
+         cascadeProj[c] = glm::mat4(1.0f);
+         cascadeSplit[c] = 0.0f;
+         isStaticOnly[c] = false;
+      }
+   }
+
+   /**
+    * Fits the cascades to the camera frustum. Each cascade bounds a slice of the view frustum with a sphere (so that 
+    * its size does not change with the camera orientation) and its origin is snapped to whole shadow map texels, 
+    * which avoids shimmering edges when the camera moves. The depth range of the light projection is kept, so that 
+    * casters between the light and the slice are captured. Perspective light projections use a single cascade.
+    * @param camera view camera
+    * @param lightViewMatrix inverse of the light matrix
+    * @param lightProjMatrix light projection matrix
+    */
+   void fit(const Eng::Camera &camera, const glm::mat4 &lightViewMatrix, const glm::mat4 &lightProjMatrix)
+   {
+      // Camera clipping planes (perspective):
+      const glm::mat4 &camProj = camera.getProjMatrix();
+      const float camNear = camProj[3][2] / (camProj[2][2] - 1.0f);
+      const float camFar = camProj[3][2] / (camProj[2][2] + 1.0f);
+      const float farDist = glm::min(camFar, maxDistance);
+
+      // Perspective lights:
+      if (lightProjMatrix[3][3] != 1.0f || camNear <= 0.0f || farDist <= camNear)
+      {
+         nrOfUsedCascades = 1;
+         cascadeProj[0] = lightProjMatrix;
+         cascadeMatrix[0] = lightProjMatrix * lightViewMatrix;
+         cascadeSplit[0] = farDist;
+         return;
+      }
+
+      // Light depth range (orthographic):
+      const float lightNear = (lightProjMatrix[3][2] + 1.0f) / lightProjMatrix[2][2];
+      const float lightFar = (lightProjMatrix[3][2] - 1.0f) / lightProjMatrix[2][2];
+
+      // Slices:
+      const glm::mat4 camToLight = lightViewMatrix * camera.getWorldMatrix();
+      const glm::vec2 tanHalfFov(1.0f / camProj[0][0], 1.0f / camProj[1][1]);
+      nrOfUsedCascades = nrOfCascades;
+      float sliceNear = camNear;
+      for (uint32_t c = 0; c < nrOfCascades; c++)
+      {
+         // Practical split scheme:
+         const float t = static_cast<float>(c + 1) / static_cast<float>(nrOfCascades);
+         const float logSplit = camNear * glm::pow(farDist / camNear, t);
+         const float uniSplit = camNear + (farDist - camNear) * t;
+         const float sliceFar = splitLambda * logSplit + (1.0f - splitLambda) * uniSplit;
+         
+         // Bounding sphere of the slice, in light coordinates:
+         glm::vec3 corner[8];
+         glm::vec3 center(0.0f);
+         for (uint32_t i = 0; i < 8; i++)
+         {
+            const float d = (i & 4) ? sliceFar : sliceNear;
+            const glm::vec4 p(((i & 1) ? 1.0f : -1.0f) * d * tanHalfFov.x, ((i & 2) ? 1.0f : -1.0f) * d * tanHalfFov.y, -d, 1.0f);
+            corner[i] = glm::vec3(camToLight * p);
+            center += corner[i] / 8.0f;
+         }
+         float radius = 0.0f;
+         for (uint32_t i = 0; i < 8; i++)
+            radius = glm::max(radius, glm::length(corner[i] - center));
+         radius = glm::ceil(radius * 16.0f) / 16.0f;
+
+         // Texel snapping:
+         const float texelSize = 2.0f * radius / static_cast<float>(Eng::PipelineShadowMapping::depthTextureSize);
+         center.x = glm::floor(center.x / texelSize) * texelSize;
+         center.y = glm::floor(center.y / texelSize) * texelSize;
+
+         cascadeProj[c] = glm::ortho(center.x - radius, center.x + radius, center.y - radius, center.y + radius, lightNear, lightFar);
+         cascadeMatrix[c] = cascadeProj[c] * lightViewMatrix;
+         cascadeSplit[c] = sliceFar;
+         sliceNear = sliceFar;
+      }
+   }
 };
 
 
@@ -134,7 +263,7 @@ ENG_API Eng::PipelineShadowMapping::~PipelineShadowMapping()
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
- * Gets shadow map texture reference.
+ * Gets shadow map texture reference (array texture, one layer per cascade).
  * @return shadow map texture reference
  */
 const Eng::Texture ENG_API &Eng::PipelineShadowMapping::getShadowMap() const
@@ -143,6 +272,147 @@ const Eng::Texture ENG_API &Eng::PipelineShadowMapping::getShadowMap() const
 }
 
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Sets the number of cascades used with orthographic (directional) lights.
+ * @param nrOfCascades number of cascades, between 1 and maxNrOfCascades
+ * @return TF
+ */
+bool ENG_API Eng::PipelineShadowMapping::setNrOfCascades(uint32_t nrOfCascades)
+{
+   // Safety net:
+   if (nrOfCascades == 0 || nrOfCascades > maxNrOfCascades)
+   {
+      ENG_LOG_ERROR("Invalid params");
+      return false;
+   }
+
+   reserved->nrOfCascades = nrOfCascades;
+
+   // Done:
+   return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the number of cascades rendered by the last render() call.
+ * @return number of cascades
+ */
+uint32_t ENG_API Eng::PipelineShadowMapping::getNrOfCascades() const
+{
+   return reserved->nrOfUsedCascades;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Sets how the view frustum is split among the cascades.
+ * @param lambda blend between uniform (0) and logarithmic (1) split distances
+ */
+void ENG_API Eng::PipelineShadowMapping::setSplitLambda(float lambda)
+{
+   reserved->splitLambda = glm::clamp(lambda, 0.0f, 1.0f);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the split blending factor.
+ * @return lambda
+ */
+float ENG_API Eng::PipelineShadowMapping::getSplitLambda() const
+{
+   return reserved->splitLambda;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Sets the max distance from the camera covered by shadows (clamped to the camera far plane).
+ * @param distance max shadow distance
+ */
+void ENG_API Eng::PipelineShadowMapping::setMaxDistance(float distance)
+{
+   if (distance > 0.0f)
+      reserved->maxDistance = distance;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the max distance from the camera covered by shadows.
+ * @return max shadow distance
+ */
+float ENG_API Eng::PipelineShadowMapping::getMaxDistance() const
+{
+   return reserved->maxDistance;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the matrix converting world coordinates into the light clip coordinates of a cascade.
+ * @param cascade cascade index
+ * @return cascade matrix
+ */
+const glm::mat4 ENG_API &Eng::PipelineShadowMapping::getCascadeMatrix(uint32_t cascade) const
+{
+   return reserved->cascadeMatrix[glm::min(cascade, maxNrOfCascades - 1)];
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the far end of a cascade, as distance from the camera along its view direction.
+ * @param cascade cascade index
+ * @return split distance
+ */
+float ENG_API Eng::PipelineShadowMapping::getCascadeSplit(uint32_t cascade) const
+{
+   return reserved->cascadeSplit[glm::min(cascade, maxNrOfCascades - 1)];
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Enables or disables the caching of static casters (see Mesh::setStatic()). When enabled, the depth of the static
+ * casters is rendered once per light into a separate texture and refreshed only when the light, a cascade or a static 
+ * caster changes: each frame, it is copied into the shadow map and only the dynamic casters are rendered on top. While
+ * a cascade keeps changing (e.g., refitted to a moving camera), all the casters are rendered directly instead, and the
+ * cache is refreshed once the cascade has been stable for a frame (see getNrOfStaticRefreshes()).
+ * @param enable true to enable
+ */
+void ENG_API Eng::PipelineShadowMapping::setStaticCaching(bool enable)
+{
+   reserved->staticCaching = enable;
+   reserved->cache.clear();
+   reserved->lastLight = 0;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets whether static casters are cached.
+ * @return TF
+ */
+bool ENG_API Eng::PipelineShadowMapping::isStaticCaching() const
+{
+   return reserved->staticCaching;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets how many times the depth of static casters has been (re)rendered, for profiling the cache.
+ * @return number of refreshes
+ */
+uint64_t ENG_API Eng::PipelineShadowMapping::getNrOfStaticRefreshes() const
+{
+   return reserved->nrOfRefreshes;
+}
+
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
  * Initializes this pipeline. 
@@ -165,20 +435,24 @@ bool ENG_API Eng::PipelineShadowMapping::init()
       return false;
    }
    this->setProgram(reserved->program);
+   reserved->projectionMat = reserved->program.getUniform<glm::mat4>("projectionMat");
 
-   // Depth map:
-   if (reserved->depthMap.create(depthTextureSize, depthTextureSize, Eng::Texture::Format::depth) == false)
+   // Depth map (one layer per cascade):
+   if (reserved->depthMap.createArray(depthTextureSize, depthTextureSize, maxNrOfCascades, Eng::Texture::Format::depth) == false)
    {
       ENG_LOG_ERROR("Unable to init depth map");
       return false;
    }
 
-   // Depth FBO:
-   reserved->fbo.attachTexture(reserved->depthMap);
-   if (reserved->fbo.validate() == false)
+   // Depth FBOs:
+   for (uint32_t c = 0; c < maxNrOfCascades; c++)
    {
-      ENG_LOG_ERROR("Unable to init depth FBO");
-      return false;
+      reserved->fbo[c].attachTexture(reserved->depthMap, 0, c);
+      if (reserved->fbo[c].validate() == false)
+      {
+         ENG_LOG_ERROR("Unable to init depth FBO");
+         return false;
+      }
    }
 
    // Done: 
@@ -196,6 +470,8 @@ bool ENG_API Eng::PipelineShadowMapping::free()
 {
    if (this->Eng::Managed::free() == false)
       return false;
+   reserved->cache.clear();
+   reserved->lastLight = 0;
 
    // Done:   
    return true;
@@ -204,19 +480,25 @@ bool ENG_API Eng::PipelineShadowMapping::free()
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
- * Main rendering method for the pipeline.  
+ * Main rendering method for the pipeline. With orthographic light projections, one shadow map is rendered per 
+ * cascade, fitted to the slices of the camera frustum; each cascade only renders the casters within its bounds.  
+ * @param camera view camera
  * @param lightRe light renderable element
  * @param list list of renderables
  * @return TF
  */
-bool ENG_API Eng::PipelineShadowMapping::render(const Eng::List::RenderableElem &lightRe, const Eng::List &list)
+bool ENG_API Eng::PipelineShadowMapping::render(const Eng::Camera &camera, const Eng::List::RenderableElem &lightRe, const Eng::List &list)
 {	
    // Safety net:
-   if (list == Eng::List::empty || !dynamic_cast<const Eng::Light *>(&lightRe.reference.get()))
+   if (camera == Eng::Camera::empty || list == Eng::List::empty || !dynamic_cast<const Eng::Light *>(&lightRe.reference.get()))
    {
       ENG_LOG_ERROR("Invalid params");
       return false;
    }
+
+   // Profiling (CPU and GPU):
+   Eng::Profiler::Scope profilerScope("PipelineShadowMapping::render");
+
    const Eng::Light &light = dynamic_cast<const Eng::Light &>(lightRe.reference.get());
 
    // Just to update the cache
@@ -238,21 +520,104 @@ bool ENG_API Eng::PipelineShadowMapping::render(const Eng::List::RenderableElem
       return false;
    }   
    program.render();    
-   program.setMat4("projectionMat", light.getProjMatrix());
-   
-   // Bind FBO and change OpenGL settings:
-   reserved->fbo.render();
-   glClear(GL_DEPTH_BUFFER_BIT);
-   glColorMask(0, 0, 0, 0);
 
    // Light source is the camera:
-   glm::mat4 viewMatrix = glm::inverse(lightRe.matrix);       
+   const glm::mat4 viewMatrix = glm::inverse(lightRe.matrix);       
+   reserved->fit(camera, viewMatrix, light.getProjMatrix());
+   Eng::State::setColorMask(false);
+
+   // Static depth cache:
+   const bool isCaching = reserved->staticCaching && list.getNrOfStaticMeshes();
+   Reserved::Cache *cache = nullptr;
+   uint64_t hash = 0;
+   if (isCaching)
+   {
+      // Evict the caches of the lights no longer in the list:
+      if (reserved->cache.size() >= list.getNrOfLights())
+         for (auto it = reserved->cache.begin(); it != reserved->cache.end(); )
+         {
+            bool isInList = it->first == light.getId();
+            for (uint32_t l = 0; l < list.getNrOfLights() && !isInList; l++)
+               isInList = list.getRenderableElem(l).reference.get().getId() == it->first;
+            it = isInList ? std::next(it) : reserved->cache.erase(it);
+         }
+
+      std::unique_ptr<Reserved::Cache> &entry = reserved->cache[light.getId()];
+      if (entry == nullptr)
+      {
+         entry = std::make_unique<Reserved::Cache>();
+         bool isValid = entry->depthMap.createArray(depthTextureSize, depthTextureSize, maxNrOfCascades, Eng::Texture::Format::depth);
+         for (uint32_t c = 0; c < maxNrOfCascades && isValid; c++)
+            isValid = entry->fbo[c].attachTexture(entry->depthMap, 0, c) && entry->fbo[c].validate();
+         if (!isValid)
+         {
+            ENG_LOG_ERROR("Unable to init static depth cache");
+            reserved->cache.erase(light.getId());
+            Eng::State::setColorMask(true);
+            return false;
+         }
+      }
+      cache = entry.get();
+      hash = list.getStaticHash();
+   }
+
+   // Cascades:
+   for (uint32_t c = 0; c < reserved->nrOfUsedCascades; c++)
+   {
+      const glm::mat4 &projMatrix = reserved->cascadeProj[c];
+      program.set(reserved->projectionMat, projMatrix);
+
+      // No static casters, render all meshes (depth only, culled against the cascade bounds):
+      if (!isCaching)
+      {
+         reserved->fbo[c].render();
+         glClear(GL_DEPTH_BUFFER_BIT);
+         list.renderDepth(viewMatrix, projMatrix);         
+         continue;
+      }
 
-   // Render meshes:   
-   list.render(viewMatrix, Eng::List::Pass::allmeshes);         
+      // Static depth out of date and still changing (e.g., cascade refitted to a moving camera): render all meshes, the
+      // cache is only refreshed once the cascade has been stable for a frame:
+      const bool isStale = !cache->valid[c] || cache->hash[c] != hash || cache->matrix[c] != reserved->cascadeMatrix[c];
+      const bool isStable = cache->lastHash[c] == hash && cache->lastMatrix[c] == reserved->cascadeMatrix[c];
+      cache->lastHash[c] = hash;
+      cache->lastMatrix[c] = reserved->cascadeMatrix[c];
+      if (isStale && !isStable)
+      {
+         reserved->fbo[c].render();
+         glClear(GL_DEPTH_BUFFER_BIT);
+         list.renderDepth(viewMatrix, projMatrix);
+         reserved->isStaticOnly[c] = false;
+         continue;
+      }
+
+      // Refresh the static depth if needed:
+      bool isRefreshed = false;
+      if (isStale)
+      {
+         cache->fbo[c].render();
+         glClear(GL_DEPTH_BUFFER_BIT);
+         list.renderDepth(viewMatrix, projMatrix, Eng::List::Casters::statics);
+         cache->hash[c] = hash;
+         cache->matrix[c] = reserved->cascadeMatrix[c];
+         cache->valid[c] = true;
+         isRefreshed = true;
+         reserved->nrOfRefreshes++;
+      }
+
+      // Start from the static depth, unless the shadow map already holds it:
+      if (isRefreshed || reserved->lastLight != light.getId() || !reserved->isStaticOnly[c])
+         glCopyImageSubData(cache->depthMap.getOglHandle(), GL_TEXTURE_2D_ARRAY, 0, 0, 0, c,
+                            reserved->depthMap.getOglHandle(), GL_TEXTURE_2D_ARRAY, 0, 0, 0, c, depthTextureSize, depthTextureSize, 1);
+
+      // Dynamic casters on top:
+      reserved->fbo[c].render();
+      reserved->isStaticOnly[c] = list.renderDepth(viewMatrix, projMatrix, Eng::List::Casters::dynamics) == 0;
+   }
+   reserved->lastLight = isCaching ? light.getId() : 0;
 
    // Redo OpenGL settings:
-   glColorMask(1, 1, 1, 1);
+   Eng::State::setColorMask(true);
    
    Eng::Base &eng = Eng::Base::getInstance();
    Eng::Fbo::reset(eng.getWindowSize().x, eng.getWindowSize().y);   
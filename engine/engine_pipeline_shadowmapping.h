@@ -9,7 +9,7 @@
 
 
 /**
- * @brief Planar shadow mapping pipeline.
+ * @brief Shadow mapping pipeline, with cascaded shadow maps (stored in a texture array) for orthographic lights.
  */
 class ENG_API PipelineShadowMapping : public Eng::Pipeline
 {
@@ -18,7 +18,11 @@ public: //
 //////////
 
    // Special values:
-   constexpr static uint32_t depthTextureSize = 1024;     ///< Size of the depth map
+   constexpr static uint32_t depthTextureSize = 512;      ///< Size of the depth map of each cascade
+   constexpr static uint32_t maxNrOfCascades = 4;         ///< Number of layers of the depth map
+   constexpr static uint32_t dfltNrOfCascades = 4;        ///< Default number of cascades
+   constexpr static float dfltSplitLambda = 0.75f;        ///< Default blend between uniform and logarithmic splits
+   constexpr static float dfltMaxDistance = 200.0f;       ///< Default max shadow distance from the camera
 
    
    // Const/dest:
@@ -29,10 +33,21 @@ public: //
 
    // Get/set:
    const Eng::Texture &getShadowMap() const;
+   bool setNrOfCascades(uint32_t nrOfCascades);
+   uint32_t getNrOfCascades() const;
+   void setSplitLambda(float lambda);
+   float getSplitLambda() const;
+   void setMaxDistance(float distance);
+   float getMaxDistance() const;
+   const glm::mat4 &getCascadeMatrix(uint32_t cascade) const;
+   float getCascadeSplit(uint32_t cascade) const;
+   void setStaticCaching(bool enable);
+   bool isStaticCaching() const;
+   uint64_t getNrOfStaticRefreshes() const;
 
    // Rendering methods:
    // bool render(uint32_t value = 0, void *data = nullptr) const = delete;
-   bool render(const Eng::List::RenderableElem &lightRe, const Eng::List &list);
+   bool render(const Eng::Camera &camera, const Eng::List::RenderableElem &lightRe, const Eng::List &list);
    
    // Managed:
    bool init() override;
@@ -0,0 +1,464 @@
+/**
+ * @file		engine_profiler.cpp
+ * @brief	CPU and GPU timing of the rendering phases
+ *
+ * @author	Achille Peternier (achille.peternier@supsi.ch), (C) SUPSI
+ */
+
+
+
+//////////////
+// #INCLUDE //
+//////////////
+
+   // Main include:
+   #include "engine.h"
+
+   // OGL:      
+   #include <GL/glew.h>
+   #include <GLFW/glfw3.h>
+
+   // C/C++:
+   #include <chrono>
+   #include <cstring>
+   #include <deque>
+   #include <fstream>
+   #include <iomanip>
+
+
+
+/////////////////////////
+// RESERVED STRUCTURES //
+/////////////////////////
+
+/**
+ * @brief Timer queries issued during one frame.
+ */
+struct ProfilerQuerySlot
+{
+   std::vector<GLuint> queries;     ///< GL_TIME_ELAPSED queries (grown on demand, reused)
+   std::vector<uint32_t> owners;    ///< Event measured by each query
+   uint32_t used;                   ///< Number of queries issued
+
+
+   /**
+    * Constructor.
+    */
+   ProfilerQuerySlot() : used{ 0 }
+   {}
+};
+
+
+/**
+ * @brief Profiler static reserved structure.
+ */
+struct Eng::Profiler::StaticReserved
+{
+   bool enabled;                                                  ///< Recording events
+   std::chrono::high_resolution_clock::time_point epoch;          ///< Reference for CPU times
+
+   Eng::Profiler::Frame current;                                  ///< Frame being recorded
+   Eng::Profiler::Frame pending;                                  ///< Frame waiting for its GPU results
+   std::deque<Eng::Profiler::Frame> history;                      ///< Completed frames
+   Eng::Profiler::Frame emptyFrame;                               ///< Returned when the history is empty
+
+   ProfilerQuerySlot slot[2];                                     ///< Queries of the current and the pending frame
+   uint32_t currentSlot;                                          ///< Slot of the current frame
+   std::vector<uint32_t> stack;                                   ///< Open events
+   bool queryActive;                                              ///< A query is running
+   uint64_t frameNr;                                              ///< Frame counter
+
+
+   /**
+    * Constructor.
+    */
+   StaticReserved() : enabled{ false }, epoch{ std::chrono::high_resolution_clock::now() }, 
+                      currentSlot{ 0 }, queryActive{ false }, frameNr{ 0 }
+   {}
+};
+
+
+
+////////////
+// STATIC //
+////////////   
+
+   // Reserved data:
+   Eng::Profiler::StaticReserved *Eng::Profiler::staticReserved = nullptr;
+
+
+   /**
+    * Gets the CPU time elapsed since the profiler initialization.
+    * @param epoch profiler initialization time
+    * @return time in microseconds
+    */
+   static double profilerNow(const std::chrono::high_resolution_clock::time_point &epoch)
+   {
+      return std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - epoch).count();
+   }
+
+
+   /**
+    * Starts a GL_TIME_ELAPSED query for the given event.
+    * @param slot queries of the current frame
+    * @param owner event index
+    */
+   static void profilerStartQuery(ProfilerQuerySlot &slot, uint32_t owner)
+   {
+      if (slot.used == slot.queries.size())
+      {
+         GLuint query;
+         glGenQueries(1, &query);
+         slot.queries.push_back(query);
+         slot.owners.push_back(0);
+      }
+      slot.owners[slot.used] = owner;
+      glBeginQuery(GL_TIME_ELAPSED, slot.queries[slot.used]);
+      slot.used++;
+   }
+
+
+   /**
+    * Writes a string as a JSON literal.
+    * @param out output stream
+    * @param text string
+    */
+   static void profilerWriteJsonString(std::ostream &out, const char *text)
+   {
+      out << '"';
+      for (const char *c = text; *c; c++)
+      {
+         if (*c == '"' || *c == '\\')
+            out << '\\';
+         out << *c;
+      }
+      out << '"';
+   }
+
+
+
+////////////////////////////
+// BODY OF CLASS Profiler //
+////////////////////////////
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Initializes the static components.
+ * @return TF
+ */
+bool ENG_API Eng::Profiler::init()
+{
+   // Already done?
+   if (staticReserved != nullptr)
+   {
+      ENG_LOG_ERROR("Static class already initialized");
+      return false;
+   }
+
+   // No OpenGL calls at exit, the context is gone by then:
+   staticReserved = new Eng::Profiler::StaticReserved();
+   atexit([]()
+      {
+         delete Eng::Profiler::staticReserved;
+         Eng::Profiler::staticReserved = nullptr;
+      });
+
+   // Done:
+   return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Enables or disables the recording of events.
+ * @param enabled true to enable
+ */
+void ENG_API Eng::Profiler::setEnabled(bool enabled)
+{
+   if (staticReserved == nullptr)
+      init();
+   staticReserved->enabled = enabled;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Returns true when events are recorded.
+ * @return TF
+ */
+bool ENG_API Eng::Profiler::isEnabled()
+{
+   return staticReserved && staticReserved->enabled;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the last completed frame, i.e., the most recent one whose GPU results have been collected.
+ * @return last completed frame (empty if none)
+ */
+const Eng::Profiler::Frame ENG_API &Eng::Profiler::getLastFrame()
+{
+   if (staticReserved == nullptr)
+      init();
+   if (staticReserved->history.empty())
+      return staticReserved->emptyFrame;
+   return staticReserved->history.back();
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Begins an event. Recursive events with the same name as the innermost open one are merged into it.
+ * @param name event name (must outlive the profiler, e.g., a string literal)
+ * @param gpu true to also measure the GPU time
+ * @return true when the event has been opened and must be closed with end()
+ */
+bool ENG_API Eng::Profiler::begin(const char *name, bool gpu)
+{
+   // Recording?
+   if (staticReserved == nullptr || !staticReserved->enabled)
+      return false;
+   StaticReserved &sr = *staticReserved;
+
+   // Recursion:
+   if (!sr.stack.empty() && strcmp(sr.current.events[sr.stack.back()].name, name) == 0)
+      return false;
+
+   // Suspend the running query (no nesting with GL_TIME_ELAPSED):
+   if (gpu && sr.queryActive)
+      glEndQuery(GL_TIME_ELAPSED);
+
+   Event event;
+   event.name = name;
+   event.depth = static_cast<uint32_t>(sr.stack.size());
+   event.parent = sr.stack.empty() ? none : sr.stack.back();
+   event.cpuStart = profilerNow(sr.epoch);
+   event.cpuTime = 0.0;
+   event.gpuTime = gpu ? 0.0 : noTime;
+   const uint32_t index = static_cast<uint32_t>(sr.current.events.size());
+   sr.current.events.push_back(event);
+   sr.stack.push_back(index);
+
+   if (gpu)
+   {
+      profilerStartQuery(sr.slot[sr.currentSlot], index);
+      sr.queryActive = true;
+   }
+
+   // Done:
+   return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Ends the innermost open event.
+ */
+void ENG_API Eng::Profiler::end()
+{
+   // Safety net:
+   if (staticReserved == nullptr || staticReserved->stack.empty())
+   {
+      ENG_LOG_ERROR("No open event");
+      return;
+   }
+   StaticReserved &sr = *staticReserved;
+
+   Event &event = sr.current.events[sr.stack.back()];
+   event.cpuTime = profilerNow(sr.epoch) - event.cpuStart;
+   sr.stack.pop_back();
+
+   // Resume the query of the closest enclosing GPU event:
+   if (event.gpuTime != noTime)
+   {
+      glEndQuery(GL_TIME_ELAPSED);
+      sr.queryActive = false;
+      for (auto it = sr.stack.rbegin(); it != sr.stack.rend(); it++)
+         if (sr.current.events[*it].gpuTime != noTime)
+         {
+            profilerStartQuery(sr.slot[sr.currentSlot], *it);
+            sr.queryActive = true;
+            break;
+         }
+   }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Closes the current frame and collects the GPU results of the previous one, whose top-level GPU times are summed up 
+ * into the FrameStats GPU channel. Called by Base::swap().
+ */
+void ENG_API Eng::Profiler::nextFrame()
+{
+   if (staticReserved == nullptr)
+      return;
+   StaticReserved &sr = *staticReserved;
+
+   // Safety net:
+   if (!sr.stack.empty())
+   {
+      ENG_LOG_WARN("%u event(s) still open at the end of the frame", static_cast<uint32_t>(sr.stack.size()));
+      while (!sr.stack.empty())
+         end();
+   }
+
+   // Collect the previous frame, if its results are ready:
+   const uint32_t pendingSlot = 1 - sr.currentSlot;
+   ProfilerQuerySlot &slot = sr.slot[pendingSlot];
+   bool available = true;
+   if (slot.used)
+   {
+      GLint ready = 0;
+      glGetQueryObjectiv(slot.queries[slot.used - 1], GL_QUERY_RESULT_AVAILABLE, &ready);
+      available = ready != 0;
+   }
+   std::vector<Event> &events = sr.pending.events;
+   if (available)
+      for (uint32_t c = 0; c < slot.used; c++)
+      {
+         GLuint64 ns = 0;
+         glGetQueryObjectui64v(slot.queries[c], GL_QUERY_RESULT, &ns);
+         events[slot.owners[c]].gpuTime += static_cast<double>(ns) / 1000.0;
+      }
+
+   // Nested events come after their parent: accumulate backwards for inclusive GPU times:
+   for (size_t c = events.size(); c-- > 0; )
+   {
+      Event &event = events[c];
+      if (!available)
+         event.gpuTime = noTime;
+      else if (event.gpuTime != noTime && event.parent != none && events[event.parent].gpuTime != noTime)
+         events[event.parent].gpuTime += event.gpuTime;
+   }
+   slot.used = 0;
+
+   // GPU work of the frame (idle gaps between the scopes excluded):
+   double gpuTime = 0.0;
+   bool hasGpuTime = false;
+   for (auto &event : events)
+      if (event.depth == 0 && event.gpuTime != noTime)
+      {
+         gpuTime += event.gpuTime;
+         hasGpuTime = true;
+      }
+   if (hasGpuTime)
+      Eng::FrameStats::add(Eng::FrameStats::Channel::gpu, gpuTime / 1000.0);
+
+   if (!events.empty())
+   {
+      sr.history.push_back(std::move(sr.pending));
+      if (sr.history.size() > maxNrOfFrames)
+         sr.history.pop_front();
+   }
+
+   // Swap:
+   sr.pending = std::move(sr.current);
+   sr.current = Frame();
+   sr.current.frameNr = ++sr.frameNr;
+   sr.currentSlot = pendingSlot;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Releases the queries and forgets all the recorded frames. Must be called while the context is still alive.
+ */
+void ENG_API Eng::Profiler::reset()
+{
+   if (staticReserved == nullptr)
+      return;
+   StaticReserved &sr = *staticReserved;
+
+   if (sr.queryActive)
+      glEndQuery(GL_TIME_ELAPSED);
+   for (auto &slot : sr.slot)
+   {
+      if (!slot.queries.empty())
+         glDeleteQueries(static_cast<GLsizei>(slot.queries.size()), slot.queries.data());
+      slot = ProfilerQuerySlot();
+   }
+   sr.stack.clear();
+   sr.queryActive = false;
+   sr.current = Frame();
+   sr.current.frameNr = sr.frameNr;
+   sr.pending = Frame();
+   sr.history.clear();
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Saves the history of completed frames as Chrome trace events (JSON). CPU events go to thread 1, GPU ones to thread 
+ * 2. GPU events are placed at the CPU start of their scope, as elapsed-time queries carry no timestamp.
+ * @param filename output filename
+ * @return TF
+ */
+bool ENG_API Eng::Profiler::saveTrace(const std::string &filename)
+{
+   // Safety net:
+   if (filename.empty())
+   {
+      ENG_LOG_ERROR("Invalid params");
+      return false;
+   }
+
+   std::ofstream out(filename);
+   if (!out.is_open())
+   {
+      ENG_LOG_ERROR("Unable to open file '%s'", filename.c_str());
+      return false;
+   }
+
+   out << std::fixed << std::setprecision(3);
+   out << "{\"traceEvents\":[\n";
+   out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+   out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+   if (staticReserved)
+      for (auto &frame : staticReserved->history)
+         for (auto &event : frame.events)
+         {
+            for (uint32_t tid = 1; tid <= 2; tid++)
+            {
+               const double duration = (tid == 1) ? event.cpuTime : event.gpuTime;
+               if (duration == noTime)
+                  continue;
+               out << ",\n{\"name\":";
+               profilerWriteJsonString(out, event.name);
+               out << ",\"cat\":\"" << ((tid == 1) ? "cpu" : "gpu") << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+                   << ",\"ts\":" << event.cpuStart << ",\"dur\":" << duration 
+                   << ",\"args\":{\"frame\":" << frame.frameNr << "}}";
+            }
+         }
+   out << "\n]}\n";
+
+   // Done:
+   return out.good();
+}
+
+
+
+/////////////////////////
+// BODY OF CLASS Scope //
+/////////////////////////
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Constructor.
+ * @param name event name (must outlive the profiler, e.g., a string literal)
+ * @param gpu true to also measure the GPU time
+ */
+ENG_API Eng::Profiler::Scope::Scope(const char *name, bool gpu) : active{ Eng::Profiler::begin(name, gpu) }
+{}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Destructor.
+ */
+ENG_API Eng::Profiler::Scope::~Scope()
+{
+   if (active)
+      Eng::Profiler::end();
+}
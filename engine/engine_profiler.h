@@ -0,0 +1,110 @@
+/**
+ * @file		engine_profiler.h
+ * @brief	CPU and GPU timing of the rendering phases
+ *
+ * @author	Achille Peternier (achille.peternier@supsi.ch), (C) SUPSI
+ */
+#pragma once
+
+
+
+/**
+ * @brief Scoped CPU and GPU timers. Each scope records its CPU time and, optionally, its GPU time through 
+ *        GL_TIME_ELAPSED queries. Since such queries cannot be nested, the query of an enclosing scope is suspended 
+ *        while a nested one is running and its GPU time is rebuilt from the pieces. GPU queries are double-buffered:
+ *        the results of a frame are read at the end of the next one and dropped if still not available, so the CPU
+ *        never waits for the GPU. Completed frames are kept in a history that can be saved as a Chrome trace (to be
+ *        opened with chrome://tracing or Perfetto). Static components are lazy-loaded at first usage and must be used
+ *        from the rendering thread only.
+ */
+class ENG_API Profiler final
+{
+//////////
+public: //
+//////////
+
+   // Consts:
+   static constexpr uint32_t maxNrOfFrames = 600;           ///< Completed frames kept in the history
+   static constexpr uint32_t none = 0xFFFFFFFF;             ///< No parent event
+   static constexpr double noTime = -1.0;                   ///< Time not measured (or not available)
+
+
+   /**
+    * @brief Timed scope. The name must outlive the profiler (e.g., a string literal).
+    */
+   struct Event
+   {
+      const char *name;       ///< Scope name
+      uint32_t depth;         ///< Nesting level
+      uint32_t parent;        ///< Index of the enclosing event or none
+      double cpuStart;        ///< CPU start time, in microseconds since the profiler initialization
+      double cpuTime;         ///< CPU time, in microseconds
+      double gpuTime;         ///< GPU time, in microseconds (or noTime)
+   };
+
+
+   /**
+    * @brief Events of one frame, in order of beginning.
+    */
+   struct Frame
+   {
+      uint64_t frameNr;             ///< Frame number
+      std::vector<Event> events;    ///< Events
+
+
+      /**
+       * Constructor.
+       */
+      Frame() : frameNr{ 0 }
+      {}
+   };
+
+
+   /**
+    * @brief Commodity RAII helper: begins an event at construction and ends it at destruction.
+    */
+   class ENG_API Scope final
+   {
+   public:
+
+      // Const/dest:
+      Scope(const char *name, bool gpu = true);
+      Scope(Scope const &) = delete;
+      ~Scope();
+
+   private:
+
+      bool active;            ///< True when the event has been actually opened
+   };
+
+
+   // Const/dest:
+   Profiler() = delete;
+   ~Profiler() = delete;
+
+   // Get/set:
+   static void setEnabled(bool enabled);
+   static bool isEnabled();
+   static const Frame &getLastFrame();
+
+   // Events:
+   static bool begin(const char *name, bool gpu = true);
+   static void end();
+
+   // Management:
+   static void nextFrame();
+   static void reset();
+   static bool saveTrace(const std::string &filename);
+
+
+///////////
+private: //
+///////////
+
+   // Reserved:
+   struct StaticReserved;
+   static StaticReserved *staticReserved;
+
+   // Init:
+   static bool init();
+};
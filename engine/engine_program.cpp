@@ -48,12 +48,13 @@ struct Eng::Program::Reserved
    std::vector<std::reference_wrapper<Eng::Shader>> shader;    ///< Shaders used by the program
    GLuint oglId;                                               ///< OpenGL program ID   
    std::unordered_map<std::string, GLint> location;            ///< Lookup table for uniform locations
+   uint32_t blockMask;                                         ///< Binding points of the active uniform blocks (one bit each)
 
 
    /**
     * Constructor.
     */
-   Reserved() : type{ Eng::Program::Type::none }, oglId{ 0 }
+   Reserved() : type{ Eng::Program::Type::none }, oglId{ 0 }, blockMask{ 0 }
    {}
 };
 
@@ -119,9 +120,11 @@ bool ENG_API Eng::Program::init()
    // Free program if stored:
    if (reserved->oglId)   
    {  
+      Eng::State::releaseProgram(reserved->oglId);
       glDeleteProgram(reserved->oglId);      
       reserved->oglId = 0;
    }   
+   reserved->location.clear(); // Locations (and Uniform handles) of the previous build are no longer valid
 	
 	// Create program:
 	reserved->oglId = glCreateProgram();
@@ -149,6 +152,7 @@ bool ENG_API Eng::Program::free()
    // Free shader if stored:
    if (reserved->oglId)   
    {
+      Eng::State::releaseProgram(reserved->oglId);
       glDeleteProgram(reserved->oglId);      
       reserved->oglId = 0;
    }   
@@ -287,11 +291,36 @@ bool ENG_API Eng::Program::build(std::initializer_list<std::reference_wrapper<En
       return false;
    }
 
+   // Uniform blocks in use (bindings are given in the shaders):
+   reserved->blockMask = 0;
+   GLint nrOfBlocks = 0;
+   glGetProgramiv(reserved->oglId, GL_ACTIVE_UNIFORM_BLOCKS, &nrOfBlocks);
+   for (GLint c = 0; c < nrOfBlocks; c++)
+   {
+      GLint binding = 0;
+      glGetActiveUniformBlockiv(reserved->oglId, c, GL_UNIFORM_BLOCK_BINDING, &binding);
+      if (binding >= 0 && binding < 32)
+         reserved->blockMask |= 1u << binding;
+   }
+
    // Done:
    return true;
 }
 
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Tells whether the program reads a uniform block from the given binding point (see Ubo). Objects use this to either
+ * rely on the block or fall back to plain uniforms.
+ * @param binding binding point
+ * @return TF
+ */
+bool ENG_API Eng::Program::hasUniformBlock(uint32_t binding) const
+{
+   return binding < 32 && (reserved->blockMask & (1u << binding));
+}
+
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
  * Detach program.
@@ -299,7 +328,7 @@ bool ENG_API Eng::Program::build(std::initializer_list<std::reference_wrapper<En
 void ENG_API Eng::Program::reset()
 {
    Eng::Program::cache = Eng::Program::empty;
-   glUseProgram(0);
+   Eng::State::useProgram(0);
 }
 
 
@@ -348,12 +377,7 @@ int32_t ENG_API Eng::Program::getParamLocation(const std::string &name)
  */
 bool ENG_API Eng::Program::setFloat(const std::string &name, float value)
 {
-   GLint location = getParamLocation(name);
-   if (location == -1)
-      return false;
-
-   glUniform1f(location, value);
-   return true;
+   return set(getUniform<float>(name), value);
 }
 
 
@@ -366,126 +390,228 @@ bool ENG_API Eng::Program::setFloat(const std::string &name, float value)
  */
 bool ENG_API Eng::Program::setInt(const std::string &name, int32_t value)
 {
-   GLint location = getParamLocation(name);
-   if (location == -1)
+   return set(getUniform<int32_t>(name), value);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Set a uniform value of type unsigned int.
+ * @param name variable name
+ * @param value variable value
+ * @return TF
+ */
+bool ENG_API Eng::Program::setUInt(const std::string &name, uint32_t value)
+{
+   return set(getUniform<uint32_t>(name), value);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Set a uniform value of type unsigned int 64.
+ * @param name variable name
+ * @param value variable value
+ * @return TF
+ */
+bool ENG_API Eng::Program::setUInt64(const std::string &name, uint64_t value)
+{
+   return set(getUniform<uint64_t>(name), value);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Set a uniform value of type vec3.
+ * @param name variable name
+ * @param value variable value
+ * @return TF
+ */
+bool ENG_API Eng::Program::setVec3(const std::string &name, const glm::vec3 &value)
+{
+   return set(getUniform<glm::vec3>(name), value);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Set a uniform value of type vec4.
+ * @param name variable name
+ * @param value variable value
+ * @return TF
+ */
+bool ENG_API Eng::Program::setVec4(const std::string &name, const glm::vec4 &value)
+{
+   return set(getUniform<glm::vec4>(name), value);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Set a uniform value of type mat3.
+ * @param name variable name
+ * @param value variable value
+ * @return TF
+ */
+bool ENG_API Eng::Program::setMat3(const std::string &name, const glm::mat3 &value)
+{
+   return set(getUniform<glm::mat3>(name), value);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Set a uniform value of type mat4.
+ * @param name variable name
+ * @param value variable value
+ * @return TF
+ */
+bool ENG_API Eng::Program::setMat4(const std::string &name, const glm::mat4 &value)
+{
+   return set(getUniform<glm::mat4>(name), value);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Set a uniform value of type float through a pre-resolved location.
+ * @param uniform uniform location, as returned by getUniform()
+ * @param value variable value
+ * @return TF
+ */
+bool ENG_API Eng::Program::set(Uniform<float> uniform, float value)
+{
+   if (uniform.location == -1)
       return false;
 
    // Done:
-   glUniform1i(location, value);
+   glProgramUniform1f(reserved->oglId, uniform.location, value);
    return true;
 }
 
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
- * Set a uniform value of type unsigned int.
- * @param name variable name
+ * Set a uniform value of type int through a pre-resolved location.
+ * @param uniform uniform location, as returned by getUniform()
  * @param value variable value
  * @return TF
  */
-bool ENG_API Eng::Program::setUInt(const std::string &name, uint32_t value)
+bool ENG_API Eng::Program::set(Uniform<int32_t> uniform, int32_t value)
 {
-   GLint location = getParamLocation(name);
-   if (location == -1)
+   if (uniform.location == -1)
       return false;
 
    // Done:
-   glUniform1ui(location, value);
+   glProgramUniform1i(reserved->oglId, uniform.location, value);
    return true;
 }
 
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
- * Set a uniform value of type unsigned int 64.
- * @param name variable name
+ * Set a uniform value of type unsigned int through a pre-resolved location.
+ * @param uniform uniform location, as returned by getUniform()
  * @param value variable value
  * @return TF
  */
-bool ENG_API Eng::Program::setUInt64(const std::string &name, uint64_t value)
+bool ENG_API Eng::Program::set(Uniform<uint32_t> uniform, uint32_t value)
 {
-   GLint location = getParamLocation(name);
-   if (location == -1)
+   if (uniform.location == -1)
       return false;
 
    // Done:
-   glUniformHandleui64ARB(location, value);
+   glProgramUniform1ui(reserved->oglId, uniform.location, value);
    return true;
 }
 
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
- * Set a uniform value of type vec3.
- * @param name variable name
+ * Set a uniform value of type unsigned int 64 through a pre-resolved location.
+ * @param uniform uniform location, as returned by getUniform()
  * @param value variable value
  * @return TF
  */
-bool ENG_API Eng::Program::setVec3(const std::string &name, const glm::vec3 &value)
+bool ENG_API Eng::Program::set(Uniform<uint64_t> uniform, uint64_t value)
 {
-   GLint location = getParamLocation(name);
-   if (location == -1)
+   if (uniform.location == -1)
       return false;
 
    // Done:
-   glUniform3fv(location, 1, glm::value_ptr(value));
+   glProgramUniformHandleui64ARB(reserved->oglId, uniform.location, value);
    return true;
 }
 
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
- * Set a uniform value of type vec4.
- * @param name variable name
+ * Set a uniform value of type vec3 through a pre-resolved location.
+ * @param uniform uniform location, as returned by getUniform()
  * @param value variable value
  * @return TF
  */
-bool ENG_API Eng::Program::setVec4(const std::string &name, const glm::vec4 &value)
+bool ENG_API Eng::Program::set(Uniform<glm::vec3> uniform, const glm::vec3 &value)
 {
-   GLint location = getParamLocation(name);
-   if (location == -1)
+   if (uniform.location == -1)
       return false;
 
    // Done:
-   glUniform4fv(location, 1, glm::value_ptr(value));
+   glProgramUniform3fv(reserved->oglId, uniform.location, 1, glm::value_ptr(value));
    return true;
 }
 
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
- * Set a uniform value of type mat3.
- * @param name variable name
+ * Set a uniform value of type vec4 through a pre-resolved location.
+ * @param uniform uniform location, as returned by getUniform()
  * @param value variable value
  * @return TF
  */
-bool ENG_API Eng::Program::setMat3(const std::string &name, const glm::mat3 &value)
+bool ENG_API Eng::Program::set(Uniform<glm::vec4> uniform, const glm::vec4 &value)
 {
-   GLint location = getParamLocation(name);
-   if (location == -1)
+   if (uniform.location == -1)
       return false;
 
    // Done:
-   glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(value));
+   glProgramUniform4fv(reserved->oglId, uniform.location, 1, glm::value_ptr(value));
    return true;
 }
 
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
- * Set a uniform value of type mat4.
- * @param name variable name
+ * Set a uniform value of type mat3 through a pre-resolved location.
+ * @param uniform uniform location, as returned by getUniform()
  * @param value variable value
  * @return TF
  */
-bool ENG_API Eng::Program::setMat4(const std::string &name, const glm::mat4 &value)
+bool ENG_API Eng::Program::set(Uniform<glm::mat3> uniform, const glm::mat3 &value)
+{
+   if (uniform.location == -1)
+      return false;
+
+   // Done:
+   glProgramUniformMatrix3fv(reserved->oglId, uniform.location, 1, GL_FALSE, glm::value_ptr(value));
+   return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Set a uniform value of type mat4 through a pre-resolved location.
+ * @param uniform uniform location, as returned by getUniform()
+ * @param value variable value
+ * @return TF
+ */
+bool ENG_API Eng::Program::set(Uniform<glm::mat4> uniform, const glm::mat4 &value)
 {
-   GLint location = getParamLocation(name);
-   if (location == -1)
+   if (uniform.location == -1)
       return false;
 
    // Done:
-   glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+   glProgramUniformMatrix4fv(reserved->oglId, uniform.location, 1, GL_FALSE, glm::value_ptr(value));
    return true;
 }
 
@@ -499,12 +625,10 @@ bool ENG_API Eng::Program::setMat4(const std::string &name, const glm::mat4 &val
  */
 bool ENG_API Eng::Program::render(uint32_t value, void *data) const
 {
-   // Render only if necessary:   
+   // Redundant changes are filtered by the state cache (which also knows about programs used behind our back):
+   Eng::State::useProgram(reserved->oglId);
    if (Eng::Program::cache.get() != *this)
-   {
-      glUseProgram(reserved->oglId);
       Eng::Program::cache = const_cast<Eng::Program &>(*this);
-   }   
 
    // Done:
    return true;
@@ -36,6 +36,35 @@ public: //
    };
 
 
+   /**
+    * @brief Pre-resolved location of a uniform, typed after the GLSL variable. Get it once through getUniform() (e.g.,
+    *        right after build()) and keep it: set() then needs no string hashing nor allocation. Valid until the 
+    *        program is built again.
+    */
+   template <typename T>
+   struct Uniform
+   {
+      int32_t location;       ///< Uniform location, or -1 if not found
+
+
+      /**
+       * Constructor.
+       */
+      Uniform() : location{ -1 }
+      {}
+
+
+      /**
+       * Tells whether the uniform was found in the program.
+       * @return TF
+       */
+      bool isValid() const
+      {
+         return location != -1;
+      }
+   };
+
+
    // Const/dest:
    Program();
    Program(Program &&other);
@@ -54,6 +83,24 @@ public: //
    bool setVec4(const std::string &name, const glm::vec4 &value);
    bool setMat3(const std::string &name, const glm::mat3 &value);
    bool setMat4(const std::string &name, const glm::mat4 &value);
+   bool hasUniformBlock(uint32_t binding) const;
+
+   // Pre-resolved uniforms:
+   template <typename T>
+   Uniform<T> getUniform(const std::string &name)
+   {
+      Uniform<T> uniform;
+      uniform.location = getParamLocation(name);
+      return uniform;
+   }
+   bool set(Uniform<float> uniform, float value);
+   bool set(Uniform<int32_t> uniform, int32_t value);
+   bool set(Uniform<uint32_t> uniform, uint32_t value);
+   bool set(Uniform<uint64_t> uniform, uint64_t value);
+   bool set(Uniform<glm::vec3> uniform, const glm::vec3 &value);
+   bool set(Uniform<glm::vec4> uniform, const glm::vec4 &value);
+   bool set(Uniform<glm::mat3> uniform, const glm::mat3 &value);
+   bool set(Uniform<glm::mat4> uniform, const glm::mat4 &value);
 
    // Building:
    bool build(std::initializer_list<std::reference_wrapper<Eng::Shader>> args);
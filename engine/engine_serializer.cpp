@@ -176,6 +176,19 @@ void ENG_API Eng::Serializer::clear()
 }
 
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Resizes the internal data (existing content is kept up to the new size) and resets the position.
+ * @param nrOfBytes new size in bytes
+ */
+void ENG_API Eng::Serializer::resize(uint64_t nrOfBytes)
+{
+   reserved->data.resize(nrOfBytes);
+   reserved->position = 0;
+   reserved->nrOfBytes = nrOfBytes;
+}
+
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
  * Deserializes a string.
@@ -37,6 +37,7 @@ public: //
    // Serialization:
    void clear();
    void reset();  
+   void resize(uint64_t nrOfBytes);
    bool deserialize(std::string &text);
    bool deserialize(uint8_t &byte);
    bool deserialize(bool &_bool);
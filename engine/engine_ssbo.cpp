@@ -133,6 +133,7 @@ bool ENG_API Eng::Ssbo::init()
     // Free buffer if already stored:
     if (reserved->oglId)
     {
+        Eng::State::releaseBuffer(reserved->oglId);
         glDeleteBuffers(1, &reserved->oglId);
         reserved->oglId = 0;
         reserved->size = 0;
@@ -159,6 +160,7 @@ bool ENG_API Eng::Ssbo::free()
     // Free SSBO if stored:
     if (reserved->oglId)
     {
+        Eng::State::releaseBuffer(reserved->oglId);
         glDeleteBuffers(1, &reserved->oglId);
         reserved->oglId = 0;
         reserved->size = 0;
@@ -188,7 +190,7 @@ bool ENG_API Eng::Ssbo::create(uint64_t size, const void* data)
 
     // Fill it:		              
     const GLuint oglId = this->getOglHandle();
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, oglId);
+    Eng::State::bindBuffer(GL_SHADER_STORAGE_BUFFER, oglId);
     glBufferStorage(GL_SHADER_STORAGE_BUFFER, size, data,  GL_MAP_WRITE_BIT);
 
     GLenum err;
@@ -213,7 +215,7 @@ void ENG_API* Eng::Ssbo::map(Eng::Ssbo::Mapping mapping)
     GLint bufMask = 0;
 
     // Bind buffer and map:   
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, reserved->oglId); // <-- rendering to base 0 by default!
+    Eng::State::bindBuffer(GL_SHADER_STORAGE_BUFFER, reserved->oglId); // <-- rendering to base 0 by default!
     switch (mapping)
     {
     case Mapping::read: bufMask = GL_MAP_READ_BIT; break;
@@ -253,7 +255,7 @@ bool ENG_API Eng::Ssbo::unmap()
  */
 bool ENG_API Eng::Ssbo::render(uint32_t value, void* data) const
 {
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, value, reserved->oglId);
+    Eng::State::bindBufferBase(GL_SHADER_STORAGE_BUFFER, value, reserved->oglId);
 
     // Done:
     return true;
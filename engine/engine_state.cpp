@@ -0,0 +1,483 @@
+/**
+ * @file		engine_state.cpp
+ * @brief	Cache of the OpenGL state
+ *
+ * @author	Achille Peternier (achille.peternier@supsi.ch), (C) SUPSI
+ */
+
+
+
+//////////////
+// #INCLUDE //
+//////////////
+
+   // Main include:
+   #include "engine.h"
+
+   // OGL:      
+   #include <GL/glew.h>
+   #include <GLFW/glfw3.h>
+
+
+
+/////////////////////////
+// RESERVED STRUCTURES //
+/////////////////////////
+
+   // Value of a state not known yet (forces the next call through):
+   static constexpr uint32_t stateUnknown = 0xFFFFFFFF;
+
+   // Tracked buffer targets:
+   static constexpr uint32_t stateNrOfTargets = 4;
+   static constexpr uint32_t stateNrOfIndexedTargets = 2;
+
+
+/**
+ * @brief Shadow copy of the OpenGL state (one per thread).
+ */
+struct StateShadow
+{
+   /**
+    * @brief Indexed buffer binding.
+    */
+   struct Range
+   {
+      uint32_t oglId;                                                   ///< Buffer
+      uint64_t offset;                                                  ///< Offset in bytes (0 for whole buffer)
+      uint64_t size;                                                    ///< Size in bytes (0 for whole buffer)
+   };
+
+   uint32_t program;                                                    ///< Program in use
+   uint32_t vertexArray;                                                ///< Bound VAO
+   uint32_t buffer[stateNrOfTargets];                                   ///< Bound buffer, per target
+   Range range[stateNrOfIndexedTargets][Eng::State::maxNrOfBindings];   ///< Bound buffer, per indexed binding point
+   uint32_t texture[Eng::State::maxNrOfTextureUnits];                   ///< Bound texture, per unit
+   uint32_t blending;                                                   ///< GL_BLEND enabled (0/1)
+   uint32_t blendSrc;                                                   ///< Source blend factor
+   uint32_t blendDst;                                                   ///< Destination blend factor
+   uint32_t depthTest;                                                  ///< GL_DEPTH_TEST enabled (0/1)
+   uint32_t depthFunc;                                                  ///< Depth comparison function
+   uint32_t depthMask;                                                  ///< Depth writes (0/1)
+   uint32_t colorMask;                                                  ///< Color writes (0/1, all channels)
+   uint32_t polygonMode;                                                ///< Polygon rasterization mode (front and back)
+
+   Eng::State::Counters current;                                        ///< Counters of the frame in progress
+   Eng::State::Counters last;                                           ///< Counters of the last completed frame
+
+
+   /**
+    * Constructor.
+    */
+   StateShadow()
+   {
+      reset();
+   }
+
+
+   /**
+    * Forgets everything.
+    */
+   void reset()
+   {
+      program = vertexArray = stateUnknown;
+      for (uint32_t c = 0; c < stateNrOfTargets; c++)
+         buffer[c] = stateUnknown;
+      for (uint32_t t = 0; t < stateNrOfIndexedTargets; t++)
+         for (uint32_t c = 0; c < Eng::State::maxNrOfBindings; c++)
+            range[t][c] = { stateUnknown, 0, 0 };
+      for (uint32_t c = 0; c < Eng::State::maxNrOfTextureUnits; c++)
+         texture[c] = stateUnknown;
+      blending = blendSrc = blendDst = stateUnknown;
+      depthTest = depthFunc = depthMask = stateUnknown;
+      colorMask = polygonMode = stateUnknown;
+   }
+
+
+   /**
+    * Updates a cached value and counts the call.
+    * @param cached cached value
+    * @param value new value
+    * @return true when the call must be issued
+    */
+   bool change(uint32_t &cached, uint32_t value)
+   {
+      if (cached == value)
+      {
+         current.skipped++;
+         return false;
+      }
+      cached = value;
+      current.issued++;
+      return true;
+   }
+};
+
+
+   /**
+    * Gets the shadow copy of the calling thread.
+    * @return shadow copy
+    */
+   static StateShadow &stateGetShadow()
+   {
+      static thread_local StateShadow shadow;
+      return shadow;
+   }
+
+
+   /**
+    * Maps a buffer target to its slot in the shadow copy.
+    * @param target OpenGL buffer target
+    * @return slot or -1 if the target is not tracked
+    */
+   static int32_t stateTargetSlot(uint32_t target)
+   {
+      switch (target)
+      {
+         case GL_ARRAY_BUFFER:            return 0;
+         case GL_ELEMENT_ARRAY_BUFFER:    return 1;
+         case GL_UNIFORM_BUFFER:          return 2;
+         case GL_SHADER_STORAGE_BUFFER:   return 3;
+         default:                         return -1;
+      }
+   }
+
+
+   /**
+    * Maps an indexed buffer target to its slot in the shadow copy.
+    * @param target OpenGL buffer target
+    * @return slot or -1 if the target is not tracked
+    */
+   static int32_t stateIndexedTargetSlot(uint32_t target)
+   {
+      switch (target)
+      {
+         case GL_UNIFORM_BUFFER:          return 0;
+         case GL_SHADER_STORAGE_BUFFER:   return 1;
+         default:                         return -1;
+      }
+   }
+
+
+
+/////////////////////////
+// BODY OF CLASS State //
+/////////////////////////
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Sets the program in use (glUseProgram).
+ * @param oglId program ID
+ */
+void ENG_API Eng::State::useProgram(uint32_t oglId)
+{
+   if (stateGetShadow().change(stateGetShadow().program, oglId))
+      glUseProgram(oglId);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Binds a vertex array object (glBindVertexArray). The element buffer binding is part of the VAO, so it is forgotten 
+ * whenever the VAO changes.
+ * @param oglId VAO ID
+ */
+void ENG_API Eng::State::bindVertexArray(uint32_t oglId)
+{
+   StateShadow &shadow = stateGetShadow();
+   if (shadow.change(shadow.vertexArray, oglId))
+   {
+      glBindVertexArray(oglId);
+      shadow.buffer[stateTargetSlot(GL_ELEMENT_ARRAY_BUFFER)] = stateUnknown;
+   }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Binds a buffer to a target (glBindBuffer). Untracked targets are always forwarded.
+ * @param target OpenGL buffer target
+ * @param oglId buffer ID
+ */
+void ENG_API Eng::State::bindBuffer(uint32_t target, uint32_t oglId)
+{
+   StateShadow &shadow = stateGetShadow();
+   const int32_t slot = stateTargetSlot(target);
+   if (slot == -1)
+   {
+      shadow.current.issued++;
+      glBindBuffer(target, oglId);
+      return;
+   }
+   if (shadow.change(shadow.buffer[slot], oglId))
+      glBindBuffer(target, oglId);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Binds a whole buffer to an indexed binding point (glBindBufferBase). Like OpenGL, this also changes the generic 
+ * binding of the target.
+ * @param target OpenGL buffer target (uniform or shader storage)
+ * @param index binding point
+ * @param oglId buffer ID
+ */
+void ENG_API Eng::State::bindBufferBase(uint32_t target, uint32_t index, uint32_t oglId)
+{
+   bindBufferRange(target, index, oglId, 0, 0);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Binds a range of a buffer to an indexed binding point (glBindBufferRange). Like OpenGL, this also changes the 
+ * generic binding of the target.
+ * @param target OpenGL buffer target (uniform or shader storage)
+ * @param index binding point
+ * @param oglId buffer ID
+ * @param offset offset in bytes
+ * @param size size in bytes (0 for the whole buffer)
+ */
+void ENG_API Eng::State::bindBufferRange(uint32_t target, uint32_t index, uint32_t oglId, uint64_t offset, uint64_t size)
+{
+   StateShadow &shadow = stateGetShadow();
+   const int32_t slot = stateIndexedTargetSlot(target);
+   if (slot != -1 && index < maxNrOfBindings)
+   {
+      StateShadow::Range &range = shadow.range[slot][index];
+      if (range.oglId == oglId && range.offset == offset && range.size == size)
+      {
+         shadow.current.skipped++;
+         return;
+      }
+      range = { oglId, offset, size };
+   }
+   shadow.current.issued++;
+   const int32_t genericSlot = stateTargetSlot(target);
+   if (genericSlot != -1)
+      shadow.buffer[genericSlot] = oglId;
+   if (size)
+      glBindBufferRange(target, index, oglId, offset, size);
+   else
+      glBindBufferBase(target, index, oglId);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Binds a texture to a unit (glBindTextures, which does not need to know the texture target). Units beyond the 
+ * tracked ones are always forwarded.
+ * @param unit texture unit
+ * @param oglId texture ID
+ */
+void ENG_API Eng::State::bindTexture(uint32_t unit, uint32_t oglId)
+{
+   StateShadow &shadow = stateGetShadow();
+   if (unit >= maxNrOfTextureUnits)
+   {
+      shadow.current.issued++;
+      glBindTextures(unit, 1, &oglId);
+      return;
+   }
+   if (shadow.change(shadow.texture[unit], oglId))
+      glBindTextures(unit, 1, &oglId);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Enables or disables blending (GL_BLEND).
+ * @param enable true to enable
+ */
+void ENG_API Eng::State::setBlending(bool enable)
+{
+   if (stateGetShadow().change(stateGetShadow().blending, enable))
+   {
+      if (enable)
+         glEnable(GL_BLEND);
+      else
+         glDisable(GL_BLEND);
+   }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Sets the blending factors (glBlendFunc).
+ * @param src source factor
+ * @param dst destination factor
+ */
+void ENG_API Eng::State::setBlendFunc(uint32_t src, uint32_t dst)
+{
+   StateShadow &shadow = stateGetShadow();
+   if (shadow.blendSrc == src && shadow.blendDst == dst)
+   {
+      shadow.current.skipped++;
+      return;
+   }
+   shadow.blendSrc = src;
+   shadow.blendDst = dst;
+   shadow.current.issued++;
+   glBlendFunc(src, dst);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Enables or disables depth testing (GL_DEPTH_TEST).
+ * @param enable true to enable
+ */
+void ENG_API Eng::State::setDepthTest(bool enable)
+{
+   if (stateGetShadow().change(stateGetShadow().depthTest, enable))
+   {
+      if (enable)
+         glEnable(GL_DEPTH_TEST);
+      else
+         glDisable(GL_DEPTH_TEST);
+   }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Sets the depth comparison function (glDepthFunc).
+ * @param func comparison function
+ */
+void ENG_API Eng::State::setDepthFunc(uint32_t func)
+{
+   if (stateGetShadow().change(stateGetShadow().depthFunc, func))
+      glDepthFunc(func);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Enables or disables depth writes (glDepthMask).
+ * @param flag true to enable
+ */
+void ENG_API Eng::State::setDepthMask(bool flag)
+{
+   if (stateGetShadow().change(stateGetShadow().depthMask, flag))
+      glDepthMask(flag ? GL_TRUE : GL_FALSE);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Enables or disables color writes on all channels (glColorMask).
+ * @param flag true to enable
+ */
+void ENG_API Eng::State::setColorMask(bool flag)
+{
+   if (stateGetShadow().change(stateGetShadow().colorMask, flag))
+   {
+      const GLboolean value = flag ? GL_TRUE : GL_FALSE;
+      glColorMask(value, value, value, value);
+   }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Sets the polygon rasterization mode for both faces (glPolygonMode).
+ * @param mode GL_FILL, GL_LINE or GL_POINT
+ */
+void ENG_API Eng::State::setPolygonMode(uint32_t mode)
+{
+   if (stateGetShadow().change(stateGetShadow().polygonMode, mode))
+      glPolygonMode(GL_FRONT_AND_BACK, mode);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Forgets a program about to be deleted, as its ID can be recycled by OpenGL.
+ * @param oglId program ID
+ */
+void ENG_API Eng::State::releaseProgram(uint32_t oglId)
+{
+   StateShadow &shadow = stateGetShadow();
+   if (shadow.program == oglId)
+      shadow.program = stateUnknown;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Forgets a VAO about to be deleted, as its ID can be recycled by OpenGL.
+ * @param oglId VAO ID
+ */
+void ENG_API Eng::State::releaseVertexArray(uint32_t oglId)
+{
+   StateShadow &shadow = stateGetShadow();
+   if (shadow.vertexArray == oglId)
+   {
+      shadow.vertexArray = stateUnknown;
+      shadow.buffer[stateTargetSlot(GL_ELEMENT_ARRAY_BUFFER)] = stateUnknown;
+   }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Forgets a buffer about to be deleted, as its ID can be recycled by OpenGL.
+ * @param oglId buffer ID
+ */
+void ENG_API Eng::State::releaseBuffer(uint32_t oglId)
+{
+   StateShadow &shadow = stateGetShadow();
+   for (uint32_t c = 0; c < stateNrOfTargets; c++)
+      if (shadow.buffer[c] == oglId)
+         shadow.buffer[c] = stateUnknown;
+   for (uint32_t t = 0; t < stateNrOfIndexedTargets; t++)
+      for (uint32_t c = 0; c < maxNrOfBindings; c++)
+         if (shadow.range[t][c].oglId == oglId)
+            shadow.range[t][c].oglId = stateUnknown;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Forgets a texture about to be deleted, as its ID can be recycled by OpenGL.
+ * @param oglId texture ID
+ */
+void ENG_API Eng::State::releaseTexture(uint32_t oglId)
+{
+   StateShadow &shadow = stateGetShadow();
+   for (uint32_t c = 0; c < maxNrOfTextureUnits; c++)
+      if (shadow.texture[c] == oglId)
+         shadow.texture[c] = stateUnknown;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Forgets the whole shadow copy. To be called after OpenGL has been used without going through this class.
+ */
+void ENG_API Eng::State::invalidate()
+{
+   stateGetShadow().reset();
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Closes the counters of the current frame and starts new ones. Called by Base::swap().
+ */
+void ENG_API Eng::State::nextFrame()
+{
+   StateShadow &shadow = stateGetShadow();
+   shadow.last = shadow.current;
+   shadow.current = Counters();
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the counters of the last completed frame.
+ * @return counters
+ */
+const Eng::State::Counters ENG_API &Eng::State::getCounters()
+{
+   return stateGetShadow().last;
+}
@@ -0,0 +1,77 @@
+/**
+ * @file		engine_state.h
+ * @brief	Cache of the OpenGL state
+ *
+ * @author	Achille Peternier (achille.peternier@supsi.ch), (C) SUPSI
+ */
+#pragma once
+
+
+
+/**
+ * @brief Shadow copy of the OpenGL state changed by the engine (bound program, vertex array, buffers per target and 
+ *        per indexed binding point, textures per unit, blending, depth, color mask and polygon mode). Calls that would
+ *        not change anything are skipped. Both issued and skipped calls are counted per frame. The copy is thread-local,
+ *        as a context is current on one thread only. Code issuing OpenGL calls behind the engine's back (e.g., ImGui)
+ *        must call invalidate() afterwards.
+ */
+class ENG_API State final
+{
+//////////
+public: //
+//////////
+
+   // Consts:
+   static constexpr uint32_t maxNrOfTextureUnits = 32;   ///< Texture units tracked
+   static constexpr uint32_t maxNrOfBindings = 16;       ///< Indexed binding points tracked (uniform and storage buffers)
+
+
+   /**
+    * @brief Number of calls issued to and filtered out from OpenGL.
+    */
+   struct Counters
+   {
+      uint64_t issued;        ///< Calls forwarded to OpenGL
+      uint64_t skipped;       ///< Redundant calls filtered out
+
+
+      /**
+       * Constructor.
+       */
+      Counters() : issued{ 0 }, skipped{ 0 }
+      {}
+   };
+
+
+   // Const/dest:
+   State() = delete;
+   ~State() = delete;
+
+   // Bindings:
+   static void useProgram(uint32_t oglId);
+   static void bindVertexArray(uint32_t oglId);
+   static void bindBuffer(uint32_t target, uint32_t oglId);
+   static void bindBufferBase(uint32_t target, uint32_t index, uint32_t oglId);
+   static void bindBufferRange(uint32_t target, uint32_t index, uint32_t oglId, uint64_t offset, uint64_t size);
+   static void bindTexture(uint32_t unit, uint32_t oglId);
+
+   // Fixed-function state:
+   static void setBlending(bool enable);
+   static void setBlendFunc(uint32_t src, uint32_t dst);
+   static void setDepthTest(bool enable);
+   static void setDepthFunc(uint32_t func);
+   static void setDepthMask(bool flag);
+   static void setColorMask(bool flag);
+   static void setPolygonMode(uint32_t mode);
+
+   // Object deletion:
+   static void releaseProgram(uint32_t oglId);
+   static void releaseVertexArray(uint32_t oglId);
+   static void releaseBuffer(uint32_t oglId);
+   static void releaseTexture(uint32_t oglId);
+
+   // Management:
+   static void invalidate();
+   static void nextFrame();
+   static const Counters &getCounters();
+};
@@ -45,12 +45,13 @@ struct Eng::Texture::Reserved
    GLuint oglId;                    ///< OpenGL texture ID   
    GLuint64 oglBindlessHandle;      ///< GL_ARB_bindless_texture special handle
    bool isTrasparent;
+   bool isArray;                    ///< GL_TEXTURE_2D_ARRAY instead of GL_TEXTURE_2D
 
    /**
     * Constructor. 
     */
    Reserved() : bitmap{ Eng::Bitmap::empty }, format{ Eng::Texture::Format::none }, size{ 0, 0, 1 },
-                oglId{ 0 }, oglBindlessHandle{ 0 },isTrasparent{false}
+                oglId{ 0 }, oglBindlessHandle{ 0 },isTrasparent{false}, isArray{ false }
    {}
 };
 
@@ -252,6 +253,17 @@ bool ENG_API Eng::Texture::getTrasparent() const
 }
 
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Tells whether this texture is an array of 2D layers (see createArray()).
+ * @return TF
+ */
+bool ENG_API Eng::Texture::isArray() const
+{
+   return reserved->isArray;
+}
+
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
  * Create an OpenGL instance of the texture. 
@@ -270,6 +282,7 @@ bool ENG_API Eng::Texture::init()
    }
    if (reserved->oglId)   
    {
+	   Eng::State::releaseTexture(reserved->oglId);
 	   glDeleteTextures(1, &reserved->oglId);
       reserved->oglId = 0;
    }   
@@ -323,6 +336,7 @@ bool ENG_API Eng::Texture::free()
    }
    if (reserved->oglId)   
    {      
+	   Eng::State::releaseTexture(reserved->oglId);
 	   glDeleteTextures(1, &reserved->oglId);
       reserved->oglId = 0;
    }   
@@ -448,6 +462,7 @@ bool ENG_API Eng::Texture::load(const Eng::Bitmap &bitmap)
 	// Create it:		              
    const GLuint oglId = this->getOglHandle();
    glBindTexture(GL_TEXTURE_2D, oglId);   
+   Eng::State::invalidate();
    if (bitmap.getNrOfLevels() > 1)
       glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, bitmap.getNrOfLevels());   
    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
@@ -554,6 +569,7 @@ bool ENG_API Eng::Texture::create(uint32_t sizeX, uint32_t sizeY, Format format)
 	// Create it:		    
    const GLuint oglId = this->getOglHandle();
    glBindTexture(GL_TEXTURE_2D, oglId);   	      	
+   Eng::State::invalidate();
    glTexImage2D(GL_TEXTURE_2D, 0, intFormat, sizeX, sizeY, 0, extFormat, extType, nullptr);         
    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);   
@@ -582,6 +598,87 @@ bool ENG_API Eng::Texture::create(uint32_t sizeX, uint32_t sizeY, Format format)
 }
 
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////	 
+/** 
+ * Allocate memory and initialize an empty array of 2D textures (GL_TEXTURE_2D_ARRAY), e.g. one layer per shadow 
+ * cascade. Layers can be attached individually to an Fbo.
+ * @param sizeX texture width
+ * @param sizeY texture height  
+ * @param nrOfLayers number of layers
+ * @param format pixel layout
+ * @return TF
+ */	
+bool ENG_API Eng::Texture::createArray(uint32_t sizeX, uint32_t sizeY, uint32_t nrOfLayers, Format format)
+{ 
+   // Safety net:
+   if (sizeX == 0 || sizeY == 0 || nrOfLayers == 0 || format == Format::none)
+   {
+      ENG_LOG_ERROR("Invalid params");
+      return false;
+   }	   
+   
+   GLuint intFormat;
+   switch (format)
+   {
+      ///////////////////////
+      case Format::r8g8b8: //    
+         intFormat = GL_RGB8;
+         break;
+      		
+      /////////////////////////
+      case Format::r8g8b8a8: //
+         intFormat = GL_RGBA8;
+         reserved->isTrasparent = true;
+         break;	      
+
+      //////////////////////
+      case Format::depth: //
+         intFormat = GL_DEPTH_COMPONENT32F;
+         break;
+
+      ///////////
+      default: //
+         ENG_LOG_ERROR("Unexpected format type");
+         return false;			
+   }  
+
+   // Init texture:
+   this->Eng::Texture::init();   
+
+   // Create it:		    
+   const GLuint oglId = this->getOglHandle();
+   glBindTexture(GL_TEXTURE_2D_ARRAY, oglId);   	      	
+   Eng::State::invalidate();
+   glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, intFormat, sizeX, sizeY, nrOfLayers);         
+   glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+   glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);   
+   glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE); 
+   glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);   
+   glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);     
+   if (format == Format::depth)
+   {
+      glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+      glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+      glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+      glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+      float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+      glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, borderColor);      
+   }
+   
+   // Resident (if supported):
+   if (Eng::Base::getInstance().isBindlessSupported())
+      this->Eng::Texture::makeResident();
+   	
+   // Done:
+   reserved->isArray = true;
+   this->setFormat(format);
+   this->setSizeX(sizeX);
+   this->setSizeY(sizeY);
+   this->setSizeZ(nrOfLayers);
+   return true;
+}
+
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
  * Empty rendering method. Bad sign if you read this. 
@@ -601,7 +698,7 @@ bool ENG_API Eng::Texture::render(uint32_t value, void *data) const
    }
    else // ...or old-school:
    {      
-      glBindTextures(value, 1, &reserved->oglId);
+      Eng::State::bindTexture(value, reserved->oglId);
    }
 
    // Done:
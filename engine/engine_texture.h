@@ -83,10 +83,12 @@ public: //
    uint32_t getOglHandle() const;
    uint64_t getOglBindlessHandle() const;
    bool getTrasparent() const;
+   bool isArray() const;
 
    // Bitmap:
    bool load(const Eng::Bitmap &bitmap);
    bool create(uint32_t sizeX, uint32_t sizeY, Format format);
+   bool createArray(uint32_t sizeX, uint32_t sizeY, uint32_t nrOfLayers, Format format);
 
    // Rendering methods:
    bool render(uint32_t value = 0, void *data = nullptr) const;
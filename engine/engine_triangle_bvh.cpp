@@ -0,0 +1,627 @@
+/**
+ * @file		engine_triangle_bvh.cpp
+ * @brief	Triangle-level bounding volume hierarchy for ray casting
+ *
+ * @author	Achille Peternier (achille.peternier@supsi.ch), (C) SUPSI
+ */
+
+
+
+//////////////
+// #INCLUDE //
+//////////////
+
+   // Main include:
+   #include "engine.h"
+
+   // C/C++:
+   #include <algorithm>
+
+   // SIMD:
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+   #define ENG_TRIANGLEBVH_SSE
+   #include <emmintrin.h>
+#endif
+
+
+
+////////////
+// STATIC //
+////////////
+
+   // Special values:
+   Eng::TriangleBvh Eng::TriangleBvh::empty("[empty]");
+
+   // SAH build parameters:
+   static constexpr uint32_t triangleBvhNrOfBins = 12;
+   static constexpr float triangleBvhTraversalCost = 1.0f;
+   static constexpr float triangleBvhIntersectionCost = 1.0f;
+
+   // Max tree depth, enforced by build() so that the fixed-size traversal stacks never overflow:
+   static constexpr uint32_t triangleBvhMaxDepth = 64;
+
+
+
+/////////////////////////
+// RESERVED STRUCTURES //
+/////////////////////////
+
+/**
+ * @brief TriangleBvh reserved structure.
+ */
+struct Eng::TriangleBvh::Reserved
+{
+   /**
+    * @brief Tree node (32 bytes).
+    */
+   struct Node
+   {
+      glm::vec3 min;          ///< Bounding box minimum
+      uint32_t first;         ///< First triangle (leaf) or left child (inner node; right child is first + 1)
+      glm::vec3 max;          ///< Bounding box maximum
+      uint32_t count;         ///< Number of triangles (0 for inner nodes)
+   };
+
+
+   /**
+    * @brief Triangle, in the layout used by the intersection test.
+    */
+   struct Triangle
+   {
+      glm::vec3 v0;           ///< First vertex
+      glm::vec3 e1;           ///< v1 - v0
+      glm::vec3 e2;           ///< v2 - v0
+      uint32_t face;          ///< Original face index
+   };
+
+
+   std::vector<Node> node;                               ///< Nodes (root first)
+   std::vector<Triangle> triangle;                       ///< Triangles, sorted by leaf
+
+
+   /**
+    * Intersects a ray with a triangle (Moller-Trumbore) and updates the hit if closer.
+    * @param ray ray
+    * @param tri triangle
+    * @param hit current closest hit
+    */
+   static void intersect(const Eng::TriangleBvh::Ray &ray, const Triangle &tri, Eng::TriangleBvh::Hit &hit)
+   {
+      const glm::vec3 p = glm::cross(ray.direction, tri.e2);
+      const float det = glm::dot(tri.e1, p);
+      if (glm::abs(det) < 1e-12f)
+         return;
+      const float invDet = 1.0f / det;
+      const glm::vec3 s = ray.origin - tri.v0;
+      const float u = glm::dot(s, p) * invDet;
+      if (u < 0.0f || u > 1.0f)
+         return;
+      const glm::vec3 q = glm::cross(s, tri.e1);
+      const float v = glm::dot(ray.direction, q) * invDet;
+      if (v < 0.0f || u + v > 1.0f)
+         return;
+      const float t = glm::dot(tri.e2, q) * invDet;
+      if (t > 0.0f && t < hit.t)
+      {
+         hit.t = t;
+         hit.u = u;
+         hit.v = v;
+         hit.face = tri.face;
+      }
+   }
+
+   /**
+    * Slab test.
+    * @param n node
+    * @param origin ray origin
+    * @param invDir inverse of the ray direction
+    * @param tMax max distance
+    * @return entry distance, or FLT_MAX if missed
+    */
+   static float intersect(const Node &n, const glm::vec3 &origin, const glm::vec3 &invDir, float tMax)
+   {
+      const glm::vec3 t0 = (n.min - origin) * invDir;
+      const glm::vec3 t1 = (n.max - origin) * invDir;
+      const glm::vec3 tMin = glm::min(t0, t1);
+      const glm::vec3 tFar = glm::max(t0, t1);
+      const float enter = glm::max(glm::max(tMin.x, tMin.y), glm::max(tMin.z, 0.0f));
+      const float exit = glm::min(glm::min(tFar.x, tFar.y), glm::min(tFar.z, tMax));
+      return (enter <= exit) ? enter : std::numeric_limits<float>::max();
+   }
+
+#ifdef ENG_TRIANGLEBVH_SSE
+   /**
+    * @brief Packet of 4 rays, in SoA layout.
+    */
+   struct Packet
+   {
+      __m128 ox, oy, oz;         ///< Origins
+      __m128 dx, dy, dz;         ///< Directions
+      __m128 ix, iy, iz;         ///< Inverse directions
+      __m128 t, u, v;            ///< Closest hits
+      __m128i face;              ///< Face indices
+   };
+
+   /**
+    * Tests a node against a packet.
+    * @param n node
+    * @param p packet
+    * @return true if at least one ray crosses the node
+    */
+   static bool intersect(const Node &n, const Packet &p)
+   {
+      const __m128 t0x = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(n.min.x), p.ox), p.ix);
+      const __m128 t1x = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(n.max.x), p.ox), p.ix);
+      const __m128 t0y = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(n.min.y), p.oy), p.iy);
+      const __m128 t1y = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(n.max.y), p.oy), p.iy);
+      const __m128 t0z = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(n.min.z), p.oz), p.iz);
+      const __m128 t1z = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(n.max.z), p.oz), p.iz);
+      __m128 enter = _mm_max_ps(_mm_max_ps(_mm_min_ps(t0x, t1x), _mm_min_ps(t0y, t1y)), _mm_max_ps(_mm_min_ps(t0z, t1z), _mm_setzero_ps()));
+      __m128 exit = _mm_min_ps(_mm_min_ps(_mm_max_ps(t0x, t1x), _mm_max_ps(t0y, t1y)), _mm_min_ps(_mm_max_ps(t0z, t1z), p.t));
+      return _mm_movemask_ps(_mm_cmple_ps(enter, exit)) != 0;
+   }
+
+   /**
+    * Intersects a packet with a triangle (Moller-Trumbore, 4 rays at once) and updates the closer hits.
+    * @param p packet
+    * @param tri triangle
+    */
+   static void intersect(Packet &p, const Triangle &tri)
+   {
+      const __m128 e1x = _mm_set1_ps(tri.e1.x), e1y = _mm_set1_ps(tri.e1.y), e1z = _mm_set1_ps(tri.e1.z);
+      const __m128 e2x = _mm_set1_ps(tri.e2.x), e2y = _mm_set1_ps(tri.e2.y), e2z = _mm_set1_ps(tri.e2.z);
+
+      // p = d x e2:
+      const __m128 px = _mm_sub_ps(_mm_mul_ps(p.dy, e2z), _mm_mul_ps(p.dz, e2y));
+      const __m128 py = _mm_sub_ps(_mm_mul_ps(p.dz, e2x), _mm_mul_ps(p.dx, e2z));
+      const __m128 pz = _mm_sub_ps(_mm_mul_ps(p.dx, e2y), _mm_mul_ps(p.dy, e2x));
+      const __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+      const __m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+      // s = o - v0:
+      const __m128 sx = _mm_sub_ps(p.ox, _mm_set1_ps(tri.v0.x));
+      const __m128 sy = _mm_sub_ps(p.oy, _mm_set1_ps(tri.v0.y));
+      const __m128 sz = _mm_sub_ps(p.oz, _mm_set1_ps(tri.v0.z));
+      const __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), invDet);
+
+      // q = s x e1:
+      const __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+      const __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+      const __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+      const __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(p.dx, qx), _mm_mul_ps(p.dy, qy)), _mm_mul_ps(p.dz, qz)), invDet);
+      const __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), invDet);
+
+      // Accept:
+      const __m128 zero = _mm_setzero_ps();
+      const __m128 absDet = _mm_andnot_ps(_mm_set1_ps(-0.0f), det);
+      __m128 mask = _mm_cmpge_ps(absDet, _mm_set1_ps(1e-12f));
+      mask = _mm_and_ps(mask, _mm_cmpge_ps(u, zero));
+      mask = _mm_and_ps(mask, _mm_cmpge_ps(v, zero));
+      mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.0f)));
+      mask = _mm_and_ps(mask, _mm_cmpgt_ps(t, zero));
+      mask = _mm_and_ps(mask, _mm_cmplt_ps(t, p.t));
+      if (_mm_movemask_ps(mask) == 0)
+         return;
+
+      p.t = _mm_or_ps(_mm_and_ps(mask, t), _mm_andnot_ps(mask, p.t));
+      p.u = _mm_or_ps(_mm_and_ps(mask, u), _mm_andnot_ps(mask, p.u));
+      p.v = _mm_or_ps(_mm_and_ps(mask, v), _mm_andnot_ps(mask, p.v));
+      const __m128i imask = _mm_castps_si128(mask);
+      p.face = _mm_or_si128(_mm_and_si128(imask, _mm_set1_epi32(static_cast<int>(tri.face))), _mm_andnot_si128(imask, p.face));
+   }
+#endif
+};
+
+
+
+///////////////////////////////
+// BODY OF CLASS TriangleBvh //
+///////////////////////////////
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Constructor.
+ */
+ENG_API Eng::TriangleBvh::TriangleBvh() : reserved(std::make_unique<Eng::TriangleBvh::Reserved>())
+{
+   ENG_LOG_DETAIL("[+]");
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Constructor with name.
+ * @param name node name
+ */
+ENG_API Eng::TriangleBvh::TriangleBvh(const std::string &name) : Eng::Object(name), reserved(std::make_unique<Eng::TriangleBvh::Reserved>())
+{
+   ENG_LOG_DETAIL("[+]");
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Move constructor.
+ */
+ENG_API Eng::TriangleBvh::TriangleBvh(TriangleBvh &&other) : Eng::Object(std::move(other)), reserved(std::move(other.reserved))
+{
+   ENG_LOG_DETAIL("[M]");
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Destructor.
+ */
+ENG_API Eng::TriangleBvh::~TriangleBvh()
+{
+   ENG_LOG_DETAIL("[-]");
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the number of triangles stored.
+ * @return number of faces
+ */
+uint32_t ENG_API Eng::TriangleBvh::getNrOfFaces() const
+{
+   return static_cast<uint32_t>(reserved->triangle.size());
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Gets the number of nodes of the tree.
+ * @return number of nodes
+ */
+uint32_t ENG_API Eng::TriangleBvh::getNrOfNodes() const
+{
+   return static_cast<uint32_t>(reserved->node.size());
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Appends the stored triangles (3 vertices each, in leaf order) to the given vector.
+ * @param vertices triangle soup to fill
+ * @return number of triangles appended
+ */
+uint32_t ENG_API Eng::TriangleBvh::getTriangles(std::vector<glm::vec3> &vertices) const
+{
+   vertices.reserve(vertices.size() + reserved->triangle.size() * 3);
+   for (const Reserved::Triangle &tri : reserved->triangle)
+   {
+      vertices.push_back(tri.v0);
+      vertices.push_back(tri.v0 + tri.e1);
+      vertices.push_back(tri.v0 + tri.e2);
+   }
+
+   // Done:
+   return static_cast<uint32_t>(reserved->triangle.size());
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Builds the tree over the given geometry, using a binned surface area heuristic.
+ * @param vertices vertex data
+ * @param nrOfVertices number of vertices
+ * @param faces face data
+ * @param nrOfFaces number of faces
+ * @return TF
+ */
+bool ENG_API Eng::TriangleBvh::build(const Eng::Vbo::VertexData *vertices, uint32_t nrOfVertices, const Eng::Ebo::FaceData *faces, uint32_t nrOfFaces)
+{
+   // Safety net:
+   if (vertices == nullptr || faces == nullptr || nrOfFaces == 0)
+   {
+      ENG_LOG_ERROR("Invalid params");
+      return false;
+   }
+   for (uint32_t c = 0; c < nrOfFaces; c++)
+      if (faces[c].a >= nrOfVertices || faces[c].b >= nrOfVertices || faces[c].c >= nrOfVertices)
+      {
+         ENG_LOG_ERROR("Out of range index found");
+         return false;
+      }
+
+   // Triangles, bounds and centroids:
+   std::vector<Reserved::Triangle> tri(nrOfFaces);
+   std::vector<glm::vec3> triMin(nrOfFaces), triMax(nrOfFaces), centroid(nrOfFaces);
+   std::vector<uint32_t> index(nrOfFaces);
+   for (uint32_t c = 0; c < nrOfFaces; c++)
+   {
+      const glm::vec3 &p0 = vertices[faces[c].a].vertex;
+      const glm::vec3 &p1 = vertices[faces[c].b].vertex;
+      const glm::vec3 &p2 = vertices[faces[c].c].vertex;
+      tri[c].v0 = p0;
+      tri[c].e1 = p1 - p0;
+      tri[c].e2 = p2 - p0;
+      tri[c].face = c;
+      triMin[c] = glm::min(p0, glm::min(p1, p2));
+      triMax[c] = glm::max(p0, glm::max(p1, p2));
+      centroid[c] = (triMin[c] + triMax[c]) * 0.5f;
+      index[c] = c;
+   }
+
+   // Top-down build (explicit stack):
+   struct Task
+   {
+      uint32_t node;
+      uint32_t first;
+      uint32_t count;
+      uint32_t depth;
+   };
+   reserved->node.clear();
+   reserved->node.reserve(2 * nrOfFaces);
+   reserved->node.push_back(Reserved::Node());
+   std::vector<Task> stack = { { 0, 0, nrOfFaces, 0 } };
+   while (!stack.empty())
+   {
+      const Task task = stack.back();
+      stack.pop_back();
+
+      // Bounds:
+      glm::vec3 bMin(std::numeric_limits<float>::max()), bMax(-std::numeric_limits<float>::max());
+      glm::vec3 cMin(std::numeric_limits<float>::max()), cMax(-std::numeric_limits<float>::max());
+      for (uint32_t c = task.first; c < task.first + task.count; c++)
+      {
+         bMin = glm::min(bMin, triMin[index[c]]);
+         bMax = glm::max(bMax, triMax[index[c]]);
+         cMin = glm::min(cMin, centroid[index[c]]);
+         cMax = glm::max(cMax, centroid[index[c]]);
+      }
+      Reserved::Node &n = reserved->node[task.node];
+      n.min = bMin;
+      n.max = bMax;
+      n.first = task.first;
+      n.count = task.count;
+      if (task.count <= 2 || task.depth + 1 >= triangleBvhMaxDepth) // Traversal keeps up to depth + 2 entries
+         continue;
+
+      // Best split among the bins of each axis:
+      const glm::vec3 extent = cMax - cMin;
+      float bestCost = std::numeric_limits<float>::max();
+      uint32_t bestAxis = 0, bestSplit = 0;
+      for (uint32_t axis = 0; axis < 3; axis++)
+      {
+         if (extent[axis] <= 0.0f)
+            continue;
+
+         struct Bin
+         {
+            glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+            glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+            uint32_t count = 0;
+         } bin[triangleBvhNrOfBins];
+         const float scale = triangleBvhNrOfBins / extent[axis];
+         for (uint32_t c = task.first; c < task.first + task.count; c++)
+         {
+            const uint32_t b = std::min(triangleBvhNrOfBins - 1, static_cast<uint32_t>((centroid[index[c]][axis] - cMin[axis]) * scale));
+            bin[b].min = glm::min(bin[b].min, triMin[index[c]]);
+            bin[b].max = glm::max(bin[b].max, triMax[index[c]]);
+            bin[b].count++;
+         }
+
+         // Sweep:
+         auto area = [](const glm::vec3 &mn, const glm::vec3 &mx) -> float
+         {
+            const glm::vec3 d = mx - mn;
+            return (d.x < 0.0f) ? 0.0f : 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+         };
+         float leftArea[triangleBvhNrOfBins - 1];
+         uint32_t leftCount[triangleBvhNrOfBins - 1];
+         glm::vec3 mn(std::numeric_limits<float>::max()), mx(-std::numeric_limits<float>::max());
+         uint32_t count = 0;
+         for (uint32_t b = 0; b < triangleBvhNrOfBins - 1; b++)
+         {
+            mn = glm::min(mn, bin[b].min);
+            mx = glm::max(mx, bin[b].max);
+            count += bin[b].count;
+            leftArea[b] = area(mn, mx);
+            leftCount[b] = count;
+         }
+         mn = glm::vec3(std::numeric_limits<float>::max());
+         mx = glm::vec3(-std::numeric_limits<float>::max());
+         count = 0;
+         for (uint32_t b = triangleBvhNrOfBins - 1; b > 0; b--)
+         {
+            mn = glm::min(mn, bin[b].min);
+            mx = glm::max(mx, bin[b].max);
+            count += bin[b].count;
+            const float cost = leftArea[b - 1] * leftCount[b - 1] + area(mn, mx) * count;
+            if (leftCount[b - 1] && count && cost < bestCost)
+            {
+               bestCost = cost;
+               bestAxis = axis;
+               bestSplit = b;
+            }
+         }
+      }
+
+      // Leaf or split?
+      const float parentArea = 2.0f * ((bMax - bMin).x * (bMax - bMin).y + (bMax - bMin).y * (bMax - bMin).z + (bMax - bMin).z * (bMax - bMin).x);
+      const float splitCost = triangleBvhTraversalCost + triangleBvhIntersectionCost * bestCost / glm::max(parentArea, 1e-20f);
+      const float leafCost = triangleBvhIntersectionCost * task.count;
+      if (bestCost == std::numeric_limits<float>::max() || (task.count <= maxLeafSize && splitCost >= leafCost))
+         continue;
+
+      // Partition:
+      const float scale = triangleBvhNrOfBins / extent[bestAxis];
+      uint32_t *middle = std::partition(index.data() + task.first, index.data() + task.first + task.count, [&](uint32_t t)
+      {
+         return std::min(triangleBvhNrOfBins - 1, static_cast<uint32_t>((centroid[t][bestAxis] - cMin[bestAxis]) * scale)) < bestSplit;
+      });
+      const uint32_t leftCount = static_cast<uint32_t>(middle - (index.data() + task.first));
+
+      // Children are allocated in pairs:
+      const uint32_t left = static_cast<uint32_t>(reserved->node.size());
+      reserved->node.push_back(Reserved::Node());
+      reserved->node.push_back(Reserved::Node());
+      reserved->node[task.node].first = left;
+      reserved->node[task.node].count = 0;
+      stack.push_back({ left + 1, task.first + leftCount, task.count - leftCount, task.depth + 1 });
+      stack.push_back({ left, task.first, leftCount, task.depth + 1 });
+   }
+
+   // Store the triangles in leaf order:
+   reserved->triangle.resize(nrOfFaces);
+   for (uint32_t c = 0; c < nrOfFaces; c++)
+      reserved->triangle[c] = tri[index[c]];
+   reserved->node.shrink_to_fit();
+
+   // Done:
+   return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Releases the tree and the geometry copy.
+ */
+void ENG_API Eng::TriangleBvh::reset()
+{
+   reserved->node.clear();
+   reserved->node.shrink_to_fit();
+   reserved->triangle.clear();
+   reserved->triangle.shrink_to_fit();
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Finds the closest intersection along a single ray.
+ * @param ray ray
+ * @param hit closest hit (hit.face is noHit if missed)
+ * @return true if hit
+ */
+bool ENG_API Eng::TriangleBvh::intersect(const Ray &ray, Hit &hit) const
+{
+   hit = Hit();
+   hit.t = ray.tMax;
+   if (reserved->node.empty())
+      return false;
+
+   const glm::vec3 invDir = 1.0f / ray.direction;
+   uint32_t stack[triangleBvhMaxDepth];
+   uint32_t top = 0;
+   stack[top++] = 0;
+   while (top)
+   {
+      const Reserved::Node &n = reserved->node[stack[--top]];
+      if (Reserved::intersect(n, ray.origin, invDir, hit.t) == std::numeric_limits<float>::max())
+         continue;
+
+      if (n.count)
+      {
+         for (uint32_t c = n.first; c < n.first + n.count; c++)
+            Reserved::intersect(ray, reserved->triangle[c], hit);
+         continue;
+      }
+
+      // Visit the nearest child first:
+      const float dLeft = Reserved::intersect(reserved->node[n.first], ray.origin, invDir, hit.t);
+      const float dRight = Reserved::intersect(reserved->node[n.first + 1], ray.origin, invDir, hit.t);
+      const bool leftFirst = dLeft <= dRight;
+      stack[top++] = leftFirst ? n.first + 1 : n.first;
+      stack[top++] = leftFirst ? n.first : n.first + 1;
+   }
+
+   // Done:
+   return hit.face != noHit;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Finds the closest intersections of many rays. Rays are traced in packets of 4 sharing the traversal (SSE), which
+ * is most effective with coherent rays (e.g., neighbouring pixels or probes from a common origin).
+ * @param rays array of rays
+ * @param nrOfRays number of rays
+ * @param hits array of nrOfRays hits, filled with the closest hits
+ * @return number of rays hitting something
+ */
+uint32_t ENG_API Eng::TriangleBvh::intersect(const Ray *rays, uint32_t nrOfRays, Hit *hits) const
+{
+   // Safety net:
+   if (rays == nullptr || hits == nullptr)
+   {
+      ENG_LOG_ERROR("Invalid params");
+      return 0;
+   }
+
+   uint32_t nrOfHits = 0;
+   uint32_t c = 0;
+
+#ifdef ENG_TRIANGLEBVH_SSE
+   if (!reserved->node.empty())
+      for (; c + packetSize <= nrOfRays; c += packetSize)
+      {
+         const Ray *r = rays + c;
+         Reserved::Packet p;
+         p.ox = _mm_setr_ps(r[0].origin.x, r[1].origin.x, r[2].origin.x, r[3].origin.x);
+         p.oy = _mm_setr_ps(r[0].origin.y, r[1].origin.y, r[2].origin.y, r[3].origin.y);
+         p.oz = _mm_setr_ps(r[0].origin.z, r[1].origin.z, r[2].origin.z, r[3].origin.z);
+         p.dx = _mm_setr_ps(r[0].direction.x, r[1].direction.x, r[2].direction.x, r[3].direction.x);
+         p.dy = _mm_setr_ps(r[0].direction.y, r[1].direction.y, r[2].direction.y, r[3].direction.y);
+         p.dz = _mm_setr_ps(r[0].direction.z, r[1].direction.z, r[2].direction.z, r[3].direction.z);
+         p.ix = _mm_div_ps(_mm_set1_ps(1.0f), p.dx);
+         p.iy = _mm_div_ps(_mm_set1_ps(1.0f), p.dy);
+         p.iz = _mm_div_ps(_mm_set1_ps(1.0f), p.dz);
+         p.t = _mm_setr_ps(r[0].tMax, r[1].tMax, r[2].tMax, r[3].tMax);
+         p.u = _mm_setzero_ps();
+         p.v = _mm_setzero_ps();
+         p.face = _mm_set1_epi32(static_cast<int>(noHit));
+
+         // Shared traversal:
+         uint32_t stack[triangleBvhMaxDepth];
+         uint32_t top = 0;
+         stack[top++] = 0;
+         while (top)
+         {
+            const Reserved::Node &n = reserved->node[stack[--top]];
+            if (!Reserved::intersect(n, p))
+               continue;
+            if (n.count)
+            {
+               for (uint32_t t = n.first; t < n.first + n.count; t++)
+                  Reserved::intersect(p, reserved->triangle[t]);
+               continue;
+            }
+
+            // Order by the direction sign of the first ray along the largest child separation:
+            const glm::vec3 d = (reserved->node[n.first + 1].min + reserved->node[n.first + 1].max) -
+                                (reserved->node[n.first].min + reserved->node[n.first].max);
+            const bool leftFirst = glm::dot(d, r[0].direction) >= 0.0f;
+            stack[top++] = leftFirst ? n.first + 1 : n.first;
+            stack[top++] = leftFirst ? n.first : n.first + 1;
+         }
+
+         // Store:
+         float t[packetSize], u[packetSize], v[packetSize];
+         uint32_t face[packetSize];
+         _mm_storeu_ps(t, p.t);
+         _mm_storeu_ps(u, p.u);
+         _mm_storeu_ps(v, p.v);
+         _mm_storeu_si128(reinterpret_cast<__m128i *>(face), p.face);
+         for (uint32_t i = 0; i < packetSize; i++)
+         {
+            hits[c + i].t = t[i];
+            hits[c + i].u = u[i];
+            hits[c + i].v = v[i];
+            hits[c + i].face = face[i];
+            if (face[i] != noHit)
+               nrOfHits++;
+         }
+      }
+#endif
+
+   // Remaining rays (or no SIMD):
+   for (; c < nrOfRays; c++)
+      if (intersect(rays[c], hits[c]))
+         nrOfHits++;
+
+   // Done:
+   return nrOfHits;
+}
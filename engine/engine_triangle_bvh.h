@@ -0,0 +1,101 @@
+/**
+ * @file		engine_triangle_bvh.h
+ * @brief	Triangle-level bounding volume hierarchy for ray casting
+ *
+ * @author	Achille Peternier (achille.peternier@supsi.ch), (C) SUPSI
+ */
+#pragma once
+
+
+
+/**
+ * @brief Static BVH over the triangles of a mesh, built with the surface area heuristic (binned). Keeps a CPU copy
+ *        of the geometry in a ray-friendly layout. Rays are expressed in the coordinate system of the geometry (i.e.,
+ *        mesh local coordinates). Rays can be traced one by one or in packets of 4 (SSE).
+ */
+class ENG_API TriangleBvh final : public Eng::Object
+{
+//////////
+public: //
+//////////
+
+   // Special values:
+   static TriangleBvh empty;
+
+   // Consts:
+   static constexpr uint32_t packetSize = 4;             ///< Number of rays per packet
+   static constexpr uint32_t maxLeafSize = 4;            ///< Max number of triangles per leaf (unless at the max depth)
+   static constexpr uint32_t noHit = 0xFFFFFFFF;         ///< Face index of a missed ray
+
+
+   /**
+    * @brief Ray.
+    */
+   struct Ray
+   {
+      glm::vec3 origin;       ///< Origin
+      glm::vec3 direction;    ///< Direction (not necessarily normalized)
+      float tMax;             ///< Max parametric distance along the direction
+
+
+      /**
+       * Constructor.
+       */
+      Ray() : origin{ 0.0f }, direction{ 0.0f, 0.0f, -1.0f }, tMax{ std::numeric_limits<float>::max() }
+      {}
+   };
+
+
+   /**
+    * @brief Ray hit.
+    */
+   struct Hit
+   {
+      float t;                ///< Parametric distance along the ray
+      float u;                ///< First barycentric coordinate
+      float v;                ///< Second barycentric coordinate
+      uint32_t face;          ///< Face index or noHit
+
+
+      /**
+       * Constructor.
+       */
+      Hit() : t{ std::numeric_limits<float>::max() }, u{ 0.0f }, v{ 0.0f }, face{ noHit }
+      {}
+   };
+
+
+   // Const/dest:
+   TriangleBvh();
+   TriangleBvh(TriangleBvh &&other);
+   TriangleBvh(TriangleBvh const &) = delete;
+   virtual ~TriangleBvh();
+
+   // Get/set:
+   uint32_t getNrOfFaces() const;
+   uint32_t getNrOfNodes() const;
+   uint32_t getTriangles(std::vector<glm::vec3> &vertices) const;
+
+   // Management:
+   bool build(const Eng::Vbo::VertexData *vertices, uint32_t nrOfVertices, const Eng::Ebo::FaceData *faces, uint32_t nrOfFaces);
+   void reset();
+
+   // Queries:
+   bool intersect(const Ray &ray, Hit &hit) const;
+   uint32_t intersect(const Ray *rays, uint32_t nrOfRays, Hit *hits) const;
+
+
+///////////
+private: //
+///////////
+
+   // Reserved:
+   struct Reserved;
+   std::unique_ptr<Reserved> reserved;
+
+   // Const/dest:
+   TriangleBvh(const std::string &name);
+
+   // Workaround for disabling the unneeded rendering method:
+   using Object::render;
+};
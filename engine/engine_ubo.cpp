@@ -0,0 +1,293 @@
+/**
+ * @file		engine_ubo.cpp
+ * @brief	OpenGL Uniform Buffer Object (UBO)
+ *
+ * @author	Achille Peternier (achille.peternier@supsi.ch), (C) SUPSI
+ */
+
+
+
+//////////////
+// #INCLUDE //
+//////////////
+
+   // Main include:
+   #include "engine.h"
+
+   // OGL:      
+   #include <GL/glew.h>
+   #include <GLFW/glfw3.h>
+
+
+
+////////////
+// STATIC //
+////////////
+
+   // Special values:
+   Eng::Ubo Eng::Ubo::empty("[empty]");
+
+
+
+/////////////////////////
+// RESERVED STRUCTURES //
+/////////////////////////
+
+/**
+ * @brief UBO reserved structure.
+ */
+struct Eng::Ubo::Reserved
+{  
+   GLuint oglId;                    ///< OpenGL buffer ID
+   uint64_t size;                   ///< Size in bytes
+
+
+   /**
+    * Constructor.
+    */
+   Reserved() : oglId{ 0 }, size{ 0 }
+   {}
+};
+
+
+
+///////////////////////
+// BODY OF CLASS Ubo //
+///////////////////////
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Constructor.
+ */
+ENG_API Eng::Ubo::Ubo() : reserved(std::make_unique<Eng::Ubo::Reserved>())
+{
+   ENG_LOG_DETAIL("[+]");
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Constructor with name.
+ * @param name node name
+ */
+ENG_API Eng::Ubo::Ubo(const std::string &name) : Eng::Object(name), reserved(std::make_unique<Eng::Ubo::Reserved>())
+{
+   ENG_LOG_DETAIL("[+]");
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Move constructor.
+ */
+ENG_API Eng::Ubo::Ubo(Ubo &&other) : Eng::Object(std::move(other)), Eng::Managed(std::move(other)), reserved(std::move(other.reserved))
+{
+   ENG_LOG_DETAIL("[M]");
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Destructor.
+ */
+ENG_API Eng::Ubo::~Ubo()
+{
+   ENG_LOG_DETAIL("[-]");
+   if (reserved)
+      this->free();
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Return the GLuint object ID.
+ * @return object ID or 0 if not valid
+ */
+uint32_t ENG_API Eng::Ubo::getOglHandle() const
+{
+   return reserved->oglId;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Return the size in bytes of the buffer.
+ * @return size in bytes
+ */
+uint64_t ENG_API Eng::Ubo::getSize() const
+{
+   return reserved->size;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Return the alignment required by the driver for the offsets passed to renderRange(). Queried once.
+ * @return alignment in bytes
+ */
+uint64_t ENG_API Eng::Ubo::getOffsetAlignment()
+{
+   static GLint alignment = 0;
+   if (alignment <= 0)
+   {
+      glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+      if (alignment <= 0)
+         alignment = 256; // Largest value allowed by the specs
+   }
+
+   // Done:
+   return static_cast<uint64_t>(alignment);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Rounds a block size up to the offset alignment, i.e. gives the stride to use when packing several blocks into one 
+ * buffer to be bound with renderRange().
+ * @param size block size in bytes
+ * @return aligned size in bytes
+ */
+uint64_t ENG_API Eng::Ubo::getAlignedSize(uint64_t size)
+{
+   const uint64_t alignment = getOffsetAlignment();
+   return ((size + alignment - 1) / alignment) * alignment;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Initializes an OpenGL UBO.
+ * @return TF
+ */
+bool ENG_API Eng::Ubo::init()
+{
+   if (this->Eng::Managed::init() == false)
+      return false;
+
+   // Free buffer if already stored:
+   if (reserved->oglId)   
+   {   
+      Eng::State::releaseBuffer(reserved->oglId);
+      glDeleteBuffers(1, &reserved->oglId);    
+      reserved->oglId = 0;   
+      reserved->size = 0;
+   }   
+
+   // Create it:		    
+   glGenBuffers(1, &reserved->oglId);          
+
+   // Done:   
+   return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Releases an OpenGL UBO.
+ * @return TF
+ */
+bool ENG_API Eng::Ubo::free()
+{
+   if (this->Eng::Managed::free() == false)
+      return false;
+
+   // Free UBO if stored:
+   if (reserved->oglId)
+   {
+      Eng::State::releaseBuffer(reserved->oglId);
+      glDeleteBuffers(1, &reserved->oglId);
+      reserved->oglId = 0;
+      reserved->size = 0;
+   }
+
+   // Done:   
+   return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Create buffer by allocating the required storage.
+ * @param size size in bytes
+ * @param data pointer to the data to copy into the buffer (std140 layout), or nullptr
+ * @return TF
+ */
+bool ENG_API Eng::Ubo::create(uint64_t size, const void *data)
+{	
+   // Safety net:
+   if (size == 0)
+   {
+      ENG_LOG_ERROR("Invalid params");
+      return false;
+   }
+
+   // Init buffer:
+   if (!this->isInitialized())
+      this->init();
+
+   // Create it:		              
+   Eng::State::bindBuffer(GL_UNIFORM_BUFFER, reserved->oglId);
+   glBufferData(GL_UNIFORM_BUFFER, size, data, GL_DYNAMIC_DRAW); 
+
+   // Done:
+   reserved->size = size;
+   return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Updates (part of) the buffer content.
+ * @param data pointer to the data to copy into the buffer (std140 layout)
+ * @param size size in bytes
+ * @param offset offset in bytes from the beginning of the buffer
+ * @return TF
+ */
+bool ENG_API Eng::Ubo::update(const void *data, uint64_t size, uint64_t offset)
+{	
+   // Safety net:
+   if (data == nullptr || offset + size > reserved->size)
+   {
+      ENG_LOG_ERROR("Invalid params");
+      return false;
+   }
+
+   Eng::State::bindBuffer(GL_UNIFORM_BUFFER, reserved->oglId);
+   glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
+
+   // Done:
+   return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Rendering method. Binds the whole buffer.
+ * @param value binding point
+ * @param data generic pointer to any kind of data
+ * @return TF
+ */
+bool ENG_API Eng::Ubo::render(uint32_t value, void *data) const
+{	   
+   Eng::State::bindBufferBase(GL_UNIFORM_BUFFER, value, reserved->oglId);  
+   
+   // Done:
+   return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Binds a portion of the buffer (e.g., one block out of an array of blocks). 
+ * @param binding binding point
+ * @param offset offset in bytes (multiple of getOffsetAlignment())
+ * @param size size in bytes of the bound range
+ * @return TF
+ */
+bool ENG_API Eng::Ubo::renderRange(uint32_t binding, uint64_t offset, uint64_t size) const
+{	   
+   Eng::State::bindBufferRange(GL_UNIFORM_BUFFER, binding, reserved->oglId, offset, size);  
+   
+   // Done:
+   return true;
+}
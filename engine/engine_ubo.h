@@ -0,0 +1,67 @@
+/**
+ * @file		engine_ubo.h
+ * @brief	OpenGL Uniform Buffer Object (UBO)
+ *
+ * @author	Achille Peternier (achille.peternier@supsi.ch), (C) SUPSI
+ */
+#pragma once
+
+
+
+/**
+ * @brief Class for modeling a Uniform Buffer Object (UBO). Contents are expected in std140 layout. The engine uses
+ *        fixed binding points, so that shaders can declare their blocks with layout(binding = ...).
+ */
+class ENG_API Ubo final : public Eng::Object, public Eng::Managed
+{
+//////////
+public: //
+//////////
+
+   // Special values:
+   static Ubo empty;
+
+   // Binding points:
+   static constexpr uint32_t frameBinding = 0;           ///< Per-frame data (camera)
+   static constexpr uint32_t lightBinding = 1;           ///< Per-light data
+   static constexpr uint32_t materialBinding = 2;        ///< Material parameters
+   static constexpr uint32_t objectBinding = 3;          ///< Per-object matrices
+   static constexpr uint32_t emitterBinding = 4;         ///< Particle emitter parameters
+
+
+   // Const/dest:
+   Ubo();
+   Ubo(Ubo &&other);
+   Ubo(Ubo const &) = delete;
+   ~Ubo();   
+   
+   // Get/set:   
+   uint64_t getSize() const;
+   uint32_t getOglHandle() const;
+   static uint64_t getOffsetAlignment();
+   static uint64_t getAlignedSize(uint64_t size);
+
+   // Data:
+   bool create(uint64_t size, const void *data = nullptr);
+   bool update(const void *data, uint64_t size, uint64_t offset = 0);
+
+   // Rendering methods:   
+   bool render(uint32_t value = 0, void *data = nullptr) const;
+   bool renderRange(uint32_t binding, uint64_t offset, uint64_t size) const;
+
+   // Managed:
+   bool init() override;
+   bool free() override;
+
+
+///////////
+private: //
+///////////
+
+   // Reserved:
+   struct Reserved;
+   std::unique_ptr<Reserved> reserved;
+
+   // Const/dest:
+   Ubo(const std::string &name);
+};
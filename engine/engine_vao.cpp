@@ -121,6 +121,7 @@ bool ENG_API Eng::Vao::init()
    // Free buffer if already stored:
    if (reserved->oglId)
    {
+      Eng::State::releaseVertexArray(reserved->oglId);
       glDeleteVertexArrays(1, &reserved->oglId);
       reserved->oglId = 0;
    }
@@ -146,6 +147,7 @@ bool ENG_API Eng::Vao::free()
    // Free VAO if stored:
    if (reserved->oglId)
    {
+      Eng::State::releaseVertexArray(reserved->oglId);
       glDeleteVertexArrays(1, &reserved->oglId);
       reserved->oglId = 0;
    }
@@ -161,7 +163,7 @@ bool ENG_API Eng::Vao::free()
  */
 void ENG_API Eng::Vao::reset()
 {	   
-	glBindVertexArray(0);
+	Eng::State::bindVertexArray(0);
 }
 
 
@@ -174,7 +176,7 @@ void ENG_API Eng::Vao::reset()
  */
 bool ENG_API Eng::Vao::render(uint32_t value, void *data) const
 {	   
-   glBindVertexArray(reserved->oglId);
+   Eng::State::bindVertexArray(reserved->oglId);
    
    // Done:
    return true;
@@ -38,14 +38,15 @@
  */
 struct Eng::Vbo::Reserved
 {  
-   GLuint oglId;           ///< OpenGL shader ID
-   uint32_t nrOfVertices;  ///< Nr. of vertices
+   GLuint oglId;              ///< OpenGL shader ID
+   uint32_t nrOfVertices;     ///< Nr. of vertices
+   Eng::Vbo::Format format;   ///< Vertex format
 
 
    /**
     * Constructor.
     */
-   Reserved() : oglId{ 0 }, nrOfVertices{ 0 }
+   Reserved() : oglId{ 0 }, nrOfVertices{ 0 }, format{ Eng::Vbo::Format::none }
    {}
 };
 
@@ -120,6 +121,17 @@ uint32_t ENG_API Eng::Vbo::getNrOfVertices() const
 }
 
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Return the vertex format used by this VBO.
+ * @return vertex format or Format::none if empty
+ */
+Eng::Vbo::Format ENG_API Eng::Vbo::getFormat() const
+{
+   return reserved->format;
+}
+
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
  * Initializes an OpenGL VBO.
@@ -133,9 +145,11 @@ bool ENG_API Eng::Vbo::init()
    // Free buffer if already stored:
    if (reserved->oglId)   
    {   
+	   Eng::State::releaseBuffer(reserved->oglId);
 	   glDeleteBuffers(1, &reserved->oglId);    
       reserved->oglId = 0;   
       reserved->nrOfVertices = 0;
+      reserved->format = Eng::Vbo::Format::none;
    }   
 
 	// Create it:		    
@@ -159,9 +173,11 @@ bool ENG_API Eng::Vbo::free()
    // Free VBO if stored:
    if (reserved->oglId)
    {
+      Eng::State::releaseBuffer(reserved->oglId);
       glDeleteBuffers(1, &reserved->oglId);
       reserved->oglId = 0;
       reserved->nrOfVertices = 0;
+      reserved->format = Eng::Vbo::Format::none;
    }
 
    // Done:   
@@ -173,12 +189,27 @@ bool ENG_API Eng::Vbo::free()
  * Create buffer by allocating the required storage.
  * @param nfOfVertices number of vertices to store
  * @param data pointer to the data to copy into the buffer 
+ * @param format vertex format of the data (VertexData, QuantizedVertexData or position only)
  * @return TF
  */
-bool ENG_API Eng::Vbo::create(uint32_t nrOfVertices, const void *data)
+bool ENG_API Eng::Vbo::create(uint32_t nrOfVertices, const void *data, Format format)
 {	
+   // Safety net:
+   if (format == Format::none || format == Format::last)
+   {
+      ENG_LOG_ERROR("Invalid params");
+      return false;
+   }
+
    // Unit size:
-   const uint32_t unitSize = sizeof(VertexData);
+   uint32_t unitSize = sizeof(VertexData);
+   switch (format)
+   {
+      case Format::quantized:          unitSize = sizeof(QuantizedVertexData); break;
+      case Format::position:           unitSize = sizeof(glm::vec3); break;
+      case Format::quantizedPosition:  unitSize = 4 * sizeof(uint16_t); break;
+      default:                         break;
+   }
 
    // Init buffer:
    if (!this->isInitialized())
@@ -188,7 +219,7 @@ bool ENG_API Eng::Vbo::create(uint32_t nrOfVertices, const void *data)
 
 	// Fill it:		              
    const GLuint oglId = this->getOglHandle();  
-   glBindBuffer(GL_ARRAY_BUFFER, oglId);
+   Eng::State::bindBuffer(GL_ARRAY_BUFFER, oglId);
    glBufferData(GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW); 
 
    // Setup interleaved-buffer:
@@ -196,10 +227,26 @@ bool ENG_API Eng::Vbo::create(uint32_t nrOfVertices, const void *data)
    uint32_t offset = 0;   
    
    // Vertex position data:
-   glVertexAttribFormat(static_cast<GLuint>(Attrib::vertex), 3, GL_FLOAT, GL_FALSE, offset);
+   if (format == Format::quantized || format == Format::quantizedPosition)
+   {
+      glVertexAttribFormat(static_cast<GLuint>(Attrib::vertex), 3, GL_UNSIGNED_SHORT, GL_TRUE, offset);
+      offset += 4 * sizeof(uint16_t); // 3x unorm + padding
+   }
+   else
+   {
+      glVertexAttribFormat(static_cast<GLuint>(Attrib::vertex), 3, GL_FLOAT, GL_FALSE, offset);
+      offset += sizeof(glm::vec3);
+   }
    glVertexAttribBinding(static_cast<GLuint>(Attrib::vertex), 0);
    glEnableVertexAttribArray(static_cast<GLuint>(Attrib::vertex));
-   offset += sizeof(glm::vec3);
+
+   // Position-only streams end here:
+   if (format == Format::position || format == Format::quantizedPosition)
+   {
+      reserved->nrOfVertices = nrOfVertices;
+      reserved->format = format;
+      return true;
+   }
    
    // Normal data:   
    glVertexAttribFormat(static_cast<GLuint>(Attrib::normal), 4, GL_INT_2_10_10_10_REV, GL_TRUE, offset);
@@ -221,6 +268,7 @@ bool ENG_API Eng::Vbo::create(uint32_t nrOfVertices, const void *data)
 
    // Done:
    reserved->nrOfVertices = nrOfVertices;
+   reserved->format = format;
    return true;
 }
 
@@ -234,7 +282,7 @@ bool ENG_API Eng::Vbo::create(uint32_t nrOfVertices, const void *data)
  */
 bool ENG_API Eng::Vbo::render(uint32_t value, void *data) const
 {	   
-   glBindBuffer(GL_ARRAY_BUFFER, reserved->oglId);
+   Eng::State::bindBuffer(GL_ARRAY_BUFFER, reserved->oglId);
    
    // Done:
    return true;
@@ -55,6 +55,44 @@ public: //
 	};
 
 
+   /**
+    * @brief Per-vertex data, with the position quantized within the bounding box of the mesh
+    */
+   struct QuantizedVertexData
+   {
+      uint16_t vertex[3];  ///< Vertex data, as 16-bit unorm relative to the bounding box
+      uint16_t _pad;       ///< Padding
+      uint32_t normal;     ///< Normal, packed as 10_10_10_2
+      uint32_t uv;         ///< Tex coords, packed as 2xfp16
+      uint32_t tangent;    ///< Tangent, packed as 10_10_10_2
+
+
+      /**
+       * Constructor. 
+       */
+      inline QuantizedVertexData() noexcept : vertex{ 0, 0, 0 }, _pad{ 0 }, normal{ 0 }, uv{ 0 }, tangent{ 0 }
+      {}
+   };
+
+
+   /**
+    * @brief Vertex formats.
+    */
+   enum class Format : uint32_t
+   {
+      none,
+
+      // Formats:
+      full,                ///< VertexData
+      quantized,           ///< QuantizedVertexData
+      position,            ///< glm::vec3 (position only, for depth-only passes)
+      quantizedPosition,   ///< 4x uint16_t (quantized position and padding only, for depth-only passes)
+
+      // Terminator:
+      last
+   };
+
+
    // Const/dest:
    Vbo();
    Vbo(Vbo &&other);
@@ -64,9 +102,10 @@ public: //
    // Get/set:   
    uint32_t getNrOfVertices() const;
    uint32_t getOglHandle() const;
+   Format getFormat() const;
 
    // Data:
-   bool create(uint32_t nrOfVertices, const void *data = nullptr);
+   bool create(uint32_t nrOfVertices, const void *data = nullptr, Format format = Format::full);
 
    // Rendering methods:   
    bool render(uint32_t value = 0, void *data = nullptr) const;
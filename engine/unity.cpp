@@ -1,17 +1,22 @@
 #include <engine_bitmap.cpp>
+#include <engine_bvh.cpp>
 #include <engine_camera.cpp>
 #include <engine_container.cpp>
+#include <engine_cooked.cpp>
 #include <engine_ebo.cpp>
 #include <engine_fbo.cpp>
+#include <engine_frame_stats.cpp>
 #include <engine_imgui.cpp>
 #include <engine_light.cpp>
 #include <engine_list.cpp>
+#include <engine_loader.cpp>
 #include <engine_log.cpp>
 #include <engine_managed.cpp>
 #include <engine_material.cpp>
 #include <engine_mesh.cpp>
 #include <engine_node.cpp>
 #include <engine_object.cpp>
+#include <engine_occlusion.cpp>
 #include <engine_ovo.cpp>
 #include <engine_particle_emitter.cpp>
 #include <engine_pipeline_compute.cpp>
@@ -20,11 +25,15 @@
 #include <engine_pipeline_particle.cpp>
 #include <engine_pipeline_shadowmapping.cpp>
 #include <engine_pipeline.cpp>
+#include <engine_profiler.cpp>
 #include <engine_program.cpp>
 #include <engine_serializer.cpp>
 #include <engine_shader.cpp>
 #include <engine_ssbo.cpp>
+#include <engine_state.cpp>
 #include <engine_texture.cpp>
+#include <engine_triangle_bvh.cpp>
+#include <engine_ubo.cpp>
 #include <engine_vao.cpp>
 #include <engine_vbo.cpp>
 #include <engine.cpp>
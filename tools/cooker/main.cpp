@@ -0,0 +1,57 @@
+/**
+ * @file		main.cpp
+ * @brief	Offline converter from OVO to cooked scene files
+ *
+ * @author	Achille Peternier (achille.peternier@supsi.ch), (C) SUPSI
+ */
+
+
+
+//////////////
+// #INCLUDE //
+//////////////
+
+   // Main engine header:
+   #include "engine.h"
+
+   // C/C++:
+   #include <iostream>
+
+
+
+//////////
+// MAIN //
+//////////
+
+/**
+ * Application entry point.
+ * @param argc number of command-line arguments passed
+ * @param argv array containing up to argc passed arguments
+ * @return error code (0 on success, error code otherwise)
+ */
+int main(int argc, char *argv[])
+{
+   // Credits:
+   std::cout << "Scene cooker, A. Peternier (C) SUPSI" << std::endl;
+   std::cout << std::endl;
+
+   // Usage:
+   bool optimize = true;
+   if (argc == 4 && std::string(argv[3]) == "-noopt")
+      optimize = false;
+   else if (argc != 3)
+   {
+      std::cout << "Usage: " << argv[0] << " <input.ovo> <output.ovc> [-noopt]" << std::endl;
+      return 1;
+   }
+
+   // Convert (DDS files are resolved relative to the working directory):
+   if (!Eng::Cooked::cook(argv[1], argv[2], optimize))
+   {
+      std::cout << "[!] Unable to cook '" << argv[1] << "'" << std::endl;
+      return 2;
+   }
+
+   // Done:
+   return 0;
+}